@@ -10,15 +10,9 @@
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
+#include "incr.h"
+#include "context.h"
 
-/* counter for variable memory locations */
-static int location = 0;
-static char * scope;
-static int isFuncC = FALSE;
-static int globalloc = 0;
-static int staticloc = 0;
-static int paramloc = 0;
-static int isoutFunc = FALSE;
 /* Procedure traverse is a generic recursive 
  * syntax tree traversal routine:
  * it applies preProc in preorder and postProc 
@@ -38,6 +32,18 @@ static void traverse( TreeNode * t,
   }
 }
 
+/* Procedure traverseNode is traverse applied to
+ * node t alone, without the siblings after it
+ */
+static void traverseNode( TreeNode * t,
+               void (* preProc) (TreeNode *),
+               void (* postProc) (TreeNode *) )
+{ TreeNode * sibling = t->sibling;
+  t->sibling = NULL;
+  traverse(t,preProc,postProc);
+  t->sibling = sibling;
+}
+
 /* nullProc is a do-nothing procedure to 
  * generate preorder-only or postorder-only
  * traversals from traverse
@@ -64,7 +70,7 @@ static void symbolError(TreeNode * t, char * err)
       type = "void";
       break;
   }
-  fprintf(listing,"Err %s %s at line %d : %s \n", type, t->attr.name, t->lineno, err);
+  fprintf(cc->listing,"Err %s %s at line %d : %s \n", type, t->attr.name, t->lineno, err);
 }
 
 static void afterInsert( TreeNode * t)
@@ -82,7 +88,7 @@ static void afterInsert( TreeNode * t)
           // location--;
           // paramloc = 0;
           // staticloc = 0;
-        location--;
+        cc->analyze.location--;
           break;
         default:
           break;
@@ -92,9 +98,10 @@ static void afterInsert( TreeNode * t)
       switch (t->kind.decl)
       {
         case FuncK:
+          scope_lookup(t->attr.name)->frameSize = cc->analyze.staticloc;
           pop_scope();
-          paramloc =0;
-          staticloc = 0;
+          cc->analyze.paramloc =0;
+          cc->analyze.staticloc = 0;
           break;
         default:
           break;
@@ -115,8 +122,8 @@ static void insertNode( TreeNode * t)
       switch (t->kind.stmt)
       { 
         case CompK:
-            if(isFuncC)
-              isFuncC = FALSE;
+            if(cc->analyze.isFuncC)
+              cc->analyze.isFuncC = FALSE;
             else{
               // ScopeList newScope = createscope(scope);
               // push_scope(newScope); location++;
@@ -131,14 +138,14 @@ static void insertNode( TreeNode * t)
       { case IdK:
         case ArrIdK:
         case CallK:
-          if (st_lookup(scope, t->attr.name) == -1)
+          if (st_lookup(cc->analyze.scope, t->attr.name) == -1)
             symbolError(t, "undeclared symbol");
           else
             add_line(t->attr.name, t->lineno);
           break;
         case AssignK:{
             ExpType ty;
-            ty = type_lookup(scope,t->child[0]->attr.name);
+            ty = type_lookup(cc->analyze.scope,t->child[0]->attr.name);
             if( ty == IntegerArray && t->child[0]->kind.exp == IdK )
               symbolError(t, "cannot assign array to");
           }
@@ -153,10 +160,10 @@ static void insertNode( TreeNode * t)
     case DeclK:
       switch (t->kind.exp)
       { case FuncK:
-            if ( st_lookup(scope, t->attr.name) >= 0 )
+            if ( st_lookup(cc->analyze.scope, t->attr.name) >= 0 )
               symbolError(t, "Declared symbol");
             else
-              isFuncC = TRUE;
+              cc->analyze.isFuncC = TRUE;
               switch(t->child[0]->attr.type){
                 case INT:
                   t->type = Integer;
@@ -166,14 +173,14 @@ static void insertNode( TreeNode * t)
                   t->type = Void;
                   break;
                 }
-              st_insert("Func",t->attr.name,t->type,t->lineno, location, globalloc++);
-              scope = t->attr.name;
-              push_scope(createscope(scope)); location++;
-              paramloc = 0;
-              staticloc = 0;
+              st_insert("Func",t->attr.name,t->type,t->lineno, cc->analyze.location, 0);
+              cc->analyze.scope = t->attr.name;
+              push_scope(createscope(cc->analyze.scope)); cc->analyze.location++;
+              cc->analyze.paramloc = 0;
+              cc->analyze.staticloc = 0;
           break;
         case VarK:
-            if ( st_lookup_cur(scope,t->attr.name) >= 0 )
+            if ( st_lookup_cur(cc->analyze.scope,t->attr.name) >= 0 )
               symbolError(t, "Declared symbol");
             else{
               if (t->child[0]->attr.type == VOID){
@@ -181,14 +188,14 @@ static void insertNode( TreeNode * t)
                 break;
               }
               t->type = Integer;
-              if(strcmp(scope, "Global")==0)
-                st_insert("Var", t->attr.name, t->type, t->lineno, location, globalloc++);
+              if(cc->analyze.scope == globalName)
+                st_insert("Var", t->attr.name, t->type, t->lineno, cc->analyze.location, cc->analyze.globalloc++);
               else
-                st_insert("Var", t->attr.name, t->type, t->lineno, location, staticloc++);
+                st_insert("Var", t->attr.name, t->type, t->lineno, cc->analyze.location, cc->analyze.staticloc++);
             }
           break;
         case ArrVarK:
-            if ( st_lookup_cur(scope,t->attr.arr.name) >= 0 )
+            if ( st_lookup_cur(cc->analyze.scope,t->attr.arr.name) >= 0 )
               symbolError(t, "Declared symbol");
             else{
               if (t->child[0]->attr.type == VOID){
@@ -196,13 +203,13 @@ static void insertNode( TreeNode * t)
                 break;
               }
               t->type = IntegerArray;
-              if(strcmp(scope, "Global")==0){
-                st_insert("Var", t->attr.arr.name, t->type, t->lineno, location, globalloc+t->attr.arr.size-1);
-                globalloc += t->attr.arr.size;
+              if(cc->analyze.scope == globalName){
+                st_insert("Var", t->attr.arr.name, t->type, t->lineno, cc->analyze.location, cc->analyze.globalloc+t->attr.arr.size-1);
+                cc->analyze.globalloc += t->attr.arr.size;
               }
               else{
-                st_insert("Var", t->attr.arr.name, t->type, t->lineno, location, staticloc+t->attr.arr.size);
-                staticloc += t->attr.arr.size;
+                st_insert("Var", t->attr.arr.name, t->type, t->lineno, cc->analyze.location, cc->analyze.staticloc);
+                cc->analyze.staticloc += t->attr.arr.size;
               }
             }
           break;
@@ -217,14 +224,14 @@ static void insertNode( TreeNode * t)
             switch(t->kind.param){
               case ArrParamK:
                   t->type = IntegerArray;
-                  st_insert("Param", t->attr.name, t->type, t->lineno, location, paramloc++);
+                  st_insert("Param", t->attr.name, t->type, t->lineno, cc->analyze.location, cc->analyze.paramloc++);
                   break;
               default:
                   t->type = Integer;
-                  st_insert("Param", t->attr.name, t->type, t->lineno, location, paramloc++);
+                  st_insert("Param", t->attr.name, t->type, t->lineno, cc->analyze.location, cc->analyze.paramloc++);
                   break;
             }
-            staticloc++;
+            cc->analyze.staticloc++;
           }
       break;
     default:
@@ -251,7 +258,7 @@ void insertGeneralFunc(TreeNode *t)
   comp_stmt->child[2] = NULL;
 
   func->lineno = 0;
-  func->attr.name = "input";
+  func->attr.name = inputName;
   func->child[0] = type;
   func->child[1] = NULL;
   func->child[2] = comp_stmt;
@@ -261,8 +268,8 @@ void insertGeneralFunc(TreeNode *t)
   t = func;
   t->sibling = temp;
   */
-  st_insert("Func", "input", func->type, -1, location, globalloc++);
-  push_pl(createpl("input",func));
+  st_insert("Func", inputName, func->type, -1, cc->analyze.location, 0);
+  push_pl(createpl(inputName,func));
 
   func = newDeclNode(FuncK);
   type = newTypeNode(TypeNameK);
@@ -281,7 +288,7 @@ void insertGeneralFunc(TreeNode *t)
 
 
   func->lineno = 0;
-  func->attr.name = "output";
+  func->attr.name = outputName;
   func->child[0] = type;
   func->child[1] = param;
   func->child[2] = comp_stmt;
@@ -291,8 +298,8 @@ void insertGeneralFunc(TreeNode *t)
   t = func;
   t->sibling = temp;
   */
-  st_insert("Func", "output", func->type, -1, location, globalloc++);
-  push_pl(createpl("output",func));
+  st_insert("Func", outputName, func->type, -1, cc->analyze.location, 0);
+  push_pl(createpl(outputName,func));
 
 }
 /* Function buildSymtab constructs the symbol 
@@ -300,21 +307,21 @@ void insertGeneralFunc(TreeNode *t)
  */
 void buildSymtab(TreeNode * syntaxTree)
 { 
-  g_scope = createscope("Global");
-  scope="Global";
-  push_scope(g_scope);
+  cc->symtab.g_scope = createscope(globalName);
+  cc->analyze.scope=globalName;
+  push_scope(cc->symtab.g_scope);
   insertGeneralFunc(syntaxTree);
   traverse(syntaxTree,insertNode,afterInsert);
-  if (TraceAnalyze)
+  if (cc->TraceAnalyze)
   { 
-    fprintf(listing,"\nSymbol table:\n\n");
-    printSymTab(listing);
+    fprintf(cc->listing,"\nSymbol table:\n\n");
+    printSymTab(cc->listing);
   }
 }
 
 static void typeError(TreeNode * t, char * message)
-{ fprintf(listing,"Type error at line %d: %s\n",t->lineno,message);
-  Error = TRUE;
+{ fprintf(cc->listing,"Type error at line %d: %s\n",t->lineno,message);
+  cc->Error = TRUE;
 }
 
 static void beforeCheck(TreeNode * t)
@@ -322,7 +329,7 @@ static void beforeCheck(TreeNode * t)
   { case DeclK:
       switch (t->kind.decl)
       { case FuncK:
-          scope = t->attr.name;
+          cc->analyze.scope = t->attr.name;
           push_pl(createpl(t->attr.name, t));
           break;
         default:
@@ -333,10 +340,10 @@ static void beforeCheck(TreeNode * t)
       switch (t->kind.exp)
       {
         case IdK:
-          t->type = type_lookup(scope, t->attr.name);
+          t->type = type_lookup(cc->analyze.scope, t->attr.name);
           break;
         case ArrIdK:
-          t->type = type_lookup(scope, t->attr.name);
+          t->type = type_lookup(cc->analyze.scope, t->attr.name);
           break;
         case CallK:
           t->type = sc_lookup(t->attr.name);
@@ -361,22 +368,22 @@ static void checkNode(TreeNode * t)
         case CompK:
           break;
         case IfK:{
-          if( t->child[0]->child[0]->type == Void)
+          if( t->child[0]->type == Void)
             typeError(t->child[0], "no void");
         }
           break;
         case IterK:{
-          if( t->child[0]->child[0]->type == Void)
+          if( t->child[0]->type == Void)
             typeError(t->child[0], "no void");
         }
           break;
         case RetK:
           {
             const TreeNode * expr = t->child[0];
-            if((sc_lookup(scope)==Void)&&(expr != NULL && expr->type != Void)){
+            if((sc_lookup(cc->analyze.scope)==Void)&&(expr != NULL && expr->type != Void)){
               typeError(t,"Expected to return void");
             }
-            else if((sc_lookup(scope)==Integer) && (expr == NULL || expr->type != Integer)){
+            else if((sc_lookup(cc->analyze.scope)==Integer) && (expr == NULL || expr->type != Integer)){
               typeError(t,"Expected to return integer");
             }
           }
@@ -419,7 +426,7 @@ static void checkNode(TreeNode * t)
             TreeNode * func = getpl(t->attr.name)->treenode;
             TreeNode * arg = t->child[0];
             TreeNode * param = func->child[1];
-            printf("%s\n",t->attr.name);
+            fprintf(cc->listing,"%s\n",t->attr.name);
             while(arg != NULL)
             { //printf("arg: %d,  param: %d,\n ",arg->child[0]->kind.exp, param->kind.param);
               if (param == NULL)
@@ -452,9 +459,19 @@ static void checkNode(TreeNode * t)
 }
 
 /* Procedure typeCheck performs type checking 
- * by a postorder syntax tree traversal
+ * by a postorder syntax tree traversal; with
+ * -incremental, a function that checked before as it
+ * is now is only entered in the function list
  */
 void typeCheck(TreeNode * syntaxTree)
-{ 
-  traverse(syntaxTree,beforeCheck,checkNode);
+{ TreeNode * t;
+  if (!cc->Incremental)
+  { traverse(syntaxTree,beforeCheck,checkNode);
+    return;
+  }
+  beginChecks(syntaxTree);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind.decl == FuncK && wasChecked(t))
+      beforeCheck(t);
+    else traverseNode(t,beforeCheck,checkNode);
 }
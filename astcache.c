@@ -0,0 +1,302 @@
+/****************************************************/
+/* File: astcache.c                                 */
+/* Syntax tree cache for the C-minus compiler:      */
+/* parsed programs saved in binary form and loaded  */
+/* back without scanning or parsing                 */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "astcache.h"
+#include "context.h"
+
+/* ASTMAGIC reads "CAST" on a little-endian host;
+ * ASTVERSION changes with the layout of the file or
+ * the kinds of the nodes
+ */
+#define ASTMAGIC 0x54534143
+#define ASTVERSION 1
+
+typedef struct
+{ unsigned magic;
+  unsigned version;
+  SourceHash hash;  /* of the source parsed */
+  int lines;        /* cc->lineno after the parse */
+  int nodes;
+  int names;
+  int nameBytes;    /* of the names, padded to an int */
+} AstHeader;
+
+/* the links of a record tell which of the children
+ * of its node follow it, each as a whole subtree,
+ * and whether its sibling follows them
+ */
+#define LINKCHILD(i) (1 << (i))
+#define LINKSIBLING (1 << MAXCHILDREN)
+
+typedef struct
+{ int attr;       /* the value, or the index of the name */
+  int size;       /* attr.arr.size of an ArrVarK */
+  int lineno;
+  unsigned char nodekind, kind, type, links;
+} AstRec;
+
+/* Function hasName returns TRUE if the attribute
+ * of a node of the given kinds is its name
+ */
+static int hasName(int nodekind, int kind)
+{ switch (nodekind)
+  { case DeclK:
+    case ParamK:
+      return TRUE;
+    case ExpK:
+      return kind == IdK || kind == ArrIdK || kind == CallK || kind == InlineK;
+    default:
+      return FALSE;
+  }
+}
+
+/* Function hasValue returns TRUE if the attribute
+ * of a node of the given kinds is an operator, a
+ * constant or a type; the others have none
+ */
+static int hasValue(int nodekind, int kind)
+{ return nodekind == TypeK
+    || (nodekind == ExpK && (kind == OpK || kind == ConstK));
+}
+
+SourceHash hashSource(FILE * f)
+{ struct stat st;
+  unsigned char * text;
+  unsigned long long w, h;
+  size_t i, n;
+  if (fstat(fileno(f),&st) != 0 || !S_ISREG(st.st_mode)) return 0;
+  n = st.st_size;
+  h = 14695981039346656037ULL ^ n;
+  if (n > 0)
+  { text = mmap(NULL,n,PROT_READ,MAP_PRIVATE,fileno(f),0);
+    if (text == MAP_FAILED) return 0;
+    /* FNV-1a over words, folded after each */
+    for (i = 0; i + sizeof(w) <= n; i += sizeof(w))
+    { memcpy(&w,text+i,sizeof(w));
+      h = (h ^ w) * 1099511628211ULL;
+      h ^= h >> 32;
+    }
+    for (; i < n; i++) h = (h ^ text[i]) * 1099511628211ULL;
+    munmap(text,n);
+  }
+  return h == 0 ? 1 : h;
+}
+
+/**************************************************/
+/***********   Saving                     *********/
+/**************************************************/
+
+/* the tree being saved: its records in preorder and
+ * its names, each entered once in a hash table open
+ * by address, of nslot slots
+ */
+typedef struct
+{ AstRec * recs;
+  int nrec;
+  char ** slot;
+  int * index;     /* the number of the name of a slot */
+  int nslot;
+  char * names;
+  int nameBytes, maxBytes;
+  int nnames;
+} AstWriter;
+
+/* Function countNodes returns the nodes of tree t
+ * and the siblings that follow it
+ */
+static int countNodes(TreeNode * t)
+{ int i, n = 0;
+  for (; t != NULL; t = t->sibling)
+  { n++;
+    for (i = 0; i < MAXCHILDREN; i++) n += countNodes(t->child[i]);
+  }
+  return n;
+}
+
+/* Function nameIndex returns the number of name in
+ * the names of w, entering it the first time; names
+ * are interned, so they are told apart by address
+ */
+static int nameIndex(AstWriter * w, char * name)
+{ unsigned k;
+  int len;
+  if (name == NULL) return -1;
+  k = (unsigned) (((unsigned long) name >> 4) * 2654435761u) & (w->nslot - 1);
+  while (w->slot[k] != NULL && w->slot[k] != name) k = (k + 1) & (w->nslot - 1);
+  if (w->slot[k] == NULL)
+  { len = strlen(name) + 1;
+    while (w->nameBytes + len + (int) sizeof(int) > w->maxBytes)
+    { w->maxBytes *= 2;
+      w->names = (char *) realloc(w->names, w->maxBytes);
+    }
+    memcpy(w->names + w->nameBytes, name, len);
+    w->nameBytes += len;
+    w->slot[k] = name;
+    w->index[k] = w->nnames++;
+  }
+  return w->index[k];
+}
+
+/* Procedure putTree adds the records of tree t and
+ * the siblings that follow it to w
+ */
+static void putTree(AstWriter * w, TreeNode * t)
+{ AstRec * r;
+  int i;
+  for (; t != NULL; t = t->sibling)
+  { r = &w->recs[w->nrec++];
+    if (hasName(t->nodekind, t->kind.stmt))
+      r->attr = nameIndex(w, t->attr.name);
+    else if (hasValue(t->nodekind, t->kind.stmt))
+      r->attr = t->attr.val;
+    else r->attr = 0;
+    r->size = t->nodekind == DeclK && t->kind.decl == ArrVarK ? t->attr.arr.size : 0;
+    r->lineno = t->lineno;
+    r->nodekind = t->nodekind;
+    r->kind = t->kind.stmt;
+    r->type = t->type;
+    r->links = t->sibling != NULL ? LINKSIBLING : 0;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (t->child[i] != NULL) r->links |= LINKCHILD(i);
+    for (i = 0; i < MAXCHILDREN; i++) putTree(w, t->child[i]);
+  }
+}
+
+/* The cache is written under another name and then
+ * renamed, so a reader never sees half of one
+ */
+int saveAst(char * name, SourceHash h, TreeNode * tree)
+{ AstWriter w;
+  AstHeader hd;
+  FILE * f;
+  char * tmp;
+  int n = countNodes(tree), ok;
+  w.recs = (AstRec *) malloc((n + 1) * sizeof(AstRec));
+  w.nrec = 0;
+  for (w.nslot = 16; w.nslot < 2 * n; w.nslot *= 2) ;
+  w.slot = (char **) calloc(w.nslot, sizeof(char *));
+  w.index = (int *) malloc(w.nslot * sizeof(int));
+  w.maxBytes = 256;
+  w.names = (char *) malloc(w.maxBytes);
+  w.nameBytes = w.nnames = 0;
+  tmp = (char *) malloc(strlen(name) + 24);
+  if (w.recs == NULL || w.slot == NULL || w.index == NULL
+      || w.names == NULL || tmp == NULL)
+    ok = FALSE;
+  else
+  { putTree(&w, tree);
+    while (w.nameBytes % sizeof(int) != 0) w.names[w.nameBytes++] = '\0';
+    hd.magic = ASTMAGIC;
+    hd.version = ASTVERSION;
+    hd.hash = h;
+    hd.lines = cc->lineno;
+    hd.nodes = w.nrec;
+    hd.names = w.nnames;
+    hd.nameBytes = w.nameBytes;
+    sprintf(tmp, "%s.%ld", name, (long) getpid());
+    f = fopen(tmp, "wb");
+    ok = f != NULL
+      && fwrite(&hd, sizeof(hd), 1, f) == 1
+      && fwrite(w.names, 1, w.nameBytes, f) == (size_t) w.nameBytes
+      && fwrite(w.recs, sizeof(AstRec), w.nrec, f) == (size_t) w.nrec;
+    if (f != NULL && fclose(f) != 0) ok = FALSE;
+    if (ok) ok = rename(tmp, name) == 0;
+    if (!ok) remove(tmp);
+  }
+  free(tmp);
+  free(w.names);
+  free(w.index);
+  free(w.slot);
+  free(w.recs);
+  return ok;
+}
+
+/**************************************************/
+/***********   Loading                    *********/
+/**************************************************/
+
+/* Function readTree makes the tree of the names and
+ * records in buf, described by hd, from the nodes of
+ * cc, or returns NULL if they do not make one. The
+ * records are in preorder, so each fills the place
+ * left last for a node: slots holds the places still
+ * to fill, the children of a node before its sibling.
+ */
+static TreeNode * readTree(AstHeader * hd, char * buf)
+{ AstRec * r = (AstRec *) (buf + hd->nameBytes);
+  char ** names = (char **) malloc((hd->names + 1) * sizeof(char *));
+  TreeNode *** slots = (TreeNode ***) malloc((3 * hd->nodes + 2) * sizeof(TreeNode **));
+  TreeNode * nodes = newNodesIn(&cc->nodes, hd->nodes);
+  TreeNode * tree = NULL, * t;
+  char * s = buf, * end;
+  int i, k, nslot = 0, ok = names != NULL && slots != NULL && nodes != NULL;
+  for (k = 0; ok && k < hd->names; k++)
+  { end = memchr(s, '\0', buf + hd->nameBytes - s);
+    if (end == NULL) ok = FALSE;
+    else
+    { names[k] = internText(s, end - s);
+      s = end + 1;
+    }
+  }
+  if (ok) slots[nslot++] = &tree;
+  for (k = 0; ok && k < hd->nodes; k++, r++)
+  { if (nslot == 0 || (hasName(r->nodekind, r->kind)
+                        && (r->attr < -1 || r->attr >= hd->names)))
+    { ok = FALSE;
+      break;
+    }
+    t = &nodes[k];
+    *slots[--nslot] = t;
+    t->nodekind = r->nodekind;
+    t->kind.stmt = r->kind;
+    t->type = r->type;
+    t->lineno = r->lineno;
+    if (hasName(r->nodekind, r->kind))
+    { t->attr.name = r->attr < 0 ? NULL : names[r->attr];
+      if (r->nodekind == DeclK && r->kind == ArrVarK) t->attr.arr.size = r->size;
+    }
+    else t->attr.val = r->attr;
+    t->sibling = NULL;
+    if (r->links & LINKSIBLING) slots[nslot++] = &t->sibling;
+    for (i = MAXCHILDREN - 1; i >= 0; i--)
+    { t->child[i] = NULL;
+      if (r->links & LINKCHILD(i)) slots[nslot++] = &t->child[i];
+    }
+  }
+  free(slots);
+  free(names);
+  return ok && nslot == 0 ? tree : NULL;
+}
+
+TreeNode * loadAst(char * name, SourceHash h)
+{ AstHeader hd;
+  TreeNode * tree = NULL;
+  FILE * f = fopen(name, "rb");
+  char * buf;
+  size_t bytes;
+  if (f == NULL) return NULL;
+  if (fread(&hd, sizeof(hd), 1, f) == 1 && hd.magic == ASTMAGIC
+      && hd.version == ASTVERSION && hd.hash == h && h != 0
+      && hd.nodes > 0 && hd.names >= 0 && hd.nameBytes >= 0
+      && hd.nameBytes % sizeof(int) == 0)
+  { bytes = hd.nameBytes + (size_t) hd.nodes * sizeof(AstRec);
+    buf = (char *) malloc(bytes);
+    if (buf != NULL && fread(buf, 1, bytes, f) == bytes)
+      tree = readTree(&hd, buf);
+    free(buf);
+  }
+  fclose(f);
+  if (tree != NULL) cc->lineno = hd.lines;
+  return tree;
+}
@@ -0,0 +1,47 @@
+/****************************************************/
+/* File: astcache.h                                 */
+/* Syntax tree cache interface for the C-minus      */
+/* compiler: parsed programs saved in binary form   */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _ASTCACHE_H_
+#define _ASTCACHE_H_
+
+/* An AST cache file <program>.ast holds the syntax
+ * tree of a program as it was parsed, with the hash
+ * of the source it came from: a header, the names
+ * of the tree, each '\0' terminated, and a record of
+ * 16 bytes for each node in preorder. A program whose
+ * source still has that hash is loaded from its cache
+ * instead of being scanned and parsed again. The
+ * file is in the byte order of the host and starts
+ * with a version, so one that was written by another
+ * host or compiler is just parsed again.
+ */
+
+/* the hash of a source text; 0 means none */
+typedef unsigned long long SourceHash;
+
+/* Function hashSource returns the hash of the text
+ * of the source file f, or 0 if f is not a regular
+ * file; f is not moved
+ */
+SourceHash hashSource(FILE * f);
+
+/* Function loadAst returns the syntax tree cached in
+ * file name for the source of hash h, made from the
+ * nodes of cc, and sets cc->lineno to the lines that
+ * source has; it returns NULL if there is no such
+ * cache
+ */
+TreeNode * loadAst(char * name, SourceHash h);
+
+/* Function saveAst writes tree, parsed from the
+ * source of hash h and cc->lineno lines, to the cache
+ * file name; it returns FALSE if it cannot
+ */
+int saveAst(char * name, SourceHash h, TreeNode * tree);
+
+#endif
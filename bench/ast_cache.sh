@@ -0,0 +1,74 @@
+#!/bin/sh
+#
+# ast_cache.sh: times a generated C-minus program of
+# many functions parsed by each parser, then loaded
+# from the AST cache that -ast-cache saved, and
+# prints the source lines each way reads per second
+#
+# usage: bench/ast_cache.sh [functions] [parser]
+# parser defaults to ./cminus_parse (make cminus_parse)
+#
+
+FUNCS=${1:-20000}
+PARSER=${2:-./cminus_parse}
+DIR=${TMPDIR:-/tmp}/ast_cache.$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+if [ ! -x "$PARSER" ]
+then echo "no parser $PARSER: run make cminus_parse" >&2
+     exit 1
+fi
+
+awk -v n=$FUNCS 'BEGIN {
+  print "int table[100];"
+  for (i = 0; i < n; i++)
+  { print "int step(int value, int limit, int weights[])"
+    print "{ int index; int total;"
+    print "  index = 0; total = value * 3 + limit / 2;"
+    print "  while (index < limit)"
+    print "  { if (weights[index] >= total - index)"
+    print "      total = total + step(index, limit - 1, weights) * " i ";"
+    print "    else"
+    print "    { table[index] = (total + weights[index]) * (index - 1);"
+    print "      total = total - table[index + 1]; }"
+    print "    index = index + 1;"
+    print "  }"
+    print "  return total;"
+    print "}"
+  }
+  print "void main(void) { output(step(input(), 10, table)); }"
+}' > $DIR/p.cm
+lines=`wc -l < $DIR/p.cm`
+
+# now prints the time in nanoseconds
+now ()
+{ date +%s%N
+}
+
+# the first -ast-cache run parses and saves the
+# cache, the second loads it
+printf "%-8s %10s %10s %12s\n" way lines seconds "Mlines/s"
+for way in yacc rdparse save load
+do case $way in
+   yacc)    flags= ;;
+   rdparse) flags=-rdparse ;;
+   *)       flags="-rdparse -ast-cache" ;;
+   esac
+   start=`now`
+   $PARSER $flags $DIR/p.cm > $DIR/p.out || exit 1
+   end=`now`
+   if grep -q "error" $DIR/p.out
+   then grep "error" $DIR/p.out | head -1 >&2
+        exit 1
+   fi
+   awk -v w=$way -v n=$lines -v t=$((end - start)) 'BEGIN {
+     printf "%-8s %10d %10.3f %12.2f\n", w, n, t / 1e9, n / t * 1e3 }'
+done
+if [ ! -f $DIR/p.ast ]
+then echo "no cache $DIR/p.ast was saved" >&2
+     exit 1
+fi
+for f in cm ast
+do printf "%-8s %10d bytes\n" p.$f `wc -c < $DIR/p.$f`
+done
@@ -0,0 +1,82 @@
+#!/bin/sh
+#
+# batch_speed.sh: compiles many generated C-minus
+# programs first with one compiler process each, then
+# in one process with -manifest on 1 and on N worker
+# threads, and prints the programs each way compiles
+# per second
+#
+# usage: bench/batch_speed.sh [programs] [threads] [compiler]
+# compiler defaults to ./cminus (make cminus)
+#
+
+PGMS=${1:-400}
+JOBS=${2:-`getconf _NPROCESSORS_ONLN`}
+COMPILER=${3:-./cminus}
+DIR=${TMPDIR:-/tmp}/batch_speed.$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+if [ ! -x "$COMPILER" ]
+then echo "no compiler $COMPILER: run make cminus" >&2
+     exit 1
+fi
+case $COMPILER in
+/*) ;;
+*) COMPILER=`pwd`/$COMPILER ;;
+esac
+
+awk -v n=$PGMS -v dir=$DIR 'BEGIN {
+  for (p = 0; p < n; p++)
+  { f = dir "/p" p ".cm"
+    print "int table[10];" > f
+    for (i = 0; i < 20; i++)
+    { print "int step" substr("abcdefghijklmnopqrst", i + 1, 1) \
+            "(int value, int limit)" > f
+      print "{ int index; int total;" > f
+      print "  index = 0; total = value * " p " + limit / 2;" > f
+      print "  while (index < limit)" > f
+      print "  { if (table[index] >= total - index)" > f
+      print "      total = total + table[index] * " i ";" > f
+      print "    else total = total - index;" > f
+      print "    index = index + 1;" > f
+      print "  }" > f
+      print "  return total;" > f
+      print "}" > f
+    }
+    print "void main(void) { output(stepa(input(), 10)); }" > f
+    close(f)
+    print "p" p ".cm" > (dir "/manifest")
+  }
+}'
+
+# now prints the time in nanoseconds
+now ()
+{ date +%s%N
+}
+
+MODES="process 1"
+if [ "$JOBS" -gt 1 ]
+then MODES="$MODES $JOBS"
+fi
+
+cd $DIR
+printf "%-12s %10s %10s %12s\n" mode programs seconds "programs/s"
+for mode in $MODES
+do start=`now`
+   if [ $mode = process ]
+   then for f in `cat manifest`
+        do $COMPILER -rdparse $f > $f.out || exit 1
+        done
+   else $COMPILER -rdparse -jobs=$mode -manifest=manifest > batch.out || exit 1
+   fi
+   end=`now`
+   if grep -q "error" *.out
+   then grep "error" *.out | head -1 >&2
+        exit 1
+   fi
+   rm -f *.out
+   awk -v m=$mode -v n=$PGMS -v t=$((end - start)) 'BEGIN {
+     if (m != "process") m = "jobs=" m
+     printf "%-12s %10d %10.3f %12.1f\n", m, n, t / 1e9, n / t * 1e9 }'
+done
@@ -0,0 +1,92 @@
+#!/bin/sh
+#
+# incremental.sh: compiles a generated C-minus program
+# of many functions in full, then with -incremental
+# from no cache, again unchanged, and once one of its
+# functions changed, and prints the seconds each way
+# takes
+#
+# usage: bench/incremental.sh [functions] [level] [compiler]
+# level defaults to -O1, compiler to ./cminus (make cminus);
+# the program is far past the instruction memory of TM,
+# so the compiles lift the limit with -iaddr-size
+#
+
+FUNCS=${1:-2000}
+LEVEL=${2:--O1}
+COMPILER=${3:-./cminus}
+DIR=${TMPDIR:-/tmp}/incremental.$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+if [ ! -x "$COMPILER" ]
+then echo "no compiler $COMPILER: run make cminus" >&2
+     exit 1
+fi
+case $COMPILER in
+/*) ;;
+*) COMPILER=`pwd`/$COMPILER ;;
+esac
+
+# program writes the functions, each calling the one
+# before; function edit of them scales by its number
+# plus 1
+program ()
+{ awk -v n=$FUNCS -v edit=$1 'BEGIN {
+    letters = "abcdefghijklmnopqrstuvwxyz"
+    print "int table[100];"
+    for (i = 0; i < n; i++)
+    { name[i] = "step"
+      for (k = i; ; k = int(k / 26))
+      { name[i] = name[i] substr(letters, k % 26 + 1, 1)
+        if (k < 26) break
+      }
+      print "int " name[i] "(int value, int limit)"
+      print "{ int index; int total;"
+      print "  index = 0; total = value * 3 + limit / 2;"
+      print "  while (index < limit)"
+      print "  { if (table[index] >= total - index)"
+      print "      total = total + table[index] * " (i == edit ? i + 1 : i) ";"
+      print "    else table[index] = total - index;"
+      print "    index = index + 1;"
+      print "  }"
+      if (i > 0) print "  if (value > 0) total = total + " name[i-1] "(value - 1, limit);"
+      print "  return total;"
+      print "}"
+    }
+    print "void main(void) { output(" name[n-1] "(input(), 10)); }"
+  }'
+}
+
+# now prints the time in nanoseconds
+now ()
+{ date +%s%N
+}
+
+cd $DIR
+program -1 > p.cm
+printf "%-8s %10s %10s\n" way functions seconds
+for way in full cold warm edit
+do case $way in
+   full) flags= ;;
+   edit) flags=-incremental
+         program `expr $FUNCS / 2` > p.cm ;;
+   *)    flags=-incremental ;;
+   esac
+   start=`now`
+   $COMPILER $LEVEL -iaddr-size=1000000000 $flags p.cm > p.out || exit 1
+   end=`now`
+   if grep -q "error" p.out
+   then grep "error" p.out | head -1 >&2
+        exit 1
+   fi
+   awk -v w=$way -v n=$FUNCS -v t=$((end - start)) 'BEGIN {
+     printf "%-8s %10d %10.3f\n", w, n, t / 1e9 }'
+done
+if [ ! -f p.inc ]
+then echo "no cache p.inc was saved" >&2
+     exit 1
+fi
+for f in cm tm inc
+do printf "%-8s %10d bytes\n" p.$f `wc -c < p.$f`
+done
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# parse_scaling.sh: times the parser on generated
+# C-minus programs of 10k to 1M statements, once
+# as one long statement list and once as as many
+# top-level declarations, and prints the time per
+# statement, which stays flat when parsing is linear
+#
+# usage: bench/parse_scaling.sh [parser] [sizes...]
+# parser defaults to ./cminus_parse (make cminus_parse)
+#
+
+PARSER=${1:-./cminus_parse}
+[ $# -gt 0 ] && shift
+SIZES=${*:-"10000 100000 1000000"}
+DIR=${TMPDIR:-/tmp}/parse_scaling.$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+if [ ! -x "$PARSER" ]
+then echo "no parser $PARSER: run make cminus_parse" >&2
+     exit 1
+fi
+
+# gen shape n writes a program of n statements;
+# identifiers have no digits, so globals are named
+# by their number written in letters
+gen ()
+{ awk -v shape=$1 -v n=$2 '
+  function name(i,  s)
+  { s = ""
+    do { s = substr("abcdefghijklmnopqrstuvwxyz", i % 26 + 1, 1) s
+         i = int(i / 26) } while (i > 0)
+    return "g" s
+  }
+  BEGIN {
+    if (shape == "stmts")
+    { print "void main(void)\n{ int x;"
+      for (i = 0; i < n; i++) print "  x = x + " i ";"
+      print "}"
+    }
+    else
+    { for (i = 0; i < n; i++) print "int " name(i) ";"
+      print "void main(void) { }"
+    }
+  }'
+}
+
+# now prints the time in nanoseconds
+now ()
+{ date +%s%N
+}
+
+printf "%-6s %9s %10s %12s\n" shape n seconds "ns/stmt"
+for shape in stmts decls
+do for n in $SIZES
+   do gen $shape $n > $DIR/p.cm
+      start=`now`
+      $PARSER $DIR/p.cm > $DIR/p.out || exit 1
+      end=`now`
+      if grep -q "error" $DIR/p.out
+      then grep "error" $DIR/p.out | head -1 >&2
+           exit 1
+      fi
+      awk -v s=$shape -v n=$n -v t=$((end - start)) 'BEGIN {
+        printf "%-6s %9d %10.3f %12.1f\n", s, n, t / 1e9, t / n }'
+   done
+done
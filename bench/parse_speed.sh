@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# parse_speed.sh: times the Yacc parser and the
+# recursive-descent parser of rdparse.c side by side
+# on a generated C-minus program of many functions
+# with nested statements and expressions, and prints
+# the source lines each parses per second
+#
+# usage: bench/parse_speed.sh [functions] [parser]
+# parser defaults to ./cminus_parse (make cminus_parse)
+#
+
+FUNCS=${1:-20000}
+PARSER=${2:-./cminus_parse}
+DIR=${TMPDIR:-/tmp}/parse_speed.$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+if [ ! -x "$PARSER" ]
+then echo "no parser $PARSER: run make cminus_parse" >&2
+     exit 1
+fi
+
+awk -v n=$FUNCS 'BEGIN {
+  print "int table[100];"
+  for (i = 0; i < n; i++)
+  { print "int step(int value, int limit, int weights[])"
+    print "{ int index; int total;"
+    print "  index = 0; total = value * 3 + limit / 2;"
+    print "  while (index < limit)"
+    print "  { if (weights[index] >= total - index)"
+    print "      total = total + step(index, limit - 1, weights) * " i ";"
+    print "    else"
+    print "    { table[index] = (total + weights[index]) * (index - 1);"
+    print "      total = total - table[index + 1]; }"
+    print "    index = index + 1;"
+    print "  }"
+    print "  return total;"
+    print "}"
+  }
+  print "void main(void) { output(step(input(), 10, table)); }"
+}' > $DIR/p.cm
+lines=`wc -l < $DIR/p.cm`
+
+# now prints the time in nanoseconds
+now ()
+{ date +%s%N
+}
+
+printf "%-8s %10s %10s %12s\n" parser lines seconds "Mlines/s"
+for flag in "" -rdparse
+do start=`now`
+   $PARSER $flag $DIR/p.cm > $DIR/p.out || exit 1
+   end=`now`
+   if grep -q "error" $DIR/p.out
+   then grep "error" $DIR/p.out | head -1 >&2
+        exit 1
+   fi
+   awk -v p=${flag:-"-yacc"} -v n=$lines -v t=$((end - start)) 'BEGIN {
+     printf "%-8s %10d %10.3f %12.2f\n", substr(p, 2), n, t / 1e9, n / t * 1e3 }'
+done
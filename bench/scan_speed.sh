@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# scan_speed.sh: times the scanner-only compilers on
+# a generated C-minus program of long identifiers,
+# numbers, indentation and comments, and prints the
+# tokens per second of each; by default the hand
+# written scanner of scan.c against the flex one
+#
+# usage: bench/scan_speed.sh [lines] [scanners...]
+# scanners default to ./cminus_scan and
+# ./cminus_scan_flex (make cminus_scan cminus_scan_flex);
+# build with CFLAGS="-O2 -mavx2" to time the AVX2
+# scanner, or with -DNO_SIMD=TRUE the scalar one
+#
+
+LINES=${1:-1000000}
+[ $# -gt 0 ] && shift
+SCANNERS=${*:-"./cminus_scan ./cminus_scan_flex"}
+DIR=${TMPDIR:-/tmp}/scan_speed.$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+for s in $SCANNERS
+do if [ ! -x "$s" ]
+   then echo "no scanner $s: run make cminus_scan cminus_scan_flex" >&2
+        exit 1
+   fi
+done
+
+awk -v n=$LINES 'BEGIN {
+  print "/* generated by scan_speed.sh */"
+  print "int accumulatedTotal[100];"
+  print "void main(void)"
+  print "{ int runningIndex; int temporaryValue;"
+  for (i = 0; i < n; i++)
+  { if (i % 8 == 0)
+      print "        /* step the running index and fold the"
+      print "           temporary value into the total */"
+    print "        temporaryValue = accumulatedTotal[runningIndex] * " i " + 12345;"
+  }
+  print "}"
+}' > $DIR/p.cm
+
+# now prints the time in nanoseconds
+now ()
+{ date +%s%N
+}
+
+printf "%-24s %10s %10s %12s\n" scanner tokens seconds "Mtokens/s"
+for s in $SCANNERS
+do start=`now`
+   $s $DIR/p.cm > $DIR/p.out || exit 1
+   end=`now`
+   tokens=`awk '/ tokens$/ { print $1 }' $DIR/p.out`
+   awk -v s=$s -v n=$tokens -v t=$((end - start)) 'BEGIN {
+     printf "%-24s %10d %10.3f %12.1f\n", s, n, t / 1e9, n / t * 1e3 }'
+done
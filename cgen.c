@@ -8,54 +8,61 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "symtab.h"
 #include "code.h"
 #include "cgen.h"
+#include "incr.h"
+#include "context.h"
 
-/* tmpOffset is the memory offset for temps
-   It is decremented each time a temp is
-   stored, and incremeted when loaded again
+/* Frame layout, with fp = caller's sp - 2:
+     2(fp)  return address
+     1(fp)  caller's fp
+    -i(fp)  parameter i, followed by the locals
+   The frame size comes from the symbol table, so
+   the whole frame is reserved and released with
+   a single sp adjustment.
+
+   cgen.retLocs holds the locations of the jumps
+   from return statements to the shared epilogue of
+   the function being generated, and cgen.lastStmt
+   is the last statement of its body; a return there
+   falls into the epilogue.
 */
-static int paramOffset = 0;
-static int argOffset = -3;
-static int isinFunc = FALSE;
-static int isReturned = FALSE;
 
-static char * prevScope;
 /* prototype for internal recursive code generator */
 static void cGen (TreeNode * tree);
-static char * scope;
 
 static void genExp( TreeNode * tree, int lhs);
 
+static void genTailCall( TreeNode * tree);
+static int isTailCall( TreeNode * tree);
+
 /* Procedure genStmt generates code at a statement node */
 static void genStmt( TreeNode * tree)
 { TreeNode * p1, * p2, * p3;
   int savedLoc1,savedLoc2,currentLoc;
-  int paramnum, varnum;
-  ScopeList Scope;
   switch (tree->kind.stmt) {
       case CompK:
-        if(TraceCode) emitComment("-> Compound Stmt");
+        if(cc->TraceCode) emitComment("-> Compound Stmt");
         p1 = tree->child[0];
         p2 = tree->child[1];
-        if(isinFunc){  
-          isinFunc = FALSE;
-          push_scope(scope_lookup(scope));
+        if(cc->cgen.isinFunc){  
+          cc->cgen.isinFunc = FALSE;
+          push_scope(scope_lookup(cc->cgen.scope));
           cGen(p1);
           cGen(p2);
-          pop_scope(scope_lookup(scope));
-          prevScope = scope;
+          pop_scope(scope_lookup(cc->cgen.scope));
         }
         else{
           cGen(p1);
           cGen(p2);
         }
         
-        if(TraceCode) emitComment("<- Compound Stmt");
+        if(cc->TraceCode) emitComment("<- Compound Stmt");
         break;
       case IfK :
-         if (TraceCode) emitComment("-> if") ;
+         if (cc->TraceCode) emitComment("-> if") ;
          p1 = tree->child[0] ;
          p2 = tree->child[1] ;
          p3 = tree->child[2] ;
@@ -64,6 +71,7 @@ static void genStmt( TreeNode * tree)
          savedLoc1 = emitSkip(1) ;
          emitComment("if: jump to else belongs here");
          /* recurse on then part */
+         emitMark(emitSkip(0), "then", tree->lineno, NULL);
          cGen(p2);
          savedLoc2 = emitSkip(1) ;
          emitComment("if: jump to end belongs here");
@@ -72,48 +80,54 @@ static void genStmt( TreeNode * tree)
          emitRM_Abs("JEQ",ac,currentLoc,"if: jmp to else");
          emitRestore() ;
          /* recurse on else part */
+         if (p3 != NULL) emitMark(emitSkip(0), "else", tree->lineno, NULL);
          cGen(p3);
          currentLoc = emitSkip(0) ;
+         emitMark(emitSkip(0), "endif", tree->lineno, NULL);
          emitBackup(savedLoc2) ;
          emitRM_Abs("LDA",pc,currentLoc,"jmp to end") ;
          emitRestore() ;
-         if (TraceCode)  emitComment("<- if") ;
+         if (cc->TraceCode)  emitComment("<- if") ;
          break; /* if_k */
 
       case RetK:
-         if (TraceCode) emitComment("-> return");
+         if (cc->TraceCode) emitComment("-> return");
          p1 = tree->child[0];
+         if (isTailCall(p1)){
+           genTailCall(p1);
+           if (cc->TraceCode) emitComment("<- return");
+           break;
+         }
          cGen(p1);
-         Scope = scope_lookup(scope);
-         paramnum = Scope->paramNum;
-         varnum = Scope->varNum;
-         paramnum += varnum;
-         //param
-         while(paramnum!=0){
-          emitRM("LDA", sp, 1, sp, "move stack pointer +1 : return");
-          paramnum--;
-        }
-          //fp
-         emitRM("LD", fp, 1, sp,"restore old fp");
-         emitRM("LDA", sp, 1, sp, "move stack pointer +1");
-         //sp
-         emitRM("LDA", sp, 1, sp, "move stack pointer +1");
-         //pc
-         emitRM("LDA", sp, 1, sp, "move stack pointer +1");
-         emitRM("LD", pc, 0, sp, "restore pc");
-         
-         isReturned = TRUE;
-         if (TraceCode) emitComment("<- return");
+         if (tree != cc->cgen.lastStmt){
+           if (cc->cgen.retCount == cc->cgen.retMax){
+             cc->cgen.retMax = cc->cgen.retMax ? 2*cc->cgen.retMax : 16;
+             cc->cgen.retLocs = (int *) realloc(cc->cgen.retLocs, cc->cgen.retMax * sizeof(int));
+           }
+           cc->cgen.retLocs[cc->cgen.retCount++] = emitSkip(1);
+           emitComment("return: jump to epilogue belongs here");
+         }
+         if (cc->TraceCode) emitComment("<- return");
          break;
 
       case IterK:
-        if (TraceCode) emitComment("-> while") ;
+        if (cc->TraceCode) emitComment("-> while") ;
 
         p1 = tree->child[0];
         p2 = tree->child[1];
 
         savedLoc1 = emitSkip(0);
         emitComment("while: jump after body comes back here");
+        emitMark(emitSkip(0), "test", tree->lineno, NULL);
+
+        /* a constant true test needs no code */
+        if (p1->nodekind == ExpK && p1->kind.exp == ConstK
+            && p1->attr.val != 0){
+          cGen(p2);
+          emitRM_Abs("LDA",pc,savedLoc1,"while: jmp back to body");
+          if (cc->TraceCode)  emitComment("<- while") ;
+          break;
+        }
 
         /* generate code for test expression */
         cGen(p1);
@@ -122,6 +136,7 @@ static void genStmt( TreeNode * tree)
         emitComment("while: jump to end belongs here");
 
         /* generate code for body */
+        emitMark(emitSkip(0), "body", tree->lineno, NULL);
         cGen(p2);
         emitRM_Abs("LDA",pc,savedLoc1,"while: jmp back to test");
         /* backpatch */
@@ -129,35 +144,140 @@ static void genStmt( TreeNode * tree)
         emitBackup(savedLoc2);
         emitRM_Abs("JEQ",ac,currentLoc,"while: jmp to end");
         emitRestore();
-        if (TraceCode)  emitComment("<- while") ;
+        if (cc->TraceCode)  emitComment("<- while") ;
         break; /* repeat */
       default:
          break;
     }
 } /* genStmt */
 
-static void reverseTraverse(TreeNode * tree)
+/* Procedure reverseTraverse evaluates the arguments
+   last to first; argument i is stored at offset(sp)
+   with offset = n - i, its place in the new frame
+*/
+static void reverseTraverse(TreeNode * tree, int offset)
 {
   TreeNode * t;
   t= tree;
   if (t == NULL) return;
-  reverseTraverse(t->sibling);
+  reverseTraverse(t->sibling, offset-1);
   genExp(t,FALSE);
-  
-  emitRM("ST", ac, argOffset++, sp, "store arg in sp");
-  //emitRM("LDA", sp, -1, sp, "move stack pointer -1");
+
+  emitRM("ST", ac, offset, sp, "store arg in frame");
+}
+
+/* Function isParamRef returns TRUE if the argument
+   tree is parameter i of the current function, which
+   a tail call passes on in place
+*/
+static int isParamRef(TreeNode * tree, int i)
+{ ScopeList Scope = scope_lookup(cc->cgen.scope);
+  if (tree->nodekind != ExpK || tree->kind.exp != IdK) return FALSE;
+  if (i >= Scope->paramNum || st_lookup("temp", tree->attr.name) != i)
+    return FALSE;
+  return cc->symtab.scope_name != globalName;
+}
+
+/* Function isTailCall returns TRUE if the returned
+   tree is a call that may reuse the current frame:
+   not from main, and passing no local array of it
+*/
+static int isTailCall(TreeNode * tree)
+{ TreeNode * arg;
+  ScopeList Scope;
+  if (tree == NULL || tree->nodekind != ExpK || tree->kind.exp != CallK)
+    return FALSE;
+  if (cc->cgen.scope == mainName || tree->attr.name == mainName
+      || tree->attr.name == inputName
+      || tree->attr.name == outputName)
+    return FALSE;
+  Scope = scope_lookup(cc->cgen.scope);
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    if (arg->nodekind == ExpK && arg->kind.exp == IdK
+        && type_lookup(cc->cgen.scope, arg->attr.name) == IntegerArray
+        && st_lookup("temp", arg->attr.name) >= Scope->paramNum
+        && cc->symtab.scope_name != globalName)
+      return FALSE;
+  return TRUE;
+}
+
+/* Procedure tailTraverse evaluates the arguments of a
+   tail call last to first. With direct set there is
+   a single argument to store, and it goes straight to
+   its parameter slot; otherwise each goes to a temp
+   slot (counting down from *slot) until all are known
+*/
+static void tailTraverse(TreeNode * tree, int i, int direct, int * slot)
+{ if (tree == NULL) return;
+  tailTraverse(tree->sibling, i+1, direct, slot);
+  if (isParamRef(tree, i)) return;
+  genExp(tree, FALSE);
+  if (direct)
+    emitRM("ST", ac, -i, fp, "store arg in param slot");
+  else
+    emitRM("ST", ac, (*slot)--, sp, "store arg in temp");
+}
+
+/* Procedure tailCopy moves the temps written by
+   tailTraverse into the parameter slots
+*/
+static void tailCopy(TreeNode * tree, int i, int * slot)
+{ if (tree == NULL) return;
+  tailCopy(tree->sibling, i+1, slot);
+  if (isParamRef(tree, i)) return;
+  emitRM("LD", ac, (*slot)--, sp, "load arg from temp");
+  emitRM("ST", ac, -i, fp, "store arg in param slot");
+}
+
+/* Procedure genTailCall generates return f(...) by
+   overwriting the parameters of the current frame and
+   jumping past the prologue store of the return
+   address: f returns straight to our caller, and a
+   self tail call becomes a loop. The temps go below
+   the parameters of f as well as the current frame,
+   since f may take more parameters than the frame
+   holds.
+*/
+static void genTailCall( TreeNode * tree)
+{ TreeNode * arg;
+  char buffer[256];
+  int i, num = 0, slot, base;
+  if (cc->TraceCode) {
+    sprintf(buffer,"-> Tail call : %s", tree->attr.name);
+    emitComment(buffer);
+  }
+  for (arg = tree->child[0], i = 0; arg != NULL; arg = arg->sibling, i++)
+    if (!isParamRef(arg, i)) num++;
+  if (num == 1)
+    tailTraverse(tree->child[0], 0, TRUE, &slot);
+  else if (num > 1) {
+    base = scope_lookup(cc->cgen.scope)->frameSize;
+    if (scope_lookup(tree->attr.name)->paramNum > base)
+      base = scope_lookup(tree->attr.name)->paramNum;
+    emitRM("LDA", sp, -(base + num), fp, "reserve arg temps");
+    slot = num;
+    tailTraverse(tree->child[0], 0, FALSE, &slot);
+    slot = num;
+    tailCopy(tree->child[0], 0, &slot);
+  }
+  emitMark(emitSkip(0), "call", tree->lineno, tree->attr.name);
+  emitCall(getpl(tree->attr.name), 1, "tail call: jmp past prologue");
+  if (cc->TraceCode) {
+    sprintf(buffer,"<- Tail call : %s", tree->attr.name);
+    emitComment(buffer);
+  }
 }
 
 /* Procedure genExp generates code at an expression node */
 static void genExp( TreeNode * tree, int lhs)
-{ int loc, savedLoc, paramnum, currentLoc;
+{ int loc, argnum, paramnum, currentLoc, retBase, i;
   char buffer[256];
-  TreeNode * p1, * p2;
+  TreeNode * p1, * p2, * savedLast;
   ScopeList Scope;
   ExpType type;
   switch (tree->kind.exp) {
     case AssignK:
-      if(TraceCode) emitComment("-> Assign");
+      if(cc->TraceCode) emitComment("-> Assign");
       p1 = tree->child[0];
       p2 = tree->child[1];
       genExp(p1, TRUE);
@@ -168,69 +288,96 @@ static void genExp( TreeNode * tree, int lhs)
       emitRM("ST", ac, 0, ac1, "store value");
       emitRM("LDA", sp, 1, sp, "move stack pointer +1");
 
-      if(TraceCode) emitComment("<- Assign");
+      if(cc->TraceCode) emitComment("<- Assign");
       break;
     case CallK:
-      if(TraceCode) {
+      if(cc->TraceCode) {
         sprintf(buffer,"-> Call : %s", tree->attr.name);
         emitComment(buffer);
       }
-      loc = st_lookup("scope", tree->attr.name);
-      Scope = scope_lookup(tree->attr.name);
-      if(strcmp(tree->attr.name,"input")==0){
+      if(tree->attr.name == inputName){
           emitRO("IN", ac, 0, 0, "input value");
         }
       else{
         p1 = tree->child[0];
-        if((strcmp(tree->attr.name,"output")==0)) {
+        if(tree->attr.name == outputName) {
           cGen(p1);
           emitRO("OUT", ac, 0,0, "output value");
         }
         else {
-          argOffset = argOffset - Scope->paramNum + 1;
-          reverseTraverse(p1);
-          argOffset=-3;
-          //return address
-          savedLoc = emitSkip(0);
-          emitRM("LDC", ac1, savedLoc+10, 0,"return range");
-          emitRM("ST", ac1, 0, sp, "store return addr");
-          emitRM("LDA", sp, -1, sp, "move stack pointer -1");
-          emitRM("LDA", ac1, 0, sp, "current loc");
-          emitRM("ST", ac1, 0, sp, "store sp");
-          emitRM("LDA", sp, -1, sp, "move stack pointer -1");
-          emitRM("ST", fp, 0, sp, "store old fp");
-          emitRM("LDA", sp, -1, sp, "move stack pointer -1");
-          emitRM("LDA", fp, 0, sp, "move sp -> fp");
-          //emitRM("LDA", sp, -1, sp, "move stack pointer -1");
-          emitRM("LD", pc, loc, gp, "load func loc");
-          //emitRM("LD", pc, 0, ac, "store memloc in pc");
+          argnum = 0;
+          for (p2 = p1; p2 != NULL; p2 = p2->sibling) argnum++;
+          /* sp is lowered below the new frame first, so
+             temps and nested calls in the arguments
+             cannot overwrite the arguments stored */
+          if (argnum > 0)
+            emitRM("LDA", sp, -(argnum+2), sp, "reserve frame link and args");
+          reverseTraverse(p1, argnum);
+          if (argnum > 0){
+            emitRM("ST", fp, argnum+1, sp, "store old fp");
+            emitRM("LDA", fp, argnum, sp, "new fp");
+          }
+          else{
+            emitRM("ST", fp, -1, sp, "store old fp");
+            emitRM("LDA", fp, -2, sp, "new fp");
+          }
+          emitRM("LDA", ac1, 1, pc, "return addr");
+          emitMark(emitSkip(0), "call", tree->lineno, tree->attr.name);
+          emitCall(getpl(tree->attr.name), 0, "call: jmp to function");
         }
       }
-      if(TraceCode) {
+      if(cc->TraceCode) {
         sprintf(buffer,"<- Call : %s", tree->attr.name);
         emitComment(buffer);
       }
       break;
+    case InlineK:
+      if(cc->TraceCode) {
+        sprintf(buffer,"-> Inlined call : %s", tree->attr.name);
+        emitComment(buffer);
+      }
+      /* parameters, then the body; its returns jump
+         to the end of the body instead of the epilogue */
+      cGen(tree->child[0]);
+      savedLast = cc->cgen.lastStmt;
+      retBase = cc->cgen.retCount;
+      cc->cgen.lastStmt = tree->child[1]->child[1];
+      while(cc->cgen.lastStmt != NULL && cc->cgen.lastStmt->sibling != NULL)
+        cc->cgen.lastStmt = cc->cgen.lastStmt->sibling;
+      cGen(tree->child[1]);
+      currentLoc = emitSkip(0);
+      for(i=retBase; i<cc->cgen.retCount; i++){
+        emitBackup(cc->cgen.retLocs[i]);
+        emitRM_Abs("LDA", pc, currentLoc, "return: jmp to end of inlined call");
+      }
+      emitRestore();
+      cc->cgen.retCount = retBase;
+      cc->cgen.lastStmt = savedLast;
+      if(cc->TraceCode) {
+        sprintf(buffer,"<- Inlined call : %s", tree->attr.name);
+        emitComment(buffer);
+      }
+      break;
     case ConstK :
-      if (TraceCode) emitComment("-> Const") ;
+      if (cc->TraceCode) emitComment("-> Const") ;
       /* gen code to load integer constant using LDC */
       emitRM("LDC",ac,tree->attr.val,0,"load const");
-      if (TraceCode)  emitComment("<- Const") ;
+      if (cc->TraceCode)  emitComment("<- Const") ;
       break; /* ConstK */
     
     case IdK :
-      if (TraceCode) emitComment("-> Id") ;
-      Scope = scope_lookup(scope);
+      if (cc->TraceCode) emitComment("-> Id") ;
+      Scope = scope_lookup(cc->cgen.scope);
       paramnum = Scope->paramNum;
       loc = -st_lookup("temp",tree->attr.name);
-      type = type_lookup(scope, tree->attr.name);
+      type = type_lookup(cc->cgen.scope, tree->attr.name);
 
       if(lhs || type == IntegerArray){
-        if(strcmp(scope_name,"Global")==0){
+        if(cc->symtab.scope_name == globalName){
           emitRM("LDA", ac, -loc, gp, "store memloc in ac :Global");
         }
         else{
-          if(-loc<paramnum){
+          if(-loc<paramnum && type == IntegerArray){
             emitRM("LD", ac, loc, fp, "store arr addr in ac : Local param");
           }
           else
@@ -238,29 +385,29 @@ static void genExp( TreeNode * tree, int lhs)
         }
       }
       else{
-        if(strcmp(scope_name,"Global")==0){
+        if(cc->symtab.scope_name == globalName){
           emitRM("LD", ac, -loc, gp, "store memloc in ac :Global");
         }
         else{
           emitRM("LD", ac, loc, fp, "store memloc in ac :Local");
         }
       }
-      if (TraceCode)  emitComment("<- Id") ;
+      if (cc->TraceCode)  emitComment("<- Id") ;
       break; /* IdK */
 
     case ArrIdK :
-      if (TraceCode) emitComment("-> ArrId");
+      if (cc->TraceCode) emitComment("-> ArrId");
       p1 = tree->child[0];
 
       cGen(p1);
-      Scope = scope_lookup(scope);
+      Scope = scope_lookup(cc->cgen.scope);
       paramnum = Scope->paramNum;
       loc = st_lookup("temp", tree->attr.name);
       currentLoc = emitSkip(0);
       
       emitRM("LDC", ac1, loc, 0,"load loc");
       if(lhs){
-        if(strcmp(scope_name,"Global")==0){
+        if(cc->symtab.scope_name == globalName){
           emitRO("SUB", ac, ac1, ac, "sub array offset");
           emitRO("ADD", ac, ac, gp, "add arr loc gp, store");
         }
@@ -276,7 +423,7 @@ static void genExp( TreeNode * tree, int lhs)
         }
       }
       else{
-        if(strcmp(scope_name,"Global")==0){
+        if(cc->symtab.scope_name == globalName){
           emitRO("SUB", ac1, ac1, ac, "add offset loc");
           emitRO("ADD", ac1, ac1, gp, "add arr loc gp");
           emitRM("LD", ac, 0, ac1, "store memloc in ac :Global");
@@ -296,10 +443,10 @@ static void genExp( TreeNode * tree, int lhs)
         }
       }
       
-      if (TraceCode) emitComment("<- ArrId");
+      if (cc->TraceCode) emitComment("<- ArrId");
       break;
     case OpK :
-         if (TraceCode) emitComment("-> Op") ;
+         if (cc->TraceCode) emitComment("-> Op") ;
          p1 = tree->child[0];
          p2 = tree->child[1];
          /* gen code for ac = left arg */
@@ -371,7 +518,7 @@ static void genExp( TreeNode * tree, int lhs)
                emitComment("BUG: Unknown operator");
                break;
          } /* case op */
-         if (TraceCode)  emitComment("<- Op") ;
+         if (cc->TraceCode)  emitComment("<- Op") ;
          break; /* OpK */
 
     default:
@@ -383,73 +530,56 @@ static void genDecl(TreeNode * tree)
 {
   TreeNode * p1, * p2;
   ScopeList Scope;
-  int paramnum, varnum;
-  int loc;
-  int currentLoc, savedLoc1;
+  int i, isMain;
+  int currentLoc;
   char buffer[100];
   switch(tree->kind.decl)
   {
     case FuncK:
-      if(TraceCode) {
+      if(cc->TraceCode) {
         sprintf(buffer,"-> Func Decl : %s", tree->attr.name);
         emitComment(buffer);
       }
-      isinFunc = TRUE;
-      isReturned = FALSE;
-      scope = tree->attr.name;
-      Scope = scope_lookup(scope);
-      varnum = Scope->varNum;
-      loc = st_lookup(scope, tree->attr.name);
-      emitRM("LDA", ac, 2, pc, "pc+2");
-      emitRM("ST", ac, loc, gp, "load function");
-      if(strcmp(tree->attr.name, "main")!=0)
-        savedLoc1 = emitSkip(1);
-      
-      p1 = tree->child[1]; 
-      //body
-      while(varnum!=0){
-        emitRM("LDA", sp, -1, sp, "move stack pointer -1 : var");
-        varnum--;
-      }
-      p2 = tree->child[2];
+      cc->cgen.isinFunc = TRUE;
+      cc->cgen.scope = tree->attr.name;
+      Scope = scope_lookup(cc->cgen.scope);
+      isMain = tree->attr.name == mainName;
+      getpl(tree->attr.name)->entry = emitSkip(0);
 
+      p1 = tree->child[1];
+      p2 = tree->child[2];
+      //prologue
+      if(!isMain)
+        emitRM("ST", ac1, 2, fp, "store return addr");
+      emitRM("LDA", sp, -Scope->frameSize, fp, "reserve frame : params, vars");
+      cc->cgen.lastStmt = p2->child[1];
+      while(cc->cgen.lastStmt != NULL && cc->cgen.lastStmt->sibling != NULL)
+        cc->cgen.lastStmt = cc->cgen.lastStmt->sibling;
+      cc->cgen.retCount = 0;
+      //body
       cGen(p1);
       cGen(p2);
-      if(TraceCode) {
-        paramOffset = 0;
+      /* all returns share one epilogue */
+      currentLoc = emitSkip(0);
+      for(i=0; i<cc->cgen.retCount; i++){
+        emitBackup(cc->cgen.retLocs[i]);
+        emitRM_Abs("LDA", pc, currentLoc, "return: jmp to epilogue");
+      }
+      emitRestore();
+      if(cc->TraceCode) {
         sprintf(buffer,"<- Func Decl : %s", tree->attr.name);
         emitComment(buffer);
       }
-      if(strcmp(tree->attr.name, "main")==0)
+      if(isMain){
+        emitComment("End of execution.");
+        emitRO("HALT",0,0,0,"");
         break;
-      if (!isReturned){
-          if(TraceCode) emitComment("-> Void return");
-            Scope = scope_lookup(prevScope);
-           paramnum = Scope->paramNum;
-           varnum = Scope->varNum;
-           paramnum += varnum;
-           //param
-           while(paramnum!=0){
-            emitRM("LDA", sp, 1, sp, "move stack pointer +1 : return");
-            paramnum--;
-          }
-           //param
-            //fp
-           emitRM("LD", fp, 1, sp,"restore old fp");
-           emitRM("LDA", sp, 1, sp, "move stack pointer +1");
-           //sp
-           emitRM("LDA", sp, 1, sp, "move stack pointer +1");
-           //pc
-           emitRM("LDA", sp, 1, sp, "move stack pointer +1");
-           emitRM("LD", pc, 0, sp, "restore pc");
-           if(TraceCode) emitComment("<- Void return");
-           isReturned=TRUE;
-        }
-      currentLoc = emitSkip(0);
-      emitBackup(savedLoc1);
-      // write
-      emitRM("LDC", pc, currentLoc, 0,"jump to function end");
-      emitRestore();
+      }
+      if(cc->TraceCode) emitComment("-> epilogue");
+      emitRM("LDA", sp, 2, fp, "release frame");
+      emitRM("LD", fp, -1, sp, "restore old fp");
+      emitRM("LD", pc, 0, sp, "restore pc");
+      if(cc->TraceCode) emitComment("<- epilogue");
       break;
     default:
       break;
@@ -462,11 +592,8 @@ static void genParam(TreeNode * tree)
   {
     case NonArrParamK:
     case ArrParamK:
-      if(TraceCode) emitComment("-> param");
-      emitRM("LDA", sp, -1, sp, "move stack pointer -1 : param");
-      paramOffset++;
+      /* the slot is part of the frame reserved above */
       emitComment(tree->attr.name);
-      if(TraceCode) emitComment("<- param");
       return;
       break;
     default:
@@ -509,7 +636,9 @@ static void cGen( TreeNode * tree)
  * file name as a comment in the code file
  */
 void codeGen(TreeNode * syntaxTree, char * codefile)
-{  char * s = malloc(strlen(codefile)+7);
+{  FuncParam mainpl = getpl(mainName);
+   TreeNode * t;
+   char * s= malloc(strlen(codefile)+7);
    strcpy(s,"File: ");
    strcat(s,codefile);
    emitComment("TINY Compilation to TM Code");
@@ -520,10 +649,25 @@ void codeGen(TreeNode * syntaxTree, char * codefile)
    emitRM("ST",ac,0,ac,"clear location 0");
    emitRM("LDA",fp,0,sp,"sp->fp");
    emitComment("End of standard prelude.");
+   if (mainpl != NULL)
+     emitCall(mainpl, 0, "jump to main");
+   else {
+     emitComment("End of execution.");
+     emitRO("HALT",0,0,0,"no main");
+   }
    /* generate code for TINY program */
-   scope="Global";
-   cGen(syntaxTree);
-   /* finish */
-   emitComment("End of execution.");
-   emitRO("HALT",0,0,0,"");
+   cc->cgen.scope=globalName;
+   if (!cc->Incremental) cGen(syntaxTree);
+   /* only functions make code; one kept is placed */
+   else for (t = syntaxTree; t != NULL; t = t->sibling) {
+     if (t->nodekind != DeclK || t->kind.decl != FuncK) continue;
+     if (keptCode(t) != NULL) placeCode(t);
+     else {
+       beginCode(t);
+       genDecl(t);
+       endCode(t);
+     }
+   }
+   /* link: patch the calls to functions placed later */
+   emitCallFixups();
 }
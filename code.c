@@ -7,21 +7,126 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "code.h"
+#include "context.h"
 
-/* TM location number for current instruction emission */
-static int emitLoc = 0 ;
+/* The emitter keeps its state in cc->emit: emitLoc
+   is the TM location number for current instruction
+   emission, and highEmitLoc the highest location
+   emitted so far, for use in conjunction with
+   emitSkip, emitBackup, and emitRestore */
 
-/* Highest TM location emitted so far
-   For use in conjunction with emitSkip,
-   emitBackup, and emitRestore */
-static int highEmitLoc = 0;
+/* callFixups holds the locations of calls emitted
+   before their callee was placed */
+typedef struct CallFixupRec
+{ int loc;
+  int offset; /* from the callee entry */
+  FuncParam callee;
+} CallFixup;
+
+/* While buffering, instructions are kept in tmCode,
+   indexed by location, and comments in tmNote until
+   emitFlush writes them, so that peephole may rewrite
+   the code first; TmInst, TmNote and TmMark are in
+   code.h. */
+
+/* Procedure bufferInst stores an instruction at
+ * emitLoc while buffering; td is the 2nd source
+ * register of an RO instruction, the offset of an RM
+ */
+static void bufferInst(TmKind kind, char * op, int r, int s, int td,
+                       int target, char * c)
+{ TmInst * i;
+  if (cc->emit.emitLoc >= cc->emit.tmMax)
+  { int m = cc->emit.tmMax ? 2*cc->emit.tmMax : 256;
+    while (m <= cc->emit.emitLoc) m *= 2;
+    cc->emit.tmCode = (TmInst *) realloc(cc->emit.tmCode, m * sizeof(TmInst));
+    for (; cc->emit.tmMax < m; cc->emit.tmMax++) cc->emit.tmCode[cc->emit.tmMax].kind = TmHole;
+  }
+  i = &cc->emit.tmCode[cc->emit.emitLoc];
+  i->kind = kind;
+  i->op = op;
+  i->r = r;
+  i->s = s;
+  i->t = kind == TmRO ? td : 0;
+  i->d = kind == TmRM ? td : 0;
+  i->target = target;
+  i->callee = NULL;
+  i->comment = cc->TraceCode ? copyString(c) : NULL;
+}
+
+/* Procedure tagCall records that the instruction
+ * buffered at loc jumps into callee
+ */
+static void tagCall(int loc, FuncParam callee)
+{ if (cc->emit.buffering) cc->emit.tmCode[loc].callee = callee; }
+
+/* Procedure addFixup leaves a hole at emitLoc for a
+ * jump to callee + offset, filled by emitCallFixups
+ */
+static void addFixup(FuncParam callee, int offset)
+{ if (cc->emit.fixupCount == cc->emit.fixupMax){
+    cc->emit.fixupMax = cc->emit.fixupMax ? 2*cc->emit.fixupMax : 16;
+    cc->emit.callFixups = (CallFixup *) realloc(cc->emit.callFixups, cc->emit.fixupMax * sizeof(CallFixup));
+  }
+  cc->emit.callFixups[cc->emit.fixupCount].loc = emitSkip(1);
+  cc->emit.callFixups[cc->emit.fixupCount].offset = offset;
+  cc->emit.callFixups[cc->emit.fixupCount].callee = callee;
+  cc->emit.fixupCount++;
+}
 
 /* Procedure emitComment prints a comment line 
  * with comment c in the code file
  */
 void emitComment( char * c )
-{ if (TraceCode) fprintf(code,"* %s\n",c);}
+{ if (!cc->TraceCode) return;
+  if (!cc->emit.buffering)
+  { fprintf(cc->code,"* %s\n",c);
+    return;
+  }
+  if (cc->emit.noteCount == cc->emit.noteMax)
+  { cc->emit.noteMax = cc->emit.noteMax ? 2*cc->emit.noteMax : 64;
+    cc->emit.tmNote = (TmNote *) realloc(cc->emit.tmNote, cc->emit.noteMax * sizeof(TmNote));
+  }
+  cc->emit.tmNote[cc->emit.noteCount].loc = cc->emit.emitLoc;
+  cc->emit.tmNote[cc->emit.noteCount].seq = cc->emit.noteCount;
+  cc->emit.tmNote[cc->emit.noteCount].text = copyString(c);
+  cc->emit.noteCount++;
+}
+
+/* Procedure emitMark records in the debug map that
+ * construct kind of line starts at location loc
+ */
+void emitMark( int loc, char * kind, int line, char * name)
+{ if (!cc->DebugMap) return;
+  if (cc->emit.markCount == cc->emit.markMax)
+  { cc->emit.markMax = cc->emit.markMax ? 2*cc->emit.markMax : 64;
+    cc->emit.tmMark = (TmMark *) realloc(cc->emit.tmMark, cc->emit.markMax * sizeof(TmMark));
+  }
+  cc->emit.tmMark[cc->emit.markCount].loc = loc;
+  cc->emit.tmMark[cc->emit.markCount].kind = kind;
+  cc->emit.tmMark[cc->emit.markCount].line = line;
+  cc->emit.tmMark[cc->emit.markCount].name = name;
+  cc->emit.markCount++;
+}
+
+/* Procedure emitMap writes the debug map to mapfile */
+void emitMap( char * mapfile)
+{ FILE * map = fopen(mapfile, "w");
+  int k;
+  if (map == NULL)
+  { fprintf(stderr,"Unable to open %s\n",mapfile);
+    return;
+  }
+  for (k = 0; k < cc->emit.markCount; k++)
+    fprintf(map,"%d %s %d %s\n",cc->emit.tmMark[k].loc,cc->emit.tmMark[k].kind,
+            cc->emit.tmMark[k].line,cc->emit.tmMark[k].name != NULL ? cc->emit.tmMark[k].name : "-");
+  fclose(map);
+  free(cc->emit.tmMark);
+  cc->emit.tmMark = NULL;
+  cc->emit.markCount = cc->emit.markMax = 0;
+}
 
 /* Procedure emitRO emits a register-only
  * TM instruction
@@ -32,10 +137,15 @@ void emitComment( char * c )
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRO( char *op, int r, int s, int t, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d,%d ",emitLoc++,op,r,s,t);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+{ if (cc->emit.buffering)
+  { bufferInst(TmRO,op,r,s,t,-1,c);
+    if (cc->emit.highEmitLoc < ++cc->emit.emitLoc) cc->emit.highEmitLoc = cc->emit.emitLoc ;
+    return;
+  }
+  fprintf(cc->code,"%3d:  %5s  %d,%d,%d ",cc->emit.emitLoc++,op,r,s,t);
+  if (cc->TraceCode) fprintf(cc->code,"\t%s",c) ;
+  fprintf(cc->code,"\n") ;
+  if (cc->emit.highEmitLoc < cc->emit.emitLoc) cc->emit.highEmitLoc = cc->emit.emitLoc ;
 } /* emitRO */
 
 /* Procedure emitRM emits a register-to-memory
@@ -47,10 +157,15 @@ void emitRO( char *op, int r, int s, int t, char *c)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM( char * op, int r, int d, int s, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",emitLoc++,op,r,d,s);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+{ if (cc->emit.buffering)
+  { bufferInst(TmRM,op,r,s,d,s == pc ? cc->emit.emitLoc+1+d : -1,c);
+    if (cc->emit.highEmitLoc < ++cc->emit.emitLoc) cc->emit.highEmitLoc = cc->emit.emitLoc ;
+    return;
+  }
+  fprintf(cc->code,"%3d:  %5s  %d,%d(%d) ",cc->emit.emitLoc++,op,r,d,s);
+  if (cc->TraceCode) fprintf(cc->code,"\t%s",c) ;
+  fprintf(cc->code,"\n") ;
+  if (cc->emit.highEmitLoc < cc->emit.emitLoc)  cc->emit.highEmitLoc = cc->emit.emitLoc ;
 } /* emitRM */
 
 /* Function emitSkip skips "howMany" code
@@ -58,9 +173,9 @@ void emitRM( char * op, int r, int d, int s, char *c)
  * returns the current code position
  */
 int emitSkip( int howMany)
-{  int i = emitLoc;
-   emitLoc += howMany ;
-   if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+{  int i = cc->emit.emitLoc;
+   cc->emit.emitLoc += howMany ;
+   if (cc->emit.highEmitLoc < cc->emit.emitLoc)  cc->emit.highEmitLoc = cc->emit.emitLoc ;
    return i;
 } /* emitSkip */
 
@@ -68,8 +183,8 @@ int emitSkip( int howMany)
  * loc = a previously skipped location
  */
 void emitBackup( int loc)
-{ if (loc > highEmitLoc) emitComment("BUG in emitBackup");
-  emitLoc = loc ;
+{ if (loc > cc->emit.highEmitLoc) emitComment("BUG in emitBackup");
+  cc->emit.emitLoc = loc ;
 } /* emitBackup */
 
 /* Procedure emitRestore restores the current 
@@ -77,7 +192,7 @@ void emitBackup( int loc)
  * unemitted position
  */
 void emitRestore(void)
-{ emitLoc = highEmitLoc;}
+{ cc->emit.emitLoc = cc->emit.highEmitLoc;}
 
 /* Procedure emitRM_Abs converts an absolute reference 
  * to a pc-relative reference when emitting a
@@ -88,10 +203,444 @@ void emitRestore(void)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM_Abs( char *op, int r, int a, char * c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",
-               emitLoc,op,r,a-(emitLoc+1),pc);
-  ++emitLoc ;
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+{ if (cc->emit.buffering)
+  { bufferInst(TmRM,op,r,pc,a-(cc->emit.emitLoc+1),a,c);
+    if (cc->emit.highEmitLoc < ++cc->emit.emitLoc) cc->emit.highEmitLoc = cc->emit.emitLoc ;
+    return;
+  }
+  fprintf(cc->code,"%3d:  %5s  %d,%d(%d) ",
+               cc->emit.emitLoc,op,r,a-(cc->emit.emitLoc+1),pc);
+  ++cc->emit.emitLoc ;
+  if (cc->TraceCode) fprintf(cc->code,"\t%s",c) ;
+  fprintf(cc->code,"\n") ;
+  if (cc->emit.highEmitLoc < cc->emit.emitLoc) cc->emit.highEmitLoc = cc->emit.emitLoc ;
 } /* emitRM_Abs */
+
+/* Procedure emitCall emits a direct jump to the
+ * entry of callee + offset, or leaves a hole for
+ * it if callee is not placed yet
+ */
+void emitCall( FuncParam callee, int offset, char * c)
+{ if (callee->entry >= 0)
+  { emitRM_Abs("LDA", pc, callee->entry + offset, c);
+    tagCall(cc->emit.emitLoc - 1, callee);
+  }
+  else {
+    addFixup(callee, offset);
+    emitComment("call: jump to function belongs here");
+  }
+} /* emitCall */
+
+/* Procedure emitCallFixups fills the holes left by
+ * emitCall, once every function has its entry
+ */
+void emitCallFixups(void)
+{ int i;
+  for (i = 0; i < cc->emit.fixupCount; i++)
+  { emitBackup(cc->emit.callFixups[i].loc);
+    emitRM_Abs("LDA",pc,cc->emit.callFixups[i].callee->entry+cc->emit.callFixups[i].offset,
+               "call: jmp to function");
+    tagCall(cc->emit.callFixups[i].loc, cc->emit.callFixups[i].callee);
+  }
+  emitRestore();
+} /* emitCallFixups */
+
+/**************************************************/
+/***********   Buffered code              *********/
+/**************************************************/
+
+/* Procedure emitBuffer makes the emitting procedures
+ * keep the code until emitFlush
+ */
+void emitBuffer(void)
+{ cc->emit.buffering = TRUE; }
+
+/* Function noteOrder sorts comments by location,
+ * keeping the order of emission within one location
+ */
+static int noteOrder(const void * a, const void * b)
+{ const TmNote * x = (const TmNote *) a, * y = (const TmNote *) b;
+  if (x->loc != y->loc) return x->loc - y->loc;
+  return x->seq - y->seq;
+}
+
+/* Procedure emitFlush writes the buffered code to
+ * the code file in location order
+ */
+void emitFlush(void)
+{ int loc, k = 0;
+  TmInst * i;
+  if (!cc->emit.buffering) return;
+  qsort(cc->emit.tmNote, cc->emit.noteCount, sizeof(TmNote), noteOrder);
+  for (loc = 0; loc <= cc->emit.highEmitLoc; loc++)
+  { for (; k < cc->emit.noteCount && cc->emit.tmNote[k].loc <= loc; k++)
+    { fprintf(cc->code,"* %s\n",cc->emit.tmNote[k].text);
+      free(cc->emit.tmNote[k].text);
+    }
+    if (loc == cc->emit.highEmitLoc) break;
+    i = &cc->emit.tmCode[loc];
+    if (i->kind == TmRO)
+      fprintf(cc->code,"%3d:  %5s  %d,%d,%d ",loc,i->op,i->r,i->s,i->t);
+    else if (i->kind == TmRM)
+      fprintf(cc->code,"%3d:  %5s  %d,%d(%d) ",loc,i->op,i->r,
+              i->target >= 0 ? i->target-(loc+1) : i->d,i->s);
+    else continue;
+    if (cc->TraceCode) fprintf(cc->code,"\t%s",i->comment) ;
+    fprintf(cc->code,"\n") ;
+    free(i->comment);
+  }
+  free(cc->emit.tmCode);
+  free(cc->emit.tmNote);
+  cc->emit.tmCode = NULL;
+  cc->emit.tmNote = NULL;
+  cc->emit.tmMax = cc->emit.noteCount = cc->emit.noteMax = 0;
+  cc->emit.buffering = FALSE;
+} /* emitFlush */
+
+/* Function emitCount returns the number of buffered
+ * instructions, and in *dynamic that number weighted
+ * by 10 for each loop around an instruction, up to 4
+ */
+int emitCount(long * dynamic)
+{ int * depth = (int *) calloc(cc->emit.highEmitLoc + 1, sizeof(int));
+  int loc, count = 0, d, k;
+  long w;
+  TmInst * i;
+  for (loc = 0; loc < cc->emit.highEmitLoc; loc++)
+  { i = &cc->emit.tmCode[loc];
+    if (i->kind == TmRM && i->target >= 0 && i->target <= loc)
+    { depth[i->target]++;
+      depth[loc+1]--;
+    }
+  }
+  *dynamic = 0;
+  for (loc = 0, d = 0; loc < cc->emit.highEmitLoc; loc++)
+  { d += depth[loc];
+    if (cc->emit.tmCode[loc].kind == TmHole) continue;
+    count++;
+    for (k = 0, w = 1; k < d && k < 4; k++) w *= 10;
+    *dynamic += w;
+  }
+  free(depth);
+  return count;
+}
+
+/**************************************************/
+/***********   Pieces of code             *********/
+/**************************************************/
+
+/* Procedure emitSpot records in s the next location
+ * and the comments and marks buffered so far
+ */
+void emitSpot(TmSpot * s)
+{ s->loc = cc->emit.emitLoc;
+  s->note = cc->emit.noteCount;
+  s->mark = cc->emit.markCount;
+}
+
+/* Function emitCut copies the code buffered between
+ * spots from and to into piece, or returns FALSE if
+ * it jumps out of itself other than by a call
+ */
+int emitCut(TmSpot * from, TmSpot * to, int line, TmPiece * piece)
+{ TmInst * i, * p;
+  int k;
+  piece->ninst = to->loc - from->loc;
+  piece->nnote = to->note - from->note;
+  piece->nmark = to->mark - from->mark;
+  piece->inst = (TmInst *) malloc((piece->ninst + 1) * sizeof(TmInst));
+  piece->note = (TmNote *) malloc((piece->nnote + 1) * sizeof(TmNote));
+  piece->mark = (TmMark *) malloc((piece->nmark + 1) * sizeof(TmMark));
+  for (k = 0; k < piece->ninst; k++)
+  { i = &cc->emit.tmCode[from->loc + k];
+    p = &piece->inst[k];
+    *p = *i;
+    p->comment = NULL;
+    if (i->kind == TmHole) break;
+    if (i->callee != NULL) p->target = i->target - i->callee->entry;
+    else if (i->target >= 0)
+    { if (i->target < from->loc || i->target > to->loc) break;
+      p->target = i->target - from->loc;
+    }
+    p->comment = copyString(i->comment);
+  }
+  if (k < piece->ninst)
+  { piece->ninst = k;
+    piece->nnote = piece->nmark = 0;
+    return FALSE;
+  }
+  for (k = 0; k < piece->nnote; k++)
+  { piece->note[k] = cc->emit.tmNote[from->note + k];
+    piece->note[k].loc -= from->loc;
+    piece->note[k].text = copyString(piece->note[k].text);
+  }
+  for (k = 0; k < piece->nmark; k++)
+  { piece->mark[k] = cc->emit.tmMark[from->mark + k];
+    piece->mark[k].loc -= from->loc;
+    piece->mark[k].line -= line;
+  }
+  return TRUE;
+}
+
+/* Procedure emitPiece buffers piece at the next
+ * location, linking its calls as emitCall does
+ */
+void emitPiece(TmPiece * piece, int line)
+{ int start = cc->emit.emitLoc, k;
+  TmInst * p;
+  for (k = 0; k < piece->nnote; k++)
+  { cc->emit.emitLoc = start + piece->note[k].loc;
+    emitComment(piece->note[k].text);
+  }
+  for (k = 0; k < piece->nmark; k++)
+    emitMark(start + piece->mark[k].loc, piece->mark[k].kind,
+             line + piece->mark[k].line, piece->mark[k].name);
+  for (k = 0; k < piece->ninst; k++)
+  { p = &piece->inst[k];
+    cc->emit.emitLoc = start + k;
+    if (p->kind == TmHole)
+      emitSkip(1);
+    else if (p->callee != NULL && p->callee->entry < 0)
+      addFixup(p->callee, p->target);
+    else
+    { bufferInst(p->kind, p->op, p->r, p->s, p->kind == TmRO ? p->t : p->d,
+                 p->callee != NULL ? p->callee->entry + p->target
+                   : p->target >= 0 ? start + p->target : -1, p->comment);
+      if (p->target >= 0 && p->s == pc)
+        cc->emit.tmCode[start + k].d = cc->emit.tmCode[start + k].target - (start + k + 1);
+      tagCall(start + k, p->callee);
+      emitSkip(1);
+    }
+  }
+  cc->emit.emitLoc = start + piece->ninst;
+}
+
+/* Procedure freePiece releases what emitCut made */
+void freePiece(TmPiece * piece)
+{ int k;
+  for (k = 0; k < piece->ninst; k++) free(piece->inst[k].comment);
+  for (k = 0; k < piece->nnote; k++) free(piece->note[k].text);
+  free(piece->inst);
+  free(piece->note);
+  free(piece->mark);
+}
+
+/**************************************************/
+/***********   Peephole optimizer         *********/
+/**************************************************/
+
+/* every register but pc */
+#define ALLREGS 0x7f
+
+/* Function isOp returns TRUE if i is an instruction
+ * with opcode op
+ */
+static int isOp(TmInst * i, char * op)
+{ return i->kind != TmHole && strcmp(i->op, op) == 0; }
+
+/* Function isBranch returns TRUE if i is a
+ * conditional jump
+ */
+static int isBranch(TmInst * i)
+{ return i->kind == TmRM && i->op[0] == 'J'; }
+
+/* Function isGoto returns TRUE if i jumps to a known
+ * location unconditionally
+ */
+static int isGoto(TmInst * i)
+{ return isOp(i, "LDA") && i->r == pc && i->s == pc; }
+
+/* Function regsOf returns the set of registers i
+ * reads, and in *def those it writes
+ */
+static int regsOf(TmInst * i, int * def)
+{ int use = 0;
+  *def = 0;
+  if (i->kind == TmRO)
+  { if (isOp(i, "IN")) *def = 1 << i->r;
+    else if (isOp(i, "OUT")) use = 1 << i->r;
+    else if (!isOp(i, "HALT"))
+    { use = 1 << i->s | 1 << i->t;
+      *def = 1 << i->r;
+    }
+  }
+  else if (i->kind == TmRM)
+  { if (isOp(i, "ST") || isBranch(i)) use = 1 << i->r | 1 << i->s;
+    else if (isOp(i, "LDC")) *def = 1 << i->r;
+    else
+    { use = 1 << i->s;
+      *def = 1 << i->r;
+    }
+  }
+  *def &= ALLREGS;
+  return use & ALLREGS;
+}
+
+/* Procedure findLive fills liveOut with the registers
+ * whose value may still be read after each location.
+ * Jumps through a register, such as returns, may go
+ * anywhere, so every register is live at them.
+ */
+static void findLive(int n, int * liveOut)
+{ int * liveIn = (int *) calloc(n + 1, sizeof(int));
+  int loc, changed, out, use, def, next;
+  TmInst * i;
+  liveIn[n] = ALLREGS;
+  do
+  { changed = FALSE;
+    for (loc = n - 1; loc >= 0; loc--)
+    { i = &cc->emit.tmCode[loc];
+      next = liveIn[loc+1];
+      if (i->kind == TmHole) out = ALLREGS;
+      else if (isOp(i, "HALT")) out = 0;
+      else if (i->kind == TmRM && i->r == pc && !isBranch(i))
+        out = isGoto(i) && i->target <= n ? liveIn[i->target] : ALLREGS;
+      else if (isBranch(i))
+        out = next | (i->s == pc && i->target <= n ?
+                      liveIn[i->target] : ALLREGS);
+      else out = next;
+      use = regsOf(i, &def);
+      liveOut[loc] = out;
+      out = use | (out & ~def);
+      if (out != liveIn[loc])
+      { liveIn[loc] = out;
+        changed = TRUE;
+      }
+    }
+  } while (changed);
+  free(liveIn);
+}
+
+/* Function invertBranch returns the jump taken
+ * exactly when op is not
+ */
+static char * invertBranch(char * op)
+{ static char * pairs[][2] =
+  { {"JLT","JGE"}, {"JGE","JLT"}, {"JLE","JGT"},
+    {"JGT","JLE"}, {"JEQ","JNE"}, {"JNE","JEQ"} };
+  int k;
+  for (k = 0; k < 6; k++)
+    if (strcmp(op, pairs[k][0]) == 0) return pairs[k][1];
+  return NULL;
+}
+
+/* Procedure compact drops the deleted instructions
+ * and moves jump targets, comments and marks
+ * along; a deleted location stands for the next
+ * one kept
+ */
+static void compact(char * del)
+{ int * newLoc = (int *) malloc((cc->emit.highEmitLoc + 1) * sizeof(int));
+  int loc, n = 0;
+  for (loc = 0; loc < cc->emit.highEmitLoc; loc++)
+  { newLoc[loc] = n;
+    if (!del[loc]) cc->emit.tmCode[n++] = cc->emit.tmCode[loc];
+    else free(cc->emit.tmCode[loc].comment);
+  }
+  newLoc[cc->emit.highEmitLoc] = n;
+  for (loc = 0; loc < n; loc++)
+    if (cc->emit.tmCode[loc].target >= 0 && cc->emit.tmCode[loc].target <= cc->emit.highEmitLoc)
+      cc->emit.tmCode[loc].target = newLoc[cc->emit.tmCode[loc].target];
+  for (loc = 0; loc < cc->emit.noteCount; loc++)
+    cc->emit.tmNote[loc].loc = newLoc[cc->emit.tmNote[loc].loc];
+  for (loc = 0; loc < cc->emit.markCount; loc++)
+    cc->emit.tmMark[loc].loc = newLoc[cc->emit.tmMark[loc].loc];
+  for (loc = n; loc < cc->emit.highEmitLoc; loc++) cc->emit.tmCode[loc].kind = TmHole;
+  cc->emit.emitLoc = cc->emit.highEmitLoc = n;
+  free(newLoc);
+}
+
+/* Function peepRound makes one pass of the peephole
+ * rules over the buffered code and returns the
+ * number of rewrites
+ */
+static int peepRound(void)
+{ int n = cc->emit.highEmitLoc;
+  char * label = (char *) calloc(n + 1, 1);
+  char * del = (char *) calloc(n + 1, 1);
+  int * liveOut = (int *) malloc((n + 1) * sizeof(int));
+  int loc, t, k, def, count = 0;
+  TmInst * i, * j;
+  for (loc = 0; loc < n; loc++)
+    if (cc->emit.tmCode[loc].kind == TmRM && cc->emit.tmCode[loc].target >= 0
+        && cc->emit.tmCode[loc].target <= n)
+      label[cc->emit.tmCode[loc].target] = TRUE;
+  findLive(n, liveOut);
+  for (loc = 0; loc < n; loc++)
+  { i = &cc->emit.tmCode[loc];
+    if (del[loc] || i->kind == TmHole) continue;
+    /* the instruction after i, unless reached otherwise */
+    j = loc + 1 < n && !label[loc+1] && cc->emit.tmCode[loc+1].kind != TmHole ?
+        &cc->emit.tmCode[loc+1] : NULL;
+    /* a jump to a goto goes straight to its target */
+    if ((isGoto(i) || (isBranch(i) && i->s == pc)) && i->target < n)
+    { t = i->target;
+      for (k = 0; k < 8 && t < n && isGoto(&cc->emit.tmCode[t])
+                  && cc->emit.tmCode[t].target != t; k++)
+        t = cc->emit.tmCode[t].target;
+      if (t != i->target)
+      { i->target = t;
+        count++;
+      }
+    }
+    /* LDA r,0(r) and a jump to the next location do nothing */
+    if ((isOp(i, "LDA") && i->r == i->s && i->d == 0 && i->r != pc)
+        || ((isGoto(i) || (isBranch(i) && i->s == pc))
+            && i->target == loc + 1))
+    { del[loc] = TRUE;
+      count++;
+      continue;
+    }
+    /* a result nobody reads */
+    regsOf(i, &def);
+    if ((isOp(i, "LDA") || isOp(i, "LDC") || isOp(i, "ADD")
+         || isOp(i, "SUB") || isOp(i, "MUL"))
+        && i->r != pc && (liveOut[loc] & def) == 0)
+    { del[loc] = TRUE;
+      count++;
+      continue;
+    }
+    if (j == NULL) continue;
+    /* a branch over a goto: branch the other way */
+    if (isBranch(i) && i->s == pc && i->target == loc + 2 && isGoto(j)
+        && invertBranch(i->op) != NULL)
+    { i->op = invertBranch(i->op);
+      i->target = j->target;
+      del[loc+1] = TRUE;
+      count++;
+      continue;
+    }
+    /* a result computed in a only to be moved to b */
+    if (def != 0 && i->r != pc && isOp(j, "LDA") && j->s == i->r
+        && j->d == 0 && j->r != pc && j->r != j->s
+        && (liveOut[loc+1] & def) == 0)
+    { i->r = j->r;
+      del[loc+1] = TRUE;
+      count++;
+      continue;
+    }
+    /* a load of the word just stored from the same register */
+    if (isOp(i, "ST") && isOp(j, "LD") && i->r == j->r && i->s == j->s
+        && i->d == j->d && i->s != pc)
+    { del[loc+1] = TRUE;
+      count++;
+    }
+  }
+  compact(del);
+  free(label);
+  free(del);
+  free(liveOut);
+  return count;
+}
+
+/* Function peephole rewrites the buffered code until
+ * no rule applies and returns the number of rewrites
+ */
+int peephole(void)
+{ int count = 0, k;
+  do
+  { k = peepRound();
+    count += k;
+  } while (k > 0);
+  return count;
+}
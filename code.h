@@ -9,6 +9,13 @@
 #ifndef _CODE_H_
 #define _CODE_H_
 
+#include "symtab.h"
+
+/* the words of the instruction memory of TM (tm.c);
+ * code past them does not load
+ */
+#define IADDR_SIZE 1024
+
 /* pc = program counter  */
 #define  pc 7
 
@@ -29,10 +36,45 @@
 /* 2nd accumulator */
 #define  ac1 1
 
-#define cp 2
+/* variable registers: the IR code generator keeps
+ * in them values that are never live across a call,
+ * so a call may use them freely
+ */
+#define  vr0 2
+#define  vr1 3
 
 #define fp 4
 
+/* While buffering, an instruction is kept with its
+ * absolute target when it is pc-relative, and a call
+ * with its callee, so that the code can be rewritten
+ * or moved before it is written
+ */
+typedef enum { TmHole, TmRO, TmRM } TmKind;
+
+typedef struct TmInstRec
+{ TmKind kind;
+  char * op;
+  int r, s, t, d;
+  int target;    /* absolute target when s is pc, else -1 */
+  FuncParam callee; /* of a call, else NULL */
+  char * comment;
+} TmInst;
+
+typedef struct TmNoteRec
+{ int loc;       /* the instruction the comment precedes */
+  int seq;       /* order of emission */
+  char * text;
+} TmNote;
+
+/* the debug map, kept while DebugMap is set */
+typedef struct TmMarkRec
+{ int loc;       /* the first instruction of the construct */
+  char * kind;
+  int line;
+  char * name;   /* callee of a call, else NULL */
+} TmMark;
+
 /* code emitting utilities */
 
 /* Procedure emitComment prints a comment line 
@@ -87,4 +129,101 @@ void emitRestore(void);
  */
 void emitRM_Abs( char *op, int r, int a, char * c);
 
+/* Procedure emitCall emits a direct jump to the
+ * entry of callee + offset, or leaves a hole for
+ * it if callee is not placed yet
+ */
+void emitCall( FuncParam callee, int offset, char * c);
+
+/* Procedure emitCallFixups fills the holes left by
+ * emitCall, once every function has its entry
+ */
+void emitCallFixups(void);
+
+/* Procedure emitMark records in the debug map that
+ * the code of construct kind of the source line
+ * starts at location loc; name is the callee of a
+ * call, else NULL. Marks are kept only while
+ * DebugMap is set.
+ */
+void emitMark( int loc, char * kind, int line, char * name);
+
+/* Procedure emitMap writes the debug map, one line
+ * "loc kind line name" per mark, to mapfile
+ */
+void emitMap( char * mapfile);
+
+/* Procedure emitBuffer makes the emitting utilities
+ * keep the code in memory from now on, so that
+ * peephole can rewrite it before emitFlush writes it
+ */
+void emitBuffer(void);
+
+/* Procedure emitFlush writes the buffered code to
+ * the code file and stops buffering
+ */
+void emitFlush(void);
+
+/* Function emitCount returns the number of buffered
+ * instructions, and in *dynamic an estimate of how
+ * often they run: each counts 10 times for each loop
+ * around it, up to 4
+ */
+int emitCount(long * dynamic);
+
+/* TmSpot is a place in the buffered code: the next
+ * location and the number of comments and marks
+ * buffered before it
+ */
+typedef struct
+{ int loc, note, mark;
+} TmSpot;
+
+/* TmPiece is buffered code cut out to be placed
+ * again, by another compile: its locations and jump
+ * targets count from its start and the lines of its
+ * marks from a base line, and a call has the offset
+ * from the entry of its callee as target
+ */
+typedef struct
+{ TmInst * inst;
+  int ninst;
+  TmNote * note;   /* in the order emitted */
+  int nnote;
+  TmMark * mark;
+  int nmark;
+} TmPiece;
+
+/* Procedure emitSpot records the next place of the
+ * buffered code in s
+ */
+void emitSpot(TmSpot * s);
+
+/* Function emitCut copies the buffered code between
+ * the spots from and to, once its calls are linked,
+ * into piece, with the lines of its marks counted
+ * from line; it returns FALSE if the code jumps out
+ * of itself other than by a call
+ */
+int emitCut(TmSpot * from, TmSpot * to, int line, TmPiece * piece);
+
+/* Procedure emitPiece buffers piece at the next
+ * location, with the lines of its marks counted from
+ * line; its calls are linked as emitCall links them
+ */
+void emitPiece(TmPiece * piece, int line);
+
+/* Procedure freePiece releases a piece emitCut made */
+void freePiece(TmPiece * piece);
+
+/* Function peephole rewrites the buffered code: it
+ * threads jumps to jumps, inverts branches over a
+ * jump, computes results straight into the register
+ * they are moved to and drops moves to itself, jumps
+ * to the next location, results never read and loads
+ * of a word just stored. It returns the number of
+ * rewrites.
+ */
+int peephole(void);
+
 #endif
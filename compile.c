@@ -0,0 +1,290 @@
+/****************************************************/
+/* File: compile.c                                  */
+/* Compiler driver for the C-minus compiler: runs   */
+/* the phases over one program in its context, or   */
+/* over a batch of programs on a pool of threads    */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <pthread.h>
+#include <time.h>
+#include "globals.h"
+
+/* set NO_PARSE to TRUE to get a scanner-only compiler */
+#ifndef NO_PARSE
+#define NO_PARSE FALSE
+#endif
+/* set NO_ANALYZE to TRUE to get a parser-only compiler */
+#ifndef NO_ANALYZE
+#define NO_ANALYZE FALSE
+#endif
+
+/* set NO_CODE to TRUE to get a compiler that does not
+ * generate code
+ */
+#ifndef NO_CODE
+#define NO_CODE FALSE
+#endif
+
+#include "util.h"
+#include "context.h"
+#include "compile.h"
+#if NO_PARSE
+#include "scan.h"
+#else
+#include "parse.h"
+#include "rdparse.h"
+#include "astcache.h"
+#if !NO_ANALYZE
+#include "analyze.h"
+#if !NO_CODE
+#include "pass.h"
+#include "incr.h"
+#endif
+#endif
+#endif
+
+#if !NO_PARSE
+/* Function withExtension returns a new copy of
+ * program name pgm, up to the first '.' of its last
+ * component, followed by extension ext
+ */
+static char * withExtension(char * pgm, char * ext)
+{ char * base = strrchr(pgm,'/');
+  int fnlen = (base == NULL ? 0 : base + 1 - pgm)
+              + strcspn(base == NULL ? pgm : base + 1,".");
+  char * name = (char *) calloc(fnlen+strlen(ext)+1, sizeof(char));
+  strncpy(name,pgm,fnlen);
+  strcat(name,ext);
+  return name;
+}
+#endif
+
+int compileFile(CompilerContext * c, char * pgm)
+{
+#if !NO_PARSE
+  TreeNode * syntaxTree = NULL;
+  Parser parser = NULL;
+  SourceHash hash = 0;
+  char * astfile = NULL;
+#if !NO_ANALYZE && !NO_CODE
+  char * incfile = NULL;
+#endif
+#endif
+  useContext(c);
+  c->source = fopen(pgm,"r");
+  if (c->source==NULL)
+  { fprintf(c->listing,"File %s not found\n",pgm);
+    return FALSE;
+  }
+  fprintf(c->listing,"\nTINY COMPILATION: %s\n",pgm);
+#if NO_PARSE
+  { long ntokens = 0;
+    while (getToken()!=ENDFILE) ntokens++;
+    fprintf(c->listing,"%ld tokens\n",ntokens);
+  }
+#else
+  if (c->AstCache && (hash = hashSource(c->source)) != 0)
+  { astfile = withExtension(pgm,".ast");
+    syntaxTree = loadAst(astfile,hash);
+  }
+  if (syntaxTree == NULL)
+  { if (c->RdParse)
+    { parser = newParser(c->source);
+      syntaxTree = rdParse(parser);
+      if (parser->error) c->Error = TRUE;
+      c->lineno = parser->scan.lineno;
+    }
+    else syntaxTree = parse();
+    if (astfile != NULL && !c->Error) saveAst(astfile,hash,syntaxTree);
+  }
+  free(astfile);
+  if (c->TraceParse) {
+    fprintf(c->listing,"\nSyntax tree:\n");
+    printTree(syntaxTree);
+  }
+#if !NO_ANALYZE
+#if !NO_CODE
+  if (c->Incremental && ! c->Error)
+  { incfile = withExtension(pgm,".inc");
+    loadIncremental(incfile);
+  }
+#endif
+  if (! c->Error)
+  { if (c->TraceAnalyze) fprintf(c->listing,"\nBuilding Symbol Table...\n");
+    buildSymtab(syntaxTree);
+    if (c->TraceAnalyze) fprintf(c->listing,"\nChecking Types...\n");
+    typeCheck(syntaxTree);
+    if (c->TraceAnalyze) fprintf(c->listing,"\nType Checking Finished\n");
+  }
+#if !NO_CODE
+  if (! c->Error)
+  { char * codefile = withExtension(pgm,".tm");
+    c->code = fopen(codefile,"w");
+    if (c->code == NULL)
+    { fprintf(c->listing,"Unable to open %s\n",codefile);
+      c->Error = TRUE;
+    }
+    else
+    { runPasses(syntaxTree,codefile);
+      fclose(c->code);
+      /* TM would not load the code past its memory */
+      if (! c->Error && c->emit.highEmitLoc > c->IaddrSize)
+      { fprintf(c->listing,"Code error: %d instructions do not fit the %d of TM\n",
+                c->emit.highEmitLoc,c->IaddrSize);
+        c->Error = TRUE;
+        remove(codefile);
+      }
+    }
+    free(codefile);
+  }
+  if (incfile != NULL)
+  { if (! c->Error) saveIncremental(incfile);
+    freeIncremental();
+    free(incfile);
+  }
+#endif
+#endif
+  if (parser != NULL) freeParser(parser);
+#endif
+  fclose(c->source);
+  return !c->Error;
+}
+
+/* the state of one program of a batch, filled in by
+ * the worker that compiles it
+ */
+typedef struct
+{ char * pgm;
+  char * text;     /* the listing, in memory */
+  size_t size;
+  int lines;       /* source lines read */
+  double ms;       /* latency, from start to finish */
+  int found;       /* FALSE if the file could not be read */
+  int ok;          /* TRUE if it compiled without error */
+  int done;
+} BatchJob;
+
+/* a batch: the workers take the next job in turn */
+typedef struct
+{ BatchJob * jobs;
+  int njobs;
+  int next;
+  CompilerContext * (*makeContext)(void);
+  pthread_mutex_t lock;
+  pthread_cond_t finished; /* signalled as each job is done */
+} Batch;
+
+/* Function now returns the wall clock time in ms */
+static double now(void)
+{ struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* Procedure runJob compiles the program of job j in
+ * a context of its own, listing to memory
+ */
+static void runJob(Batch * b, BatchJob * j)
+{ double start = now();
+  CompilerContext * c = b->makeContext();
+  c->listing = open_memstream(&j->text,&j->size);
+  if (c->listing == NULL)
+  { fprintf(stderr,"Out of memory error listing %s\n",j->pgm);
+    exit(1);
+  }
+  j->ok = compileFile(c,j->pgm);
+  j->found = c->source != NULL;
+  j->lines = c->lineno;
+  fclose(c->listing);
+  freeContext(c);
+  j->ms = now() - start;
+}
+
+static void * batchWorker(void * arg)
+{ Batch * b = (Batch *) arg;
+  BatchJob * j;
+  for (;;)
+  { pthread_mutex_lock(&b->lock);
+    j = b->next < b->njobs ? &b->jobs[b->next++] : NULL;
+    pthread_mutex_unlock(&b->lock);
+    if (j == NULL) return NULL;
+    runJob(b,j);
+    pthread_mutex_lock(&b->lock);
+    j->done = TRUE;
+    pthread_cond_broadcast(&b->finished);
+    pthread_mutex_unlock(&b->lock);
+  }
+}
+
+/* Procedure printBatch prints the latency of each
+ * program of b and the throughput of the batch,
+ * which took ms in all on nthreads threads
+ */
+static void printBatch(Batch * b, int nthreads, double ms)
+{ BatchJob * j;
+  long lines = 0;
+  double sum = 0, worst = 0;
+  int k, failed = 0;
+  fprintf(stdout,"\nBatch: %d files on %d threads\n",b->njobs,nthreads);
+  fprintf(stdout,"%-32s %8s %10s  %s\n","file","lines","ms","status");
+  for (k = 0; k < b->njobs; k++)
+  { j = &b->jobs[k];
+    fprintf(stdout,"%-32s %8d %10.3f  %s\n",j->pgm,j->lines,j->ms,
+            !j->found ? "not found" : j->ok ? "ok" : "error");
+    lines += j->lines;
+    sum += j->ms;
+    if (j->ms > worst) worst = j->ms;
+    if (!j->ok) failed++;
+  }
+  fprintf(stdout,"%-32s %8ld %10.3f  %d failed\n","total",lines,ms,failed);
+  fprintf(stdout,"%.1f files/s, %.3f Mlines/s; "
+          "latency mean %.3f ms, max %.3f ms\n",
+          b->njobs * 1000.0 / ms, lines / ms / 1000.0,
+          sum / b->njobs, worst);
+}
+
+int compileBatch(char ** pgms, int n, int nthreads,
+                 CompilerContext * (*makeContext)(void))
+{ Batch b;
+  pthread_t * workers;
+  double start;
+  int k, missing = 0;
+  if (nthreads > n) nthreads = n;
+  if (nthreads < 1) nthreads = 1;
+  b.jobs = (BatchJob *) calloc(n + 1,sizeof(BatchJob));
+  workers = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+  if (b.jobs == NULL || workers == NULL)
+  { fprintf(stderr,"Out of memory error starting a batch\n");
+    exit(1);
+  }
+  for (k = 0; k < n; k++) b.jobs[k].pgm = pgms[k];
+  b.njobs = n;
+  b.next = 0;
+  b.makeContext = makeContext;
+  pthread_mutex_init(&b.lock,NULL);
+  pthread_cond_init(&b.finished,NULL);
+  start = now();
+  for (k = 0; k < nthreads; k++)
+    if (pthread_create(&workers[k],NULL,batchWorker,&b) != 0)
+    { fprintf(stderr,"Unable to start worker thread\n");
+      exit(1);
+    }
+  /* print each listing as soon as those before it are */
+  for (k = 0; k < n; k++)
+  { pthread_mutex_lock(&b.lock);
+    while (!b.jobs[k].done) pthread_cond_wait(&b.finished,&b.lock);
+    pthread_mutex_unlock(&b.lock);
+    fwrite(b.jobs[k].text,1,b.jobs[k].size,stdout);
+    free(b.jobs[k].text);
+    if (!b.jobs[k].found) missing++;
+  }
+  for (k = 0; k < nthreads; k++) pthread_join(workers[k],NULL);
+  printBatch(&b,nthreads,now() - start);
+  pthread_mutex_destroy(&b.lock);
+  pthread_cond_destroy(&b.finished);
+  free(workers);
+  free(b.jobs);
+  return missing;
+}
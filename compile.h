@@ -0,0 +1,37 @@
+/****************************************************/
+/* File: compile.h                                  */
+/* Compiler driver interface for the C-minus        */
+/* compiler, for use as a library                   */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _COMPILE_H_
+#define _COMPILE_H_
+
+#include "context.h"
+
+/* Function compileFile compiles the program in file
+ * pgm with the options of context c, which it makes
+ * the context of the calling thread: the listing goes
+ * to c->listing and the TM code to pgm with extension
+ * .tm. It returns TRUE if there was no error. A
+ * context compiles one program; several contexts may
+ * compile at once on different threads.
+ */
+int compileFile(CompilerContext * c, char * pgm);
+
+/* Function compileBatch compiles the n programs pgms
+ * on nthreads threads at once, each in a context of
+ * its own that makeContext returns with the options
+ * of the batch. The listings are printed to the
+ * screen in the order of pgms, followed by the
+ * latency of each program and the throughput of the
+ * batch. It returns the number of files not found.
+ * The Yacc parser parses one program at a time, so
+ * batches parse in parallel only with RdParse.
+ */
+int compileBatch(char ** pgms, int n, int nthreads,
+                 CompilerContext * (*makeContext)(void));
+
+#endif
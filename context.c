@@ -0,0 +1,105 @@
+/****************************************************/
+/* File: context.c                                  */
+/* Compiler context implementation for the C-minus  */
+/* compiler                                         */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <pthread.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "symtab.h"
+#include "code.h"
+#include "profile.h"
+#include "context.h"
+
+__thread CompilerContext * cc = NULL;
+
+/* the names initNames interns are shared by all
+ * contexts, and interned by the first one made */
+static pthread_once_t namesOnce = PTHREAD_ONCE_INIT;
+
+/* Function newContext returns a context with the
+ * default options, listing to the screen; all its
+ * tables start empty
+ */
+CompilerContext * newContext(void)
+{ CompilerContext * c = (CompilerContext *) calloc(1,sizeof(CompilerContext));
+  if (c == NULL)
+  { fprintf(stderr,"Out of memory error making a compiler context\n");
+    exit(1);
+  }
+  c->listing = stdout;
+  c->EchoSource = TRUE;
+  c->TraceCode = TRUE;
+  c->OptLevel = 1;
+  c->IaddrSize = IADDR_SIZE;
+  c->pass.unrollFactor = 4;
+  pthread_once(&namesOnce,initNames);
+  return c;
+}
+
+void useContext(CompilerContext * c)
+{ cc = c; }
+
+/* Procedure freeSymtab releases the scopes of the
+ * symbol table of c and their entries
+ */
+static void freeSymtab(CompilerContext * c)
+{ ScopeList s;
+  BucketList b;
+  LineList l;
+  int i, k;
+  for (i = 0; i < c->symtab.scopeindex; i++)
+  { s = c->symtab.scopelist[i];
+    for (k = 0; k < SIZE; k++)
+      while ((b = s->bucket[k]) != NULL)
+      { s->bucket[k] = b->next;
+        while (b->lines != NULL)
+        { l = b->lines;
+          b->lines = l->next;
+          free(l);
+        }
+        free(b);
+      }
+    free(s);
+  }
+  for (i = 0; i < c->symtab.plindex; i++)
+    free(c->symtab.funclist[i]);
+  free(c->symtab.scopelist);
+  free(c->symtab.funclist);
+}
+
+/* Procedure freeContext releases c: the syntax
+ * tree, the text scanned, the symbol table and what
+ * the code generator and passes kept. The TM code
+ * is released as it is written, and the names are
+ * interned for the whole process.
+ */
+void freeContext(CompilerContext * c)
+{ Count p;
+  int i;
+  freeArena(&c->nodes);
+  if (c->scanner.text != NULL) freeScanner(&c->scanner);
+  freeSymtab(c);
+  free(c->cgen.retLocs);
+  free(c->emit.callFixups);
+  free(c->emit.tmCode);
+  free(c->emit.tmNote);
+  free(c->emit.tmMark);
+  free(c->opt.clones);
+  free(c->pass.passes);
+  free(c->pass.rows);
+  for (i = 0; i < SIZE; i++)
+    while (c->profile.counts[i] != NULL)
+    { p = c->profile.counts[i];
+      c->profile.counts[i] = p->next;
+      free(p->kind);
+      free(p->name);
+      free(p);
+    }
+  if (cc == c) cc = NULL;
+  free(c);
+}
@@ -0,0 +1,235 @@
+/****************************************************/
+/* File: context.h                                  */
+/* Compiler context for the C-minus compiler: all   */
+/* the state of compiling one program               */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _CONTEXT_H_
+#define _CONTEXT_H_
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "symtab.h"
+
+/* A CompilerContext owns the files, options and
+ * tables of one compilation, so that a program can
+ * compile several programs in turn, or at once on
+ * different threads, each with a context of its own.
+ * The compiler works on the context cc of its thread,
+ * set by useContext. Scratch that a pass keeps only
+ * while it runs over one function stays in the
+ * module, one copy per thread.
+ */
+typedef struct CompilerContextRec
+{ FILE * source;  /* source code text file */
+  FILE * listing; /* listing output text file */
+  FILE * code;    /* code text file for TM simulator */
+
+  int lineno;     /* source line number for listing */
+
+  /* EchoSource = TRUE causes the source program to
+   * be echoed to the listing file with line numbers
+   * during parsing
+   */
+  int EchoSource;
+
+  /* TraceScan = TRUE causes token information to be
+   * printed to the listing file as each token is
+   * recognized by the scanner
+   */
+  int TraceScan;
+
+  /* TraceParse = TRUE causes the syntax tree to be
+   * printed to the listing file in linearized form
+   * (using indents for children)
+   */
+  int TraceParse;
+
+  /* TraceAnalyze = TRUE causes symbol table inserts
+   * and lookups to be reported to the listing file
+   */
+  int TraceAnalyze;
+
+  /* TraceCode = TRUE causes comments to be written
+   * to the TM code file as code is generated
+   */
+  int TraceCode;
+
+  /* TraceIR = TRUE causes the intermediate code of
+   * each function to be printed to the listing file
+   */
+  int TraceIR;
+
+  /* TimePasses = TRUE causes the time taken by each
+   * pass and its effect on the size of the program to
+   * be reported to the listing file
+   */
+  int TimePasses;
+
+  /* DebugMap = TRUE causes the first TM location of
+   * each if arm, loop, and call to be written to the
+   * debug map <program>.map, which lets the counts of
+   * tm -p be read back with -profile-use
+   */
+  int DebugMap;
+
+  /* OptLevel selects the code generator and the passes
+   * run by default: 0 generates code from the syntax
+   * tree as written, 1 inlines and folds it and
+   * generates code through the optimized IR, 2 also
+   * improves the TM code with the peephole optimizer
+   */
+  int OptLevel;
+
+  /* RdParse = TRUE parses with the recursive-descent
+   * parser of rdparse.c instead of the Yacc one
+   */
+  int RdParse;
+
+  /* AstCache = TRUE loads the syntax tree from the
+   * cache <program>.ast when it was parsed from the
+   * same source, and saves it there when it was not
+   * (astcache.c)
+   */
+  int AstCache;
+
+  /* Incremental = TRUE keeps in the cache
+   * <program>.inc which functions type checked and
+   * the code of each, and on the next compile reuses
+   * both for each function that is unchanged along
+   * with what it depends on (incr.c)
+   */
+  int Incremental;
+
+  /* IaddrSize is the number of words of instruction
+   * memory of the TM the code is for, IADDR_SIZE of
+   * tm.c unless set; the passes that copy code keep
+   * within it, and code that does not fit is an error
+   */
+  int IaddrSize;
+
+  /* Error = TRUE prevents further passes if an error occurs */
+  int Error;
+
+  /* the nodes of the new*Node functions (util.c) */
+  NodeArena nodes;
+
+  /* the scanner getToken reads source with; the
+   * lexeme of the last token is the tokenLength
+   * characters found tokenOffset bytes into its text,
+   * which is NULL until the first token (scan.c)
+   */
+  Scanner scanner;
+
+  /* the scopes and functions of the program (symtab.c) */
+  struct
+  { ScopeList scopeStack[STACK];
+    ScopeList * scopelist;  /* scopeMax of them, grown as needed */
+    FuncParam * funclist;   /* plMax of them */
+    int scopeindex;
+    int scopeMax;
+    int scopestack_i;
+    int plindex;
+    int plMax;
+    char * scope_name; /* scope of the last st_lookup */
+    ScopeList g_scope;
+  } symtab;
+
+  /* memory locations handed out so far (analyze.c) */
+  struct
+  { int location;
+    char * scope;
+    int isFuncC;
+    int globalloc;
+    int staticloc;
+    int paramloc;
+    int isoutFunc;
+  } analyze;
+
+  /* the function being generated (cgen.c) */
+  struct
+  { int isinFunc;
+    int * retLocs;     /* jumps from returns to the epilogue */
+    int retCount;
+    int retMax;
+    TreeNode * lastStmt;
+    char * scope;
+  } cgen;
+
+  /* the TM code emitted so far (code.c) */
+  struct
+  { int emitLoc;       /* location of the next instruction */
+    int highEmitLoc;   /* highest location emitted so far */
+    struct CallFixupRec * callFixups;
+    int fixupCount;
+    int fixupMax;
+    int buffering;
+    struct TmInstRec * tmCode;
+    int tmMax;
+    struct TmNoteRec * tmNote;
+    int noteCount;
+    int noteMax;
+    struct TmMarkRec * tmMark;
+    int markCount;
+    int markMax;
+  } emit;
+
+  /* the budgets of the tree optimizations (opt.c) */
+  struct
+  { int inlineCount;      /* makes inlined locals unique */
+    int inlineGrowth;     /* nodes added by inlining so far */
+    int specializeGrowth; /* nodes added by specialization */
+    int specializeBudget; /* and the most it may add */
+    int unrollGrowth;     /* nodes added by unrolling so far */
+    int unrollBudget;     /* and the most it may add */
+    struct CloneRec * clones; /* the specialized copies */
+    int cloneCount;
+  } opt;
+
+  /* the registered passes, their options and the
+   * report rows (pass.c)
+   */
+  struct
+  { struct PassRec * passes;
+    int npass;
+    int unrollFactor;
+    struct RowRec * rows;
+    int nrow;
+  } pass;
+
+  /* the cache of -incremental and what this compile
+   * adds to it (incr.c)
+   */
+  struct IncrRec * incr;
+
+  /* the counts of -profile-use (profile.c) */
+  struct
+  { struct CountRec * counts[SIZE];
+    int loaded;
+  } profile;
+} CompilerContext;
+
+/* cc is the context the compiler works on in the
+ * calling thread
+ */
+extern __thread CompilerContext * cc;
+
+/* Function newContext returns a context with the
+ * default options, listing to the screen
+ */
+CompilerContext * newContext(void);
+
+/* Procedure useContext makes c the context of the
+ * calling thread
+ */
+void useContext(CompilerContext * c);
+
+/* Procedure freeContext releases c with its syntax
+ * tree, tables and code; its files are not closed
+ */
+void freeContext(CompilerContext * c);
+
+#endif
@@ -52,11 +52,10 @@
 	 */
 typedef int TokenType;
 
-extern FILE* source; /* source code text file */
-extern FILE* listing; /* listing output text file */
-extern FILE* code; /* code text file for TM simulator */
-
-extern int lineno; /* source line number for listing */
+/* The files, line number, tracing flags and
+ * options of a compilation are kept in its
+ * CompilerContext (context.h)
+ */
 
 /**************************************************/
 /***********   Syntax tree for parsing ************/
@@ -64,16 +63,19 @@ extern int lineno; /* source line number for listing */
 
 typedef enum {StmtK,ExpK,DeclK,ParamK,TypeK} NodeKind;
 typedef enum {CompK,IfK,IterK,RetK} StmtKind;
-typedef enum {AssignK,OpK,ConstK,IdK,ArrIdK,CallK} ExpKind;
+typedef enum {AssignK,OpK,ConstK,IdK,ArrIdK,CallK,InlineK} ExpKind;
 typedef enum {FuncK,VarK,ArrVarK} DeclKind;
 typedef enum {ArrParamK,NonArrParamK} ParamKind;
 typedef enum {TypeNameK} TypeKind;
 
-/* ArrayAttr is used for attributes for array variables */
+/* ArrayAttr is used for attributes for array variables;
+ * name comes first so that it shares its place with
+ * attr.name, and the union stays two words
+ */
 typedef struct arrayAttr {
-	TokenType type;
 	char * name;
 	int size;
+	TokenType type;
 } ArrayAttr;
 
 /* ExpType is used for type checking */
@@ -81,57 +83,28 @@ typedef enum {Void,Integer,Boolean, IntegerArray} ExpType;
 
 #define MAXCHILDREN 3
 
+/* The pointers and the attribute come first, and the
+ * kinds, which hold the values of the enums named in
+ * their comments, take a byte each after the line
+ * number: a node fills 56 bytes on a 64-bit host
+ */
 typedef struct treeNode
 { struct treeNode * child[MAXCHILDREN];
 		struct treeNode * sibling;
-		int lineno;
-		NodeKind nodekind;
-		union { StmtKind stmt;
-				ExpKind exp;
-				DeclKind decl;
-				ParamKind param;
-				TypeKind type; } kind;
 		union { TokenType op;
 				TokenType type;
 				int val;
 				char * name;
 				ArrayAttr arr;
 			   } attr;
-		ExpType type; /* for type checking of exps */
+		int lineno;
+		unsigned char nodekind;      /* NodeKind */
+		union { unsigned char stmt;  /* StmtKind */
+				unsigned char exp;   /* ExpKind */
+				unsigned char decl;  /* DeclKind */
+				unsigned char param; /* ParamKind */
+				unsigned char type;  /* TypeKind */ } kind;
+		unsigned char type; /* ExpType, for type checking of exps */
 } TreeNode;
 
-/**************************************************/
-/***********   Flags for tracing       ************/
-/**************************************************/
-
-/* EchoSource = TRUE causes the source program to
- * be echoed to the listing file with line numbers
- * during parsing
- */
-extern int EchoSource;
-
-/* TraceScan = TRUE causes token information to be
- * printed to the listing file as each token is
- * recognized by the scanner
- */
-extern int TraceScan;
-
-/* TraceParse = TRUE causes the syntax tree to be
- * printed to the listing file in linearized form
- * (using indents for children)
- */
-extern int TraceParse;
-
-/* TraceAnalyze = TRUE causes symbol table inserts
- * and lookups to be reported to the listing file
- */
-extern int TraceAnalyze;
-
-/* TraceCode = TRUE causes comments to be written
- * to the TM code file as code is generated
- */
-extern int TraceCode;
-
-/* Error = TRUE prevents further passes if an error occurs */
-extern int Error;
 #endif
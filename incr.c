@@ -0,0 +1,740 @@
+/****************************************************/
+/* File: incr.c                                     */
+/* Incremental compilation for the C-minus          */
+/* compiler: the type checks and the code of each   */
+/* function kept from one compile to the next       */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "code.h"
+#include "ir.h"
+#include "incr.h"
+#include "context.h"
+
+/* INCMAGIC reads "CINC" on a little-endian host;
+ * INCVERSION changes with the layout of the file,
+ * the keys or the code the generators make
+ */
+#define INCMAGIC 0x434e4943
+#define INCVERSION 1
+
+typedef struct
+{ unsigned magic;
+  unsigned version;
+  int checked;      /* check keys, sorted */
+  int funcs;        /* functions with code */
+} IncHeader;
+
+/* a declaration at the top of the tree indexed, in
+ * a hash table open by address
+ */
+typedef struct
+{ char * name;      /* NULL for an empty slot */
+  TreeNode * decl;
+  int order;        /* of a function among them, else -1 */
+  ScopeList scope;  /* of a function, once its code is placed */
+  FuncParam pl;     /* of a function, once looked up */
+} Slot;
+
+/* a function of the code being placed */
+typedef struct
+{ TreeNode * func;
+  FuncKey key;
+  int keyed;        /* TRUE once key is set */
+  FuncCode * kept;  /* placed from the cache, or NULL */
+  FuncCode made;    /* its code, if generated, to save */
+  int cut;          /* TRUE once made has its code */
+  int storesMem;    /* of its IR, after findStores */
+  TmSpot from, to;  /* around the code generated */
+  int ended;
+} Placed;
+
+typedef struct IncrRec
+{ char * buf;            /* the file read; its strings are used in place */
+  FuncKey * checked;     /* the check keys kept, sorted */
+  int nchecked;
+  FuncCode * codes;      /* the code kept, sorted by key */
+  int ncode;
+  FuncKey * newChecked;  /* the check keys of this compile */
+  int nnew, maxNew;
+  Slot * slot;
+  int nslot;
+  Placed * placed;       /* the functions, in order */
+  int nplaced;
+  FuncKey settings;      /* of the options, for the code keys */
+  int placing;           /* FALSE while no code may be kept */
+} Incr;
+
+/* Function need returns p, or exits if an
+ * allocation returned NULL
+ */
+static void * need(void * p)
+{ if (p == NULL)
+  { fprintf(stderr,"Out of memory error in the incremental cache\n");
+    exit(1);
+  }
+  return p;
+}
+
+/**************************************************/
+/***********   Keys                       *********/
+/**************************************************/
+
+FuncKey mixKey(FuncKey h, unsigned long long v)
+{ h = (h ^ v) * 1099511628211ULL;
+  return h ^ (h >> 32);
+}
+
+/* Function mixText returns h with the text of s
+ * added; names are hashed by their text, since the
+ * interned copies move from one compile to the next
+ */
+static FuncKey mixText(FuncKey h, char * s)
+{ if (s == NULL) return mixKey(h, 0);
+  for (; *s != '\0'; s++) h = (h ^ (unsigned char) *s) * 1099511628211ULL;
+  return mixKey(h, 1);
+}
+
+/* Function hasName returns TRUE if the attribute of
+ * node t is its name
+ */
+static int hasName(TreeNode * t)
+{ switch (t->nodekind)
+  { case DeclK:
+    case ParamK:
+      return TRUE;
+    case ExpK:
+      return t->kind.exp == IdK || t->kind.exp == ArrIdK
+        || t->kind.exp == CallK || t->kind.exp == InlineK;
+    default:
+      return FALSE;
+  }
+}
+
+/* Function slotOf returns the slot of name in inc:
+ * the one holding it, or the empty one it would go
+ */
+static Slot * slotOf(Incr * inc, char * name)
+{ unsigned k = (unsigned) (((unsigned long) name >> 4) * 2654435761u) & (inc->nslot - 1);
+  while (inc->slot[k].name != NULL && inc->slot[k].name != name)
+    k = (k + 1) & (inc->nslot - 1);
+  return &inc->slot[k];
+}
+
+/* Function indexTree enters the declarations at the
+ * top of tree in the slots of inc, the first of each
+ * name, and returns the number of functions
+ */
+static int indexTree(Incr * inc, TreeNode * tree)
+{ TreeNode * t;
+  Slot * s;
+  int n = 0, order = 0;
+  for (t = tree; t != NULL; t = t->sibling) n++;
+  free(inc->slot);
+  for (inc->nslot = 16; inc->nslot < 2 * n; inc->nslot *= 2) ;
+  inc->slot = (Slot *) need(calloc(inc->nslot, sizeof(Slot)));
+  for (t = tree; t != NULL; t = t->sibling)
+  { if (t->nodekind != DeclK) continue;
+    s = slotOf(inc, t->attr.name);
+    if (t->attr.name != NULL && s->name == NULL)
+    { s->name = t->attr.name;
+      s->decl = t;
+      s->order = t->kind.decl == FuncK ? order : -1;
+    }
+    if (t->kind.decl == FuncK) order++;
+  }
+  return order;
+}
+
+/* Function declOf returns the declaration at the
+ * top of the tree named name, or NULL
+ */
+static TreeNode * declOf(Incr * inc, char * name)
+{ return name == NULL ? NULL : slotOf(inc, name)->decl; }
+
+/* what the key of a function hashes besides its
+ * tree: for a check key, the declarations of the
+ * names it uses; for a code key, where they are in
+ * memory and what the functions it calls look like
+ */
+typedef struct
+{ Incr * inc;
+  TreeNode * func;
+  int code;          /* TRUE for a code key */
+  ScopeList scope;   /* of func */
+  int order;         /* of func among the functions */
+} Keying;
+
+static FuncKey hashTree(FuncKey h, TreeNode * t, Keying * k);
+
+/* Function hashDecl returns h with declaration d
+ * added: its name, type and parameters
+ */
+static FuncKey hashDecl(FuncKey h, TreeNode * d)
+{ if (d == NULL) return mixKey(h, 0);
+  h = mixKey(h, d->kind.decl + 1);
+  h = mixText(h, d->attr.name);
+  h = mixKey(h, d->type);
+  if (d->kind.decl == ArrVarK)
+    h = mixKey(h, d->attr.arr.size);
+  h = hashTree(h, d->child[0], NULL);
+  if (d->kind.decl == FuncK) h = hashTree(h, d->child[1], NULL);
+  return h;
+}
+
+/* Function hashUse returns h with what the code made
+ * for name node t depends on: where the variable is,
+ * or the callee, with whether it is placed before
+ * the function keyed
+ */
+static FuncKey hashUse(FuncKey h, TreeNode * t, Keying * k)
+{ ScopeList found;
+  BucketList b;
+  Slot * s;
+  if (t->nodekind == ExpK && (t->kind.exp == CallK || t->kind.exp == InlineK))
+  { s = slotOf(k->inc, t->attr.name);
+    if (s->name == NULL || s->order < 0) return mixKey(h, 0);
+    h = mixKey(h, s->order < k->order ? 1 : s->order == k->order ? 2 : 3);
+    h = hashDecl(h, s->decl);
+    if (s->scope != NULL)
+      h = mixKey(mixKey(h, s->scope->paramNum), s->scope->frameSize);
+    return h;
+  }
+  b = st_find(k->scope, t->attr.name, &found);
+  if (b == NULL) return mixKey(h, 0);
+  h = mixKey(h, found == k->scope ? 1 : found->parent == NULL ? 2 : 3);
+  h = mixKey(mixKey(mixKey(h, b->type), b->memloc), b->mloc);
+  return mixText(h, b->scope);
+}
+
+/* Function hashNode returns h with node t and its
+ * children added. A check key has the types as
+ * parsed; a code key leaves out those type checking
+ * gives expressions, which a function checked before
+ * does not get, and has the lines from the first of
+ * the function, since the debug map has them.
+ */
+static FuncKey hashNode(FuncKey h, TreeNode * t, Keying * k)
+{ int i;
+  h = mixKey(h, t->nodekind << 8 | t->kind.stmt);
+  if (hasName(t)) h = mixText(h, t->attr.name);
+  else if (t->nodekind == TypeK || (t->nodekind == ExpK
+           && (t->kind.exp == OpK || t->kind.exp == ConstK)))
+    h = mixKey(h, t->attr.val);
+  if (t->nodekind == DeclK && t->kind.decl == ArrVarK)
+    h = mixKey(h, t->attr.arr.size);
+  if (k == NULL || !k->code)
+    h = mixKey(h, t->type);
+  else
+  { if (t->nodekind != ExpK || t->kind.exp == InlineK) h = mixKey(h, t->type);
+    h = mixKey(h, t->lineno - k->func->lineno);
+  }
+  if (k != NULL && hasName(t) && t != k->func)
+  { if (k->code) h = hashUse(h, t, k);
+    else if (t->nodekind == ExpK) h = hashDecl(h, declOf(k->inc, t->attr.name));
+  }
+  for (i = 0; i < MAXCHILDREN; i++)
+    h = hashTree(mixKey(h, i + 2), t->child[i], k);
+  return mixKey(h, 1);
+}
+
+/* Function hashTree returns h with tree t and the
+ * siblings that follow it added
+ */
+static FuncKey hashTree(FuncKey h, TreeNode * t, Keying * k)
+{ for (; t != NULL; t = t->sibling) h = hashNode(h, t, k);
+  return mixKey(h, 0);
+}
+
+static int compareKeys(const void * a, const void * b)
+{ FuncKey x = * (const FuncKey *) a, y = * (const FuncKey *) b;
+  return x < y ? -1 : x > y;
+}
+
+static int compareCodes(const void * a, const void * b)
+{ return compareKeys(&((const FuncCode *) a)->key, &((const FuncCode *) b)->key); }
+
+/**************************************************/
+/***********   Type checks                *********/
+/**************************************************/
+
+void beginChecks(TreeNode * syntaxTree)
+{ indexTree(cc->incr, syntaxTree); }
+
+int wasChecked(TreeNode * t)
+{ Incr * inc = cc->incr;
+  Keying k;
+  FuncKey h;
+  k.inc = inc;
+  k.func = t;
+  k.code = FALSE;
+  k.scope = NULL;
+  k.order = 0;
+  h = hashNode(mixKey(0, INCVERSION), t, &k);
+  if (inc->nnew == inc->maxNew)
+  { inc->maxNew = inc->maxNew ? 2 * inc->maxNew : 64;
+    inc->newChecked = (FuncKey *) need(realloc(inc->newChecked, inc->maxNew * sizeof(FuncKey)));
+  }
+  inc->newChecked[inc->nnew++] = h;
+  return bsearch(&h, inc->checked, inc->nchecked, sizeof(FuncKey), compareKeys) != NULL;
+}
+
+/**************************************************/
+/***********   Code                       *********/
+/**************************************************/
+
+void beginCodes(TreeNode * syntaxTree, FuncKey settings)
+{ Incr * inc = cc->incr;
+  TreeNode * t;
+  Slot * s;
+  int i, order = 0;
+  inc->nplaced = indexTree(inc, syntaxTree);
+  inc->placed = (Placed *) need(calloc(inc->nplaced + 1, sizeof(Placed)));
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind.decl == FuncK)
+      inc->placed[order++].func = t;
+  /* the first scope of a name, as scope_lookup finds */
+  for (i = cc->symtab.scopeindex - 1; i >= 0; i--)
+  { s = slotOf(inc, cc->symtab.scopelist[i]->name);
+    if (s->name != NULL && s->order >= 0) s->scope = cc->symtab.scopelist[i];
+  }
+  inc->settings = mixKey(settings, INCVERSION);
+  inc->placing = !cc->profile.loaded;
+}
+
+/* Function placedOf returns the record of function
+ * t of the tree indexed by beginCodes, or NULL
+ */
+static Placed * placedOf(Incr * inc, TreeNode * t)
+{ Slot * s = slotOf(inc, t->attr.name);
+  if (s->decl != t || s->order < 0) return NULL;
+  return &inc->placed[s->order];
+}
+
+/* Function plOf returns the entry in the function
+ * list of the function called name
+ */
+static FuncParam plOf(Incr * inc, char * name)
+{ Slot * s = slotOf(inc, name);
+  if (s->name == NULL) return getpl(name);
+  if (s->pl == NULL) s->pl = getpl(name);
+  return s->pl;
+}
+
+/* Function storesOf returns storesMem of the IR of
+ * the function called name, TRUE if it has none
+ */
+static int storesOf(Incr * inc, char * name)
+{ Slot * s = slotOf(inc, name);
+  if (s->name == NULL || s->order < 0) return TRUE;
+  return inc->placed[s->order].storesMem;
+}
+
+/* Function addCallee returns the number of callee
+ * name in fc, adding it the first time
+ */
+static int addCallee(Incr * inc, FuncCode * fc, char * name, int ir)
+{ int k;
+  for (k = 0; k < fc->ncallee; k++)
+    if (fc->callee[k].name == name)
+    { if (ir) fc->callee[k].ir = TRUE;
+      return k;
+    }
+  fc->callee = (KeptCallee *) need(realloc(fc->callee, (k + 1) * sizeof(KeptCallee)));
+  fc->callee[k].name = name;
+  fc->callee[k].storesMem = storesOf(inc, name);
+  fc->callee[k].ir = ir;
+  return fc->ncallee++;
+}
+
+FuncCode * keptCode(TreeNode * t)
+{ Incr * inc = cc->incr;
+  Placed * p = placedOf(inc, t);
+  Keying k;
+  FuncCode key, * fc;
+  int i;
+  if (p == NULL || !inc->placing) return NULL;
+  if (!p->keyed)
+  { k.inc = inc;
+    k.func = t;
+    k.code = TRUE;
+    k.scope = slotOf(inc, t->attr.name)->scope;
+    k.order = p - inc->placed;
+    p->key = inc->settings;
+    if (k.scope != NULL)
+      p->key = mixKey(mixKey(mixKey(p->key, k.scope->frameSize),
+                             k.scope->paramNum), k.scope->varNum);
+    p->key = hashNode(p->key, t, &k);
+    p->keyed = TRUE;
+  }
+  key.key = p->key;
+  fc = (FuncCode *) bsearch(&key, inc->codes, inc->ncode, sizeof(FuncCode), compareCodes);
+  if (fc == NULL || fc->name != t->attr.name) return NULL;
+  for (i = 0; i < fc->ncallee; i++)
+    if (plOf(inc, fc->callee[i].name) == NULL) return NULL;
+  for (i = 0; i < fc->code.ninst; i++)
+    fc->code.inst[i].callee = fc->call[i] < 0 ? NULL
+                              : plOf(inc, fc->callee[fc->call[i]].name);
+  p->kept = fc;
+  return fc;
+}
+
+void checkKept(IrFunc all)
+{ Incr * inc = cc->incr;
+  IrFunc g, f;
+  IrInst i;
+  Placed * p;
+  int j, stale;
+  for (g = all; g != NULL; g = g->next)
+    if ((p = placedOf(inc, g->tree)) != NULL) p->storesMem = g->storesMem;
+  for (g = all; g != NULL; g = g->next)
+  { if (g->kept == NULL || (p = placedOf(inc, g->tree)) == NULL) continue;
+    for (j = 0, stale = FALSE; j < g->kept->ncallee && !stale; j++)
+      stale = g->kept->callee[j].ir
+              && storesOf(inc, g->kept->callee[j].name) != g->kept->callee[j].storesMem;
+    if (!stale) continue;
+    /* its own stores and calls are as kept, so
+     * storesMem stays as findStores set it */
+    f = buildFuncIr(g->tree);
+    f->storesMem = g->storesMem;
+    f->next = g->next;
+    *g = *f;
+    free(f);
+    p->kept = NULL;
+  }
+  for (g = all; g != NULL; g = g->next)
+  { if (g->kept != NULL || (p = placedOf(inc, g->tree)) == NULL) continue;
+    for (j = 0; j < g->nblock; j++)
+      for (i = g->block[j]->first; i != NULL; i = i->next)
+        if (i->op == IrStore) p->made.stores = TRUE;
+        else if (i->op == IrCall) addCallee(inc, &p->made, i->callee->name, TRUE);
+  }
+}
+
+void placeCode(TreeNode * t)
+{ Incr * inc = cc->incr;
+  FuncCode * fc = placedOf(inc, t)->kept;
+  plOf(inc, t->attr.name)->entry = emitSkip(0) + fc->entry;
+  emitPiece(&fc->code, t->lineno);
+}
+
+void beginCode(TreeNode * t)
+{ Placed * p = placedOf(cc->incr, t);
+  if (p != NULL) emitSpot(&p->from);
+}
+
+void endCode(TreeNode * t)
+{ Placed * p = placedOf(cc->incr, t);
+  if (p == NULL) return;
+  emitSpot(&p->to);
+  p->ended = TRUE;
+}
+
+void keepCode(void)
+{ Incr * inc = cc->incr;
+  Placed * p;
+  FuncCode * fc;
+  int k, j;
+  if (!inc->placing) return;
+  for (k = 0; k < inc->nplaced; k++)
+  { p = &inc->placed[k];
+    fc = &p->made;
+    if (p->kept != NULL || !p->ended || !p->keyed) continue;
+    if (!emitCut(&p->from, &p->to, p->func->lineno, &fc->code))
+    { freePiece(&fc->code);
+      continue;
+    }
+    fc->name = p->func->attr.name;
+    fc->key = p->key;
+    fc->entry = plOf(inc, fc->name)->entry - p->from.loc;
+    fc->call = (int *) need(malloc((fc->code.ninst + 1) * sizeof(int)));
+    for (j = 0; j < fc->code.ninst; j++)
+      fc->call[j] = fc->code.inst[j].callee == NULL ? -1
+                    : addCallee(inc, fc, fc->code.inst[j].callee->name, FALSE);
+    p->cut = TRUE;
+  }
+}
+
+/**************************************************/
+/***********   The cache file             *********/
+/**************************************************/
+
+/* Procedure freeCode releases the tables of fc; the
+ * text of a piece was copied only if owned
+ */
+static void freeCode(FuncCode * fc, int owned)
+{ free(fc->callee);
+  free(fc->call);
+  if (owned) freePiece(&fc->code);
+  else
+  { free(fc->code.inst);
+    free(fc->code.note);
+    free(fc->code.mark);
+  }
+}
+
+void freeIncremental(void)
+{ Incr * inc = cc->incr;
+  int k;
+  if (inc == NULL) return;
+  for (k = 0; k < inc->ncode; k++) freeCode(&inc->codes[k], FALSE);
+  for (k = 0; k < inc->nplaced; k++)
+    if (inc->placed[k].cut) freeCode(&inc->placed[k].made, TRUE);
+    else free(inc->placed[k].made.callee);
+  free(inc->codes);
+  free(inc->checked);
+  free(inc->newChecked);
+  free(inc->slot);
+  free(inc->placed);
+  free(inc->buf);
+  free(inc);
+  cc->incr = NULL;
+}
+
+/* Each string is written as its length with the
+ * '\0', or -1 for none, then its text padded to a
+ * whole number of ints
+ */
+static int putInt(FILE * f, int v)
+{ return fwrite(&v, sizeof(int), 1, f) == 1; }
+
+static int putText(FILE * f, char * s)
+{ int len = s == NULL ? -1 : (int) strlen(s) + 1, pad = 0;
+  if (!putInt(f, len)) return FALSE;
+  if (len < 0) return TRUE;
+  return fwrite(s, 1, len, f) == (size_t) len
+    && fwrite(&pad, 1, -len & 3, f) == (size_t) (-len & 3);
+}
+
+/* Function putCode writes fc to f */
+static int putCode(FILE * f, FuncCode * fc)
+{ TmInst * i;
+  int k, ok;
+  ok = fwrite(&fc->key, sizeof(FuncKey), 1, f) == 1 && putText(f, fc->name)
+    && putInt(f, fc->entry) && putInt(f, fc->stores) && putInt(f, fc->ncallee);
+  for (k = 0; ok && k < fc->ncallee; k++)
+    ok = putText(f, fc->callee[k].name) && putInt(f, fc->callee[k].storesMem)
+      && putInt(f, fc->callee[k].ir);
+  ok = ok && putInt(f, fc->code.ninst);
+  for (k = 0; ok && k < fc->code.ninst; k++)
+  { i = &fc->code.inst[k];
+    ok = putInt(f, i->kind) && putText(f, i->op) && putInt(f, i->r)
+      && putInt(f, i->s) && putInt(f, i->t) && putInt(f, i->d)
+      && putInt(f, i->target) && putInt(f, fc->call[k]) && putText(f, i->comment);
+  }
+  ok = ok && putInt(f, fc->code.nnote);
+  for (k = 0; ok && k < fc->code.nnote; k++)
+    ok = putInt(f, fc->code.note[k].loc) && putText(f, fc->code.note[k].text);
+  ok = ok && putInt(f, fc->code.nmark);
+  for (k = 0; ok && k < fc->code.nmark; k++)
+    ok = putInt(f, fc->code.mark[k].loc) && putInt(f, fc->code.mark[k].line)
+      && putText(f, fc->code.mark[k].kind) && putText(f, fc->code.mark[k].name);
+  return ok;
+}
+
+/* The cache is written under another name and then
+ * renamed, so a reader never sees half of one
+ */
+int saveIncremental(char * name)
+{ Incr * inc = cc->incr;
+  IncHeader hd;
+  FuncCode * fc;
+  FILE * f;
+  char * tmp = (char *) need(malloc(strlen(name) + 48));
+  int k, n = 0, ok;
+  qsort(inc->newChecked, inc->nnew, sizeof(FuncKey), compareKeys);
+  for (k = 0; k < inc->nnew; k++)
+    if (n == 0 || inc->newChecked[k] != inc->newChecked[n-1])
+      inc->newChecked[n++] = inc->newChecked[k];
+  inc->nnew = n;
+  hd.magic = INCMAGIC;
+  hd.version = INCVERSION;
+  hd.checked = inc->nnew;
+  hd.funcs = 0;
+  for (k = 0; k < inc->nplaced; k++)
+    if (inc->placed[k].kept != NULL || inc->placed[k].cut) hd.funcs++;
+  /* a compile that kept all it found has nothing to
+   * add to the file read */
+  for (k = 0; k < inc->nplaced && inc->placed[k].kept != NULL; k++) ;
+  if (k == inc->nplaced && hd.funcs == inc->ncode && inc->nnew == inc->nchecked
+      && memcmp(inc->newChecked, inc->checked, n * sizeof(FuncKey)) == 0)
+  { free(tmp);
+    return TRUE;
+  }
+  /* compiles of one program on several threads
+   * write files of their own */
+  sprintf(tmp, "%s.%ld.%lx", name, (long) getpid(), (unsigned long) inc);
+  f = fopen(tmp, "wb");
+  ok = f != NULL && fwrite(&hd, sizeof(hd), 1, f) == 1
+    && fwrite(inc->newChecked, sizeof(FuncKey), inc->nnew, f) == (size_t) inc->nnew;
+  for (k = 0; ok && k < inc->nplaced; k++)
+  { fc = inc->placed[k].kept != NULL ? inc->placed[k].kept
+         : inc->placed[k].cut ? &inc->placed[k].made : NULL;
+    if (fc != NULL) ok = putCode(f, fc);
+  }
+  if (f != NULL && fclose(f) != 0) ok = FALSE;
+  if (ok) ok = rename(tmp, name) == 0;
+  if (!ok) remove(tmp);
+  free(tmp);
+  return ok;
+}
+
+/* a cursor over the file read; ok turns FALSE when
+ * something read does not fit
+ */
+typedef struct
+{ char * p, * end;
+  int ok;
+} Reader;
+
+static int getInt(Reader * r)
+{ int v = 0;
+  if (r->end - r->p < (long) sizeof(int)) r->ok = FALSE;
+  else
+  { memcpy(&v, r->p, sizeof(int));
+    r->p += sizeof(int);
+  }
+  return v;
+}
+
+/* Function getCount reads a count of things of at
+ * least an int each
+ */
+static int getCount(Reader * r)
+{ int n = getInt(r);
+  if (n < 0 || n > (r->end - r->p) / (long) sizeof(int)) r->ok = FALSE;
+  return r->ok ? n : 0;
+}
+
+static char * getText(Reader * r)
+{ int len = getInt(r);
+  char * s = r->p;
+  if (!r->ok || len == -1) return NULL;
+  if (len <= 0 || r->end - r->p < len + (-len & 3) || s[len-1] != '\0')
+  { r->ok = FALSE;
+    return NULL;
+  }
+  r->p += len + (-len & 3);
+  return s;
+}
+
+/* Function getName reads a name, interned */
+static char * getName(Reader * r)
+{ char * s = getText(r);
+  return s == NULL ? NULL : internText(s, strlen(s));
+}
+
+/* Function readCode reads the code of a function
+ * into fc and returns FALSE if it does not fit
+ * together; its tables are set even then
+ */
+static int readCode(Reader * r, FuncCode * fc)
+{ TmInst * i;
+  int k;
+  if (r->end - r->p < (long) sizeof(FuncKey)) return r->ok = FALSE;
+  memcpy(&fc->key, r->p, sizeof(FuncKey));
+  r->p += sizeof(FuncKey);
+  fc->name = getName(r);
+  fc->entry = getInt(r);
+  fc->stores = getInt(r);
+  fc->ncallee = getCount(r);
+  fc->callee = (KeptCallee *) need(malloc((fc->ncallee + 1) * sizeof(KeptCallee)));
+  for (k = 0; k < fc->ncallee; k++)
+  { fc->callee[k].name = getName(r);
+    fc->callee[k].storesMem = getInt(r);
+    fc->callee[k].ir = getInt(r);
+    if (fc->callee[k].name == NULL) r->ok = FALSE;
+  }
+  fc->code.ninst = getCount(r);
+  fc->code.inst = (TmInst *) need(malloc((fc->code.ninst + 1) * sizeof(TmInst)));
+  fc->call = (int *) need(malloc((fc->code.ninst + 1) * sizeof(int)));
+  for (k = 0; k < fc->code.ninst; k++)
+  { i = &fc->code.inst[k];
+    i->kind = getInt(r);
+    i->op = getText(r);
+    i->r = getInt(r);
+    i->s = getInt(r);
+    i->t = getInt(r);
+    i->d = getInt(r);
+    i->target = getInt(r);
+    fc->call[k] = getInt(r);
+    i->callee = NULL;
+    i->comment = getText(r);
+    if ((i->kind != TmRO && i->kind != TmRM) || i->op == NULL
+        || fc->call[k] < -1 || fc->call[k] >= fc->ncallee
+        || (fc->call[k] >= 0 && (i->kind != TmRM || i->s != pc))
+        || (fc->call[k] < 0 && (i->target < -1 || i->target > fc->code.ninst)))
+      r->ok = FALSE;
+  }
+  fc->code.nnote = getCount(r);
+  fc->code.note = (TmNote *) need(malloc((fc->code.nnote + 1) * sizeof(TmNote)));
+  for (k = 0; k < fc->code.nnote; k++)
+  { fc->code.note[k].loc = getInt(r);
+    fc->code.note[k].seq = k;
+    fc->code.note[k].text = getText(r);
+    if (fc->code.note[k].loc < 0 || fc->code.note[k].loc > fc->code.ninst
+        || fc->code.note[k].text == NULL)
+      r->ok = FALSE;
+  }
+  fc->code.nmark = getCount(r);
+  fc->code.mark = (TmMark *) need(malloc((fc->code.nmark + 1) * sizeof(TmMark)));
+  for (k = 0; k < fc->code.nmark; k++)
+  { fc->code.mark[k].loc = getInt(r);
+    fc->code.mark[k].line = getInt(r);
+    fc->code.mark[k].kind = getText(r);
+    fc->code.mark[k].name = getName(r);
+    if (fc->code.mark[k].loc < 0 || fc->code.mark[k].loc > fc->code.ninst
+        || fc->code.mark[k].kind == NULL)
+      r->ok = FALSE;
+  }
+  if (fc->name == NULL || fc->entry < 0 || fc->entry > fc->code.ninst)
+    r->ok = FALSE;
+  return r->ok;
+}
+
+void loadIncremental(char * name)
+{ Incr * inc = (Incr *) need(calloc(1, sizeof(Incr)));
+  FILE * f = fopen(name, "rb");
+  struct stat st;
+  IncHeader hd;
+  Reader r;
+  size_t n;
+  int k;
+  cc->incr = inc;
+  if (f == NULL) return;
+  r.ok = fstat(fileno(f), &st) == 0 && st.st_size >= (off_t) sizeof(hd)
+    && (inc->buf = (char *) malloc(st.st_size)) != NULL
+    && fread(inc->buf, 1, st.st_size, f) == (size_t) st.st_size;
+  fclose(f);
+  if (!r.ok) return;
+  memcpy(&hd, inc->buf, sizeof(hd));
+  r.p = inc->buf + sizeof(hd);
+  r.end = inc->buf + st.st_size;
+  n = (size_t) hd.checked * sizeof(FuncKey);
+  r.ok = hd.magic == INCMAGIC && hd.version == INCVERSION && hd.checked >= 0
+    && hd.funcs >= 0 && hd.checked <= (r.end - r.p) / (long) sizeof(FuncKey)
+    && hd.funcs <= (r.end - r.p) / (long) sizeof(FuncKey);
+  if (!r.ok) return;
+  inc->checked = (FuncKey *) need(malloc(n + sizeof(FuncKey)));
+  memcpy(inc->checked, r.p, n);
+  r.p += n;
+  inc->nchecked = hd.checked;
+  inc->codes = (FuncCode *) need(calloc(hd.funcs + 1, sizeof(FuncCode)));
+  for (k = 0; r.ok && k < hd.funcs; k++)
+  { inc->ncode = k + 1;
+    readCode(&r, &inc->codes[k]);
+  }
+  if (!r.ok)
+  { for (k = 0; k < inc->ncode; k++) freeCode(&inc->codes[k], FALSE);
+    inc->ncode = inc->nchecked = 0;
+    return;
+  }
+  qsort(inc->checked, inc->nchecked, sizeof(FuncKey), compareKeys);
+  qsort(inc->codes, inc->ncode, sizeof(FuncCode), compareCodes);
+}
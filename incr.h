@@ -0,0 +1,125 @@
+/****************************************************/
+/* File: incr.h                                     */
+/* Incremental compilation interface for the        */
+/* C-minus compiler: the type checks and the code   */
+/* of each function kept from the last compile      */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _INCR_H_
+#define _INCR_H_
+
+#include "code.h"
+#include "ir.h"
+
+/* The cache file <program>.inc of -incremental
+ * keeps, from the last compile of a program without
+ * errors, the check key of each function that type
+ * checked and the TM code made for each function
+ * under its code key. The check key hashes the tree
+ * of a function as parsed and the declarations of
+ * the globals and functions it names; the code key
+ * hashes its tree once the tree passes ran, with
+ * lines counted from its first, where each name it
+ * uses is in memory, the functions it calls and the
+ * options. The next compile skips type checking a
+ * function whose check key is kept, and places the
+ * code kept under the code key of a function instead
+ * of generating it. Its calls are linked to where
+ * the callees are placed this time. The code of a
+ * function is kept before the peephole optimizer,
+ * which then runs over the whole program. None is
+ * kept while a profile is in use.
+ */
+
+/* the hash of a function, with what it depends on */
+typedef unsigned long long FuncKey;
+
+/* a function the kept code calls; for the IR passes,
+ * whether it stored to memory when the code was made
+ */
+typedef struct
+{ char * name;
+  int storesMem;
+  int ir;        /* TRUE if the IR of the caller calls it */
+} KeptCallee;
+
+/* the code of a function, as kept in the cache */
+typedef struct FuncCodeRec
+{ char * name;
+  FuncKey key;
+  int entry;          /* from the start of its code */
+  int stores;         /* TRUE if its IR stores itself */
+  KeptCallee * callee;
+  int ncallee;
+  int * call;         /* the callee of each instruction, -1 if none */
+  TmPiece code;
+} FuncCode;
+
+/* Function mixKey returns hash h with v added */
+FuncKey mixKey(FuncKey h, unsigned long long v);
+
+/* Procedure loadIncremental reads the cache file
+ * name into cc->incr; a missing or damaged file
+ * leaves the cache empty
+ */
+void loadIncremental(char * name);
+
+/* Function saveIncremental writes what this compile
+ * checked and made to the cache file name; it
+ * returns FALSE if it cannot
+ */
+int saveIncremental(char * name);
+
+/* Procedure freeIncremental releases cc->incr */
+void freeIncremental(void);
+
+/* Procedure beginChecks indexes the declarations of
+ * the checked syntax tree for wasChecked
+ */
+void beginChecks(TreeNode * syntaxTree);
+
+/* Function wasChecked returns TRUE if function t
+ * type checked before with its check key
+ */
+int wasChecked(TreeNode * t);
+
+/* Procedure beginCodes indexes the declarations of
+ * the tree the passes left, for the functions whose
+ * code is to be placed, under the options of hash
+ * settings
+ */
+void beginCodes(TreeNode * syntaxTree, FuncKey settings);
+
+/* Function keptCode returns the code kept for
+ * function t, or NULL if it has to be generated
+ */
+FuncCode * keptCode(TreeNode * t);
+
+/* Procedure checkKept builds the IR of the functions
+ * of the list all whose kept code was made while a
+ * function they call stored to memory differently,
+ * after findStores; it notes what the others store
+ * and call
+ */
+void checkKept(IrFunc all);
+
+/* Procedure placeCode places the code kept for
+ * function t at the next location
+ */
+void placeCode(TreeNode * t);
+
+/* Procedures beginCode and endCode surround the code
+ * generated for function t
+ */
+void beginCode(TreeNode * t);
+void endCode(TreeNode * t);
+
+/* Procedure keepCode cuts the code generated for
+ * each function, once its calls are linked, to be
+ * saved
+ */
+void keepCode(void);
+
+#endif
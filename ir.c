@@ -0,0 +1,1063 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Mid-level intermediate representation for the    */
+/* C-minus compiler: translation of the syntax tree */
+/* into basic blocks and conversion to SSA form     */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "code.h"
+#include "ir.h"
+#include "profile.h"
+#include "incr.h"
+#include "context.h"
+
+/* The state of the function being translated, one
+ * copy per thread
+ */
+
+/* the function and block being translated */
+static __thread IrFunc curFunc;
+static __thread IrBlock curBlock;
+
+/* varOf maps the frame location of a parameter or
+ * scalar local to the register naming it until SSA
+ * renaming; isVar flags those registers
+ */
+static __thread int * varOf = NULL;
+static __thread char * isVar = NULL;
+static __thread int varMax = 0;
+
+/* retVar receives the value returned in an inlined
+ * body, and retBlock follows that body; retBlock is
+ * NULL outside inlined calls
+ */
+static __thread int retVar = NOREG;
+static __thread IrBlock retBlock = NULL;
+
+/**************************************************/
+/***********   IR construction utilities  *********/
+/**************************************************/
+
+/* Function irNewInst creates an instruction with
+ * room for narg operands, all NOREG
+ */
+IrInst irNewInst(IrOp op, int narg)
+{ IrInst i = (IrInst) malloc(sizeof(struct IrInstRec));
+  int k;
+  i->op = op;
+  i->dst = NOREG;
+  i->narg = narg;
+  i->arg = narg > 0 ? (int *) malloc(narg * sizeof(int)) : NULL;
+  for (k=0; k < narg; k++) i->arg[k] = NOREG;
+  i->imm = 0;
+  i->breg = gp;
+  i->binop = ENDFILE;
+  i->callee = NULL;
+  i->line = 0;
+  i->block = NULL;
+  i->prev = i->next = NULL;
+  return i;
+}
+
+/* Function irNewBlock adds an empty block to f */
+IrBlock irNewBlock(IrFunc f)
+{ IrBlock b = (IrBlock) malloc(sizeof(struct IrBlockRec));
+  if (f->nblock == f->maxblock)
+  { f->maxblock = f->maxblock ? 2*f->maxblock : 16;
+    f->block = (IrBlock *) realloc(f->block, f->maxblock * sizeof(IrBlock));
+  }
+  b->id = f->nextId++;
+  b->first = b->last = NULL;
+  b->succ[0] = b->succ[1] = NULL;
+  b->nsucc = 0;
+  b->pred = NULL;
+  b->npred = 0;
+  b->idom = NULL;
+  b->rpo = -1;
+  b->mark = NULL;
+  b->line = 0;
+  b->count = -1;
+  f->block[f->nblock++] = b;
+  return b;
+}
+
+/* Function irNewVreg returns a fresh register of f */
+int irNewVreg(IrFunc f)
+{ return f->nvreg++; }
+
+/* Procedure irAppend adds i at the end of block b */
+void irAppend(IrBlock b, IrInst i)
+{ i->block = b;
+  i->prev = b->last;
+  i->next = NULL;
+  if (b->last == NULL) b->first = i;
+  else b->last->next = i;
+  b->last = i;
+}
+
+/* Procedure irInsertBefore puts i in front of pos */
+void irInsertBefore(IrInst pos, IrInst i)
+{ IrBlock b = pos->block;
+  i->block = b;
+  i->prev = pos->prev;
+  i->next = pos;
+  if (pos->prev == NULL) b->first = i;
+  else pos->prev->next = i;
+  pos->prev = i;
+}
+
+/* Procedure irRemove unlinks i from its block */
+void irRemove(IrInst i)
+{ IrBlock b = i->block;
+  if (i->prev == NULL) b->first = i->next;
+  else i->prev->next = i->next;
+  if (i->next == NULL) b->last = i->prev;
+  else i->next->prev = i->prev;
+  i->prev = i->next = NULL;
+  i->block = NULL;
+}
+
+/* Function irHasSideEffect returns TRUE if i may not
+ * be removed even when its result is unused
+ */
+int irHasSideEffect(IrInst i)
+{ switch (i->op)
+  { case IrStore: case IrIn: case IrOut: case IrCall:
+    case IrJmp: case IrBr: case IrRet:
+      return TRUE;
+    case IrBin:
+      /* division by zero stops the TM */
+      return i->binop == OVER;
+    default:
+      return FALSE;
+  }
+}
+
+/**************************************************/
+/***********   Translation of the tree    *********/
+/**************************************************/
+
+/* variable kinds, as found by lookupVar */
+typedef enum {GlobalVar, GlobalArray, LocalVar, LocalArray} VarKind;
+
+/* Function lookupVar classifies the variable name
+ * seen from the current function; loc is set to its
+ * memory location. Array parameters hold an address
+ * and are LocalVar, like scalars.
+ */
+static VarKind lookupVar(char * name, int * loc)
+{ ExpType type = type_lookup(curFunc->name, name);
+  *loc = st_lookup("temp", name);
+  if (cc->symtab.scope_name == globalName)
+    return type == IntegerArray ? GlobalArray : GlobalVar;
+  if (*loc < curFunc->nparam || type != IntegerArray)
+    return LocalVar;
+  return LocalArray;
+}
+
+/* Function newVar returns a fresh register naming
+ * a variable until SSA renaming
+ */
+static int newVar(void)
+{ int v = irNewVreg(curFunc);
+  if (v >= varMax)
+  { int old = varMax;
+    varMax = 2*v + 16;
+    isVar = (char *) realloc(isVar, varMax);
+    memset(isVar + old, 0, varMax - old);
+  }
+  isVar[v] = TRUE;
+  return v;
+}
+
+/* Function emitInst appends an instruction to the
+ * current block
+ */
+static IrInst emitInst(IrOp op, int narg)
+{ IrInst i = irNewInst(op, narg);
+  irAppend(curBlock, i);
+  return i;
+}
+
+/* Function emitConst emits dst = val */
+static int emitConst(int val)
+{ IrInst i = emitInst(IrConst, 0);
+  i->dst = irNewVreg(curFunc);
+  i->imm = val;
+  return i->dst;
+}
+
+/* Function readVar copies the current value of
+ * variable var, so that a later assignment in the
+ * same expression does not change it
+ */
+static int readVar(int var)
+{ IrInst i = emitInst(IrCopy, 1);
+  i->arg[0] = var;
+  i->dst = irNewVreg(curFunc);
+  return i->dst;
+}
+
+/* Procedure writeVar emits var = v */
+static void writeVar(int var, int v)
+{ IrInst i = emitInst(IrCopy, 1);
+  i->arg[0] = v;
+  i->dst = var;
+}
+
+/* Procedure emitJmp ends the current block with a
+ * jump to target
+ */
+static void emitJmp(IrBlock target)
+{ emitInst(IrJmp, 0);
+  curBlock->succ[0] = target;
+  curBlock->nsucc = 1;
+}
+
+/* Procedure emitBr ends the current block with a
+ * branch on c
+ */
+static void emitBr(int c, IrBlock t, IrBlock f)
+{ IrInst i = emitInst(IrBr, 1);
+  i->arg[0] = c;
+  curBlock->succ[0] = t;
+  curBlock->succ[1] = f;
+  curBlock->nsucc = 2;
+}
+
+static int lowerExp(TreeNode * t);
+static void lowerStmts(TreeNode * t);
+
+/* Function value translates expression t and
+ * returns the register holding its value
+ */
+static int value(TreeNode * t)
+{ int v = lowerExp(t);
+  return v == NOREG ? emitConst(0) : v;
+}
+
+/* Procedure arrayBase fills the address of the
+ * element 0 of array name into memory instruction i
+ */
+static void arrayBase(IrInst i, char * name)
+{ int loc;
+  switch (lookupVar(name, &loc))
+  { case GlobalArray:
+      i->breg = gp;
+      i->imm = loc;
+      break;
+    case LocalArray:
+      i->breg = fp;
+      i->imm = -loc;
+      break;
+    default: /* array parameter */
+      i->arg[0] = readVar(varOf[loc]);
+      break;
+  }
+}
+
+/* Function lowerElement evaluates the index of the
+ * array element t and returns a memory instruction
+ * op addressing it, not yet placed in a block
+ */
+static IrInst lowerElement(IrOp op, TreeNode * t)
+{ IrInst i = irNewInst(op, op == IrStore ? 3 : 2), a;
+  TreeNode * index = t->child[0];
+  int idx = NOREG;
+  if (index->nodekind != ExpK || index->kind.exp != ConstK)
+    idx = value(index);
+  arrayBase(i, t->attr.name);
+  if (idx == NOREG) i->imm -= index->attr.val;
+  i->arg[1] = idx;
+  if (op == IrStore && i->arg[0] != NOREG && idx != NOREG)
+  { a = emitInst(IrAddr, 2);
+    a->arg[0] = i->arg[0];
+    a->arg[1] = idx;
+    a->dst = irNewVreg(curFunc);
+    i->arg[0] = a->dst;
+    i->arg[1] = NOREG;
+  }
+  return i;
+}
+
+/* Function lowerCall translates call t; arguments
+ * are evaluated last to first, as cgen does
+ */
+static int lowerCall(TreeNode * t)
+{ TreeNode * a, ** args;
+  IrInst i;
+  int n = 0, k;
+  if (t->attr.name == inputName)
+  { i = emitInst(IrIn, 0);
+    i->dst = irNewVreg(curFunc);
+    return i->dst;
+  }
+  if (t->attr.name == outputName)
+  { k = value(t->child[0]);
+    i = emitInst(IrOut, 1);
+    i->arg[0] = k;
+    return NOREG;
+  }
+  for (a = t->child[0]; a != NULL; a = a->sibling) n++;
+  i = irNewInst(IrCall, n);
+  args = (TreeNode **) malloc((n + 1) * sizeof(TreeNode *));
+  for (a = t->child[0], k = 0; a != NULL; a = a->sibling) args[k++] = a;
+  for (k = n-1; k >= 0; k--)
+    i->arg[k] = value(args[k]);
+  free(args);
+  i->callee = getpl(t->attr.name);
+  i->line = t->lineno;
+  if (i->callee->treenode->type != Void)
+    i->dst = irNewVreg(curFunc);
+  irAppend(curBlock, i);
+  return i->dst;
+}
+
+/* Function lowerExp translates expression t into
+ * the current block; it returns the register with
+ * the value, or NOREG for a void call
+ */
+static int lowerExp(TreeNode * t)
+{ IrInst i;
+  IrBlock savedBlock;
+  TreeNode * lhs;
+  int v, loc, savedVar;
+  switch (t->kind.exp)
+  { case ConstK:
+      return emitConst(t->attr.val);
+    case IdK:
+      switch (lookupVar(t->attr.name, &loc))
+      { case LocalVar:
+          return readVar(varOf[loc]);
+        case GlobalVar:
+          i = emitInst(IrLoad, 2);
+          i->imm = loc;
+          break;
+        default: /* an array passed as argument */
+          i = emitInst(IrAddr, 2);
+          arrayBase(i, t->attr.name);
+          break;
+      }
+      i->dst = irNewVreg(curFunc);
+      return i->dst;
+    case ArrIdK:
+      i = lowerElement(IrLoad, t);
+      i->dst = irNewVreg(curFunc);
+      irAppend(curBlock, i);
+      return i->dst;
+    case OpK:
+      i = irNewInst(IrBin, 2);
+      i->arg[0] = value(t->child[0]);
+      i->arg[1] = value(t->child[1]);
+      i->binop = t->attr.op;
+      i->dst = irNewVreg(curFunc);
+      irAppend(curBlock, i);
+      return i->dst;
+    case AssignK:
+      lhs = t->child[0];
+      if (lhs->kind.exp == ArrIdK)
+      { i = lowerElement(IrStore, lhs);
+        v = value(t->child[1]);
+        i->arg[2] = v;
+        irAppend(curBlock, i);
+      }
+      else if (lookupVar(lhs->attr.name, &loc) == LocalVar)
+      { v = value(t->child[1]);
+        writeVar(varOf[loc], v);
+      }
+      else
+      { v = value(t->child[1]);
+        i = emitInst(IrStore, 3);
+        i->imm = loc;
+        i->arg[2] = v;
+      }
+      return v;
+    case CallK:
+      return lowerCall(t);
+    case InlineK:
+      for (lhs = t->child[0]; lhs != NULL; lhs = lhs->sibling)
+        lowerExp(lhs);
+      savedVar = retVar;
+      savedBlock = retBlock;
+      retVar = t->type == Void ? NOREG : newVar();
+      retBlock = irNewBlock(curFunc);
+      lowerStmts(t->child[1]);
+      emitJmp(retBlock);
+      curBlock = retBlock;
+      v = retVar == NOREG ? NOREG : readVar(retVar);
+      retVar = savedVar;
+      retBlock = savedBlock;
+      return v;
+    default:
+      return NOREG;
+  }
+}
+
+/* Procedure lowerStmt translates statement t */
+/* Procedure tagBlock marks b as the start of
+ * construct kind of line in the debug map, and
+ * gives it the count of that construct in the profile
+ */
+static void tagBlock(IrBlock b, char * kind, int line)
+{ b->mark = kind;
+  b->line = line;
+  b->count = profileCount(kind, line, NULL);
+}
+
+static void lowerStmt(TreeNode * t)
+{ IrBlock thenB, elseB, join, pre, body;
+  IrInst i;
+  int c;
+  if (t->nodekind == ExpK)
+  { lowerExp(t);
+    return;
+  }
+  if (t->nodekind != StmtK) return;
+  switch (t->kind.stmt)
+  { case CompK:
+      lowerStmts(t->child[1]);
+      break;
+    case IfK:
+      c = value(t->child[0]);
+      thenB = irNewBlock(curFunc);
+      elseB = t->child[2] != NULL ? irNewBlock(curFunc) : NULL;
+      join = irNewBlock(curFunc);
+      tagBlock(thenB, "then", t->lineno);
+      if (elseB != NULL) tagBlock(elseB, "else", t->lineno);
+      tagBlock(join, "endif", t->lineno);
+      emitBr(c, thenB, elseB != NULL ? elseB : join);
+      curBlock = thenB;
+      lowerStmts(t->child[1]);
+      emitJmp(join);
+      if (elseB != NULL)
+      { curBlock = elseB;
+        lowerStmts(t->child[2]);
+        emitJmp(join);
+      }
+      curBlock = join;
+      break;
+    case IterK:
+      /* the loop is rotated: the test is repeated at
+         the bottom of the body, and a preheader block
+         is entered once before the first iteration */
+      body = irNewBlock(curFunc);
+      if (t->child[0]->nodekind == ExpK && t->child[0]->kind.exp == ConstK)
+      { if (t->child[0]->attr.val == 0) break;
+        emitJmp(body);
+        curBlock = body;
+        lowerStmts(t->child[1]);
+        emitJmp(body);
+        curBlock = irNewBlock(curFunc);
+        break;
+      }
+      pre = irNewBlock(curFunc);
+      join = irNewBlock(curFunc);
+      tagBlock(pre, "loop", t->lineno);
+      tagBlock(body, "body", t->lineno);
+      c = value(t->child[0]);
+      emitBr(c, pre, join);
+      curBlock = pre;
+      emitJmp(body);
+      curBlock = body;
+      lowerStmts(t->child[1]);
+      c = value(t->child[0]);
+      emitBr(c, body, join);
+      curBlock = join;
+      break;
+    case RetK:
+      if (retBlock != NULL)
+      { if (t->child[0] != NULL)
+        { c = value(t->child[0]);
+          if (retVar != NOREG) writeVar(retVar, c);
+        }
+        emitJmp(retBlock);
+      }
+      else
+      { c = t->child[0] != NULL ? value(t->child[0]) : NOREG;
+        i = emitInst(IrRet, 1);
+        i->arg[0] = c;
+      }
+      /* code after a return is unreachable */
+      curBlock = irNewBlock(curFunc);
+      break;
+    default:
+      break;
+  }
+}
+
+/* Procedure lowerStmts translates a statement list */
+static void lowerStmts(TreeNode * t)
+{ for (; t != NULL; t = t->sibling)
+    lowerStmt(t);
+}
+
+/* Function lowerFunc translates the function
+ * declaration t into a flow graph
+ */
+static IrFunc lowerFunc(TreeNode * t)
+{ IrFunc f = (IrFunc) malloc(sizeof(struct IrFuncRec));
+  IrInst i;
+  int k;
+  f->name = t->attr.name;
+  f->tree = t;
+  f->scope = scope_lookup(t->attr.name);
+  f->pl = getpl(t->attr.name);
+  f->block = NULL;
+  f->nblock = f->maxblock = 0;
+  f->nextId = 0;
+  f->nvreg = 0;
+  f->nparam = f->scope->paramNum;
+  f->storesMem = TRUE;
+  f->kept = NULL;
+  f->next = NULL;
+  curFunc = f;
+  if (varMax > 0) memset(isVar, 0, varMax);
+  varOf = (int *) realloc(varOf, (f->scope->frameSize + 1) * sizeof(int));
+  for (k = 0; k < f->scope->frameSize; k++)
+    varOf[k] = newVar();
+  push_scope(f->scope);
+  curBlock = irNewBlock(f);
+  for (k = 0; k < f->nparam; k++)
+  { i = emitInst(IrParam, 0);
+    i->dst = varOf[k];
+    i->imm = k;
+  }
+  retVar = NOREG;
+  retBlock = NULL;
+  lowerStmt(t->child[2]);
+  emitInst(IrRet, 1);
+  pop_scope();
+  return f;
+}
+
+/**************************************************/
+/***********   Flow graph and dominators  *********/
+/**************************************************/
+
+/* Procedure markReachable sets rpo to 0 in the
+ * blocks reachable from b
+ */
+static void markReachable(IrBlock b)
+{ int k;
+  if (b->rpo == 0) return;
+  b->rpo = 0;
+  for (k = 0; k < b->nsucc; k++)
+    markReachable(b->succ[k]);
+}
+
+/* Procedure buildPreds removes the blocks of f that
+ * cannot be reached from the entry and fills the
+ * predecessor lists of the others
+ */
+static void buildPreds(IrFunc f)
+{ IrBlock b;
+  int i, j, k;
+  for (i = 0; i < f->nblock; i++) f->block[i]->rpo = -1;
+  markReachable(f->block[0]);
+  for (i = j = 0; i < f->nblock; i++)
+    if (f->block[i]->rpo == 0) f->block[j++] = f->block[i];
+  f->nblock = j;
+  for (i = 0; i < f->nblock; i++)
+    for (k = 0; k < f->block[i]->nsucc; k++)
+      f->block[i]->succ[k]->npred++;
+  for (i = 0; i < f->nblock; i++)
+  { b = f->block[i];
+    b->pred = (IrBlock *) malloc((b->npred + 1) * sizeof(IrBlock));
+    b->npred = 0;
+  }
+  for (i = 0; i < f->nblock; i++)
+    for (k = 0; k < f->block[i]->nsucc; k++)
+    { b = f->block[i]->succ[k];
+      b->pred[b->npred++] = f->block[i];
+    }
+}
+
+/* postorder numbering used by irDominators */
+static __thread int postCount;
+
+/* Function edgeCount returns how often the profile
+ * went from b to its successor k, or -1 if unknown:
+ * the count of an arm entered from b only, or of a
+ * join less that of the arm that falls into it
+ */
+static long edgeCount(IrBlock b, int k)
+{ IrBlock s = b->succ[k], o = b->succ[1-k];
+  if (s->npred == 1) return s->count;
+  if (o->npred == 1 && s->count >= 0 && o->count >= 0)
+    return s->count > o->count ? s->count - o->count : 0;
+  return -1;
+}
+
+/* The successor visited first is the one placed
+ * last in reverse postorder, next to the join of the
+ * two arms: that arm falls through into the join
+ * while the other jumps over it, so the arm taken
+ * more often in the profile is visited first
+ */
+static void postorder(IrBlock b, IrBlock * order)
+{ int k, first = 0;
+  long c0, c1;
+  b->rpo = -2; /* visiting */
+  if (b->nsucc == 2)
+  { c0 = edgeCount(b, 0);
+    c1 = edgeCount(b, 1);
+    if (c0 >= 0 && c1 >= 0 && c1 > c0) first = 1;
+  }
+  for (k = 0; k < b->nsucc; k++)
+    if (b->succ[(k + first) % b->nsucc]->rpo == -1)
+      postorder(b->succ[(k + first) % b->nsucc], order);
+  order[postCount++] = b;
+}
+
+/* Function intersect returns the nearest common
+ * dominator of a and b
+ */
+static IrBlock intersect(IrBlock a, IrBlock b)
+{ while (a != b)
+  { while (a->rpo > b->rpo) a = a->idom;
+    while (b->rpo > a->rpo) b = b->idom;
+  }
+  return a;
+}
+
+/* Procedure irDominators orders the blocks of f in
+ * reverse postorder and computes their idom, by the
+ * iterative algorithm of Cooper, Harvey and Kennedy
+ */
+void irDominators(IrFunc f)
+{ IrBlock * order = (IrBlock *) malloc(f->nblock * sizeof(IrBlock));
+  IrBlock b, d;
+  int i, k, changed;
+  for (i = 0; i < f->nblock; i++)
+  { f->block[i]->rpo = -1;
+    f->block[i]->idom = NULL;
+  }
+  postCount = 0;
+  postorder(f->block[0], order);
+  for (i = 0; i < postCount; i++)
+  { f->block[i] = order[postCount-1-i];
+    f->block[i]->rpo = i;
+  }
+  f->nblock = postCount;
+  free(order);
+  f->block[0]->idom = f->block[0];
+  do
+  { changed = FALSE;
+    for (i = 1; i < f->nblock; i++)
+    { b = f->block[i];
+      d = NULL;
+      for (k = 0; k < b->npred; k++)
+        if (b->pred[k]->idom != NULL)
+          d = d == NULL ? b->pred[k] : intersect(b->pred[k], d);
+      if (d != b->idom)
+      { b->idom = d;
+        changed = TRUE;
+      }
+    }
+  } while (changed);
+  f->block[0]->idom = NULL;
+}
+
+/* Function irDominates returns TRUE if block a
+ * dominates block b
+ */
+int irDominates(IrBlock a, IrBlock b)
+{ while (b != NULL && b != a) b = b->idom;
+  return b == a;
+}
+
+/**************************************************/
+/***********   Conversion to SSA form     *********/
+/**************************************************/
+
+/* curName holds the SSA register currently naming
+ * each variable during renaming; the undo log lets
+ * renameBlock restore it on the way back up the
+ * dominator tree
+ */
+static __thread int * curName;
+static __thread int * undoVar;
+static __thread int * undoName;
+static __thread int undoCount, undoMax;
+static __thread int undefReg;
+
+/* Function isVarReg returns TRUE if v still names
+ * a variable
+ */
+static int isVarReg(int v)
+{ return v >= 0 && v < varMax && isVar[v]; }
+
+/* Function nameOf returns the register holding the
+ * current value of variable v; a variable read
+ * before any assignment reads 0
+ */
+static int nameOf(IrFunc f, int v)
+{ IrInst i;
+  if (curName[v] != NOREG) return curName[v];
+  if (undefReg == NOREG)
+  { i = irNewInst(IrConst, 0);
+    i->dst = undefReg = irNewVreg(f);
+    if (f->block[0]->first == NULL) irAppend(f->block[0], i);
+    else irInsertBefore(f->block[0]->first, i);
+  }
+  return undefReg;
+}
+
+/* Procedure renameBlock gives every assignment to a
+ * variable in b and the blocks it dominates its own
+ * register, and rewrites the reads accordingly
+ */
+static void renameBlock(IrFunc f, IrBlock b)
+{ IrInst i;
+  IrBlock s;
+  int k, j, mark = undoCount, v;
+  for (i = b->first; i != NULL; i = i->next)
+  { if (i->op != IrPhi)
+      for (k = 0; k < i->narg; k++)
+        if (isVarReg(i->arg[k])) i->arg[k] = nameOf(f, i->arg[k]);
+    if (isVarReg(i->dst))
+    { if (undoCount == undoMax)
+      { undoMax = undoMax ? 2*undoMax : 64;
+        undoVar = (int *) realloc(undoVar, undoMax * sizeof(int));
+        undoName = (int *) realloc(undoName, undoMax * sizeof(int));
+      }
+      v = i->dst;
+      undoVar[undoCount] = v;
+      undoName[undoCount++] = curName[v];
+      i->dst = curName[v] = irNewVreg(f);
+    }
+  }
+  for (j = 0; j < b->nsucc; j++)
+  { s = b->succ[j];
+    for (k = 0; k < s->npred && s->pred[k] != b; k++) ;
+    for (i = s->first; i != NULL && i->op == IrPhi; i = i->next)
+      if (isVarReg(i->arg[k])) i->arg[k] = nameOf(f, i->arg[k]);
+  }
+  for (j = b->rpo + 1; j < f->nblock; j++)
+    if (f->block[j]->idom == b) renameBlock(f, f->block[j]);
+  while (undoCount > mark)
+  { undoCount--;
+    curName[undoVar[undoCount]] = undoName[undoCount];
+  }
+}
+
+/* Procedure buildSsa inserts phi instructions at the
+ * iterated dominance frontiers of the assignments
+ * to each variable live across blocks, then renames
+ * the variables into SSA registers
+ */
+static void buildSsa(IrFunc f)
+{ int n = f->nblock, nvar = f->nvreg;
+  char * df = (char *) calloc(n * n, 1);
+  char * global = (char *) calloc(nvar, 1);
+  int * killed = (int *) malloc(nvar * sizeof(int));
+  int * hasPhi = (int *) malloc(n * sizeof(int));
+  int * inWork = (int *) malloc(n * sizeof(int));
+  int * work = (int *) malloc(n * sizeof(int));
+  IrBlock b, r;
+  IrInst i, phi;
+  int v, k, j, nwork;
+  /* dominance frontiers */
+  for (j = 0; j < n; j++)
+  { b = f->block[j];
+    if (b->npred < 2) continue;
+    for (k = 0; k < b->npred; k++)
+      for (r = b->pred[k]; r != b->idom; r = r->idom)
+        df[r->rpo * n + j] = 1;
+  }
+  /* variables read before being assigned in a block */
+  for (v = 0; v < nvar; v++) killed[v] = -1;
+  for (j = 0; j < n; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { for (k = 0; k < i->narg; k++)
+        if (isVarReg(i->arg[k]) && killed[i->arg[k]] != j)
+          global[i->arg[k]] = TRUE;
+      if (isVarReg(i->dst)) killed[i->dst] = j;
+    }
+  for (j = 0; j < n; j++) hasPhi[j] = inWork[j] = -1;
+  for (v = 0; v < nvar; v++)
+  { if (!global[v]) continue;
+    nwork = 0;
+    for (j = 0; j < n; j++)
+      for (i = f->block[j]->first; i != NULL; i = i->next)
+        if (i->dst == v)
+        { inWork[j] = v;
+          work[nwork++] = j;
+          break;
+        }
+    while (nwork > 0)
+    { b = f->block[work[--nwork]];
+      for (j = 0; j < n; j++)
+      { if (!df[b->rpo * n + j] || hasPhi[j] == v) continue;
+        r = f->block[j];
+        phi = irNewInst(IrPhi, r->npred);
+        for (k = 0; k < r->npred; k++) phi->arg[k] = v;
+        phi->dst = v;
+        phi->imm = v;
+        if (r->first == NULL) irAppend(r, phi);
+        else irInsertBefore(r->first, phi);
+        hasPhi[j] = v;
+        if (inWork[j] != v)
+        { inWork[j] = v;
+          work[nwork++] = j;
+        }
+      }
+    }
+  }
+  /* renaming */
+  curName = (int *) malloc(nvar * sizeof(int));
+  for (v = 0; v < nvar; v++) curName[v] = NOREG;
+  undoCount = 0;
+  undefReg = NOREG;
+  renameBlock(f, f->block[0]);
+  free(curName);
+  free(df);
+  free(global);
+  free(killed);
+  free(hasPhi);
+  free(inWork);
+  free(work);
+}
+
+/**************************************************/
+/***********   Cleanup                    *********/
+/**************************************************/
+
+/* Function findRep follows the replacements in rep */
+static int findRep(int * rep, int v)
+{ while (v != NOREG && rep[v] != v) v = rep[v];
+  return v;
+}
+
+/* Procedure irCleanup propagates copies, removes
+ * trivial phis and deletes dead instructions
+ */
+void irCleanup(IrFunc f)
+{ int * rep = (int *) malloc(f->nvreg * sizeof(int));
+  IrInst * defOf = (IrInst *) malloc(f->nvreg * sizeof(IrInst));
+  char * live = (char *) malloc(f->nvreg);
+  IrInst * work;
+  IrInst i, next;
+  int b, k, v, x, changed, nwork;
+  do
+  { changed = FALSE;
+    for (v = 0; v < f->nvreg; v++) rep[v] = v;
+    for (b = 0; b < f->nblock; b++)
+      for (i = f->block[b]->first; i != NULL; i = next)
+      { next = i->next;
+        if (i->op == IrCopy && i->dst != NOREG)
+        { rep[i->dst] = findRep(rep, i->arg[0]);
+          irRemove(i);
+          changed = TRUE;
+        }
+        else if (i->op == IrPhi)
+        { x = NOREG;
+          for (k = 0; k < i->narg; k++)
+          { v = findRep(rep, i->arg[k]);
+            if (v == i->dst || v == x) continue;
+            if (x != NOREG) break;
+            x = v;
+          }
+          if (k == i->narg && x != NOREG)
+          { rep[i->dst] = x;
+            irRemove(i);
+            changed = TRUE;
+          }
+        }
+      }
+    for (b = 0; b < f->nblock; b++)
+      for (i = f->block[b]->first; i != NULL; i = i->next)
+        for (k = 0; k < i->narg; k++)
+          i->arg[k] = findRep(rep, i->arg[k]);
+  } while (changed);
+  /* dead code: keep what side effects need; the work
+   * list holds at most every instruction once */
+  nwork = 0;
+  for (b = 0; b < f->nblock; b++)
+    for (i = f->block[b]->first; i != NULL; i = i->next) nwork++;
+  work = (IrInst *) malloc((nwork + 1) * sizeof(IrInst));
+  nwork = 0;
+  for (v = 0; v < f->nvreg; v++)
+  { defOf[v] = NULL;
+    live[v] = FALSE;
+  }
+  for (b = 0; b < f->nblock; b++)
+    for (i = f->block[b]->first; i != NULL; i = i->next)
+    { if (i->dst != NOREG) defOf[i->dst] = i;
+      if (irHasSideEffect(i))
+      { if (i->dst != NOREG) live[i->dst] = TRUE;
+        work[nwork++] = i;
+      }
+    }
+  while (nwork > 0)
+  { i = work[--nwork];
+    for (k = 0; k < i->narg; k++)
+    { v = i->arg[k];
+      if (v == NOREG || live[v] || defOf[v] == NULL) continue;
+      live[v] = TRUE;
+      if (!irHasSideEffect(defOf[v])) work[nwork++] = defOf[v];
+    }
+  }
+  for (b = 0; b < f->nblock; b++)
+    for (i = f->block[b]->first; i != NULL; i = next)
+    { next = i->next;
+      if (!irHasSideEffect(i) && (i->dst == NOREG || !live[i->dst]))
+        irRemove(i);
+    }
+  free(rep);
+  free(defOf);
+  free(live);
+  free(work);
+}
+
+/* Function buildFuncIr translates function t of the
+ * checked syntax tree into a flow graph in SSA form
+ */
+IrFunc buildFuncIr(TreeNode * t)
+{ IrFunc f = lowerFunc(t);
+  buildPreds(f);
+  irDominators(f);
+  buildSsa(f);
+  irCleanup(f);
+  return f;
+}
+
+/* Function keptFunc returns a function without
+ * blocks for t, whose code -incremental kept
+ */
+static IrFunc keptFunc(TreeNode * t, struct FuncCodeRec * kept)
+{ IrFunc f = (IrFunc) calloc(1, sizeof(struct IrFuncRec));
+  f->name = t->attr.name;
+  f->tree = t;
+  f->scope = scope_lookup(t->attr.name);
+  f->pl = getpl(t->attr.name);
+  f->nparam = f->scope->paramNum;
+  f->storesMem = TRUE;
+  f->kept = kept;
+  return f;
+}
+
+/* Function buildIr translates each function of the
+ * checked syntax tree into a flow graph in SSA form
+ * and returns the list of functions; with
+ * -incremental, a function whose code was kept is
+ * not translated
+ */
+IrFunc buildIr(TreeNode * syntaxTree)
+{ IrFunc head = NULL, last = NULL, f;
+  struct FuncCodeRec * kept;
+  TreeNode * t;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+  { if (t->nodekind != DeclK || t->kind.decl != FuncK) continue;
+    if (cc->Incremental && (kept = keptCode(t)) != NULL)
+      f = keptFunc(t, kept);
+    else f = buildFuncIr(t);
+    if (last == NULL) head = f;
+    else last->next = f;
+    last = f;
+  }
+  return head;
+}
+
+/**************************************************/
+/***********   Printing                   *********/
+/**************************************************/
+
+/* Procedure printAddr prints a memory operand */
+static void printAddr(IrInst i)
+{ if (i->arg[0] != NOREG) fprintf(cc->listing, "[t%d", i->arg[0]);
+  else fprintf(cc->listing, "[%s", i->breg == gp ? "gp" : "fp");
+  if (i->arg[1] != NOREG) fprintf(cc->listing, " - t%d", i->arg[1]);
+  fprintf(cc->listing, " %+d]", i->imm);
+}
+
+/* Function opString returns the text of a binop */
+static char * opString(TokenType op)
+{ switch (op)
+  { case PLUS: return "+";
+    case MINUS: return "-";
+    case TIMES: return "*";
+    case OVER: return "/";
+    case LT: return "<";
+    case LE: return "<=";
+    case GT: return ">";
+    case GE: return ">=";
+    case EQ: return "==";
+    case NE: return "!=";
+    default: return "?";
+  }
+}
+
+/* Procedure printInst prints one instruction */
+static void printInst(IrInst i)
+{ int k;
+  fprintf(cc->listing, "    ");
+  if (i->dst != NOREG) fprintf(cc->listing, "t%d = ", i->dst);
+  switch (i->op)
+  { case IrConst: fprintf(cc->listing, "%d", i->imm); break;
+    case IrParam: fprintf(cc->listing, "param %d", i->imm); break;
+    case IrCopy: fprintf(cc->listing, "t%d", i->arg[0]); break;
+    case IrBin:
+      fprintf(cc->listing, "t%d %s t%d", i->arg[0], opString(i->binop), i->arg[1]);
+      break;
+    case IrAddr: fprintf(cc->listing, "addr "); printAddr(i); break;
+    case IrLoad: fprintf(cc->listing, "load "); printAddr(i); break;
+    case IrStore:
+      fprintf(cc->listing, "store ");
+      printAddr(i);
+      fprintf(cc->listing, " = t%d", i->arg[2]);
+      break;
+    case IrIn: fprintf(cc->listing, "input"); break;
+    case IrOut: fprintf(cc->listing, "output t%d", i->arg[0]); break;
+    case IrCall:
+      fprintf(cc->listing, "call %s(", i->callee->name);
+      for (k = 0; k < i->narg; k++)
+        fprintf(cc->listing, k ? ", t%d" : "t%d", i->arg[k]);
+      fprintf(cc->listing, ")");
+      break;
+    case IrPhi:
+      fprintf(cc->listing, "phi(");
+      for (k = 0; k < i->narg; k++)
+        fprintf(cc->listing, k ? ", t%d B%d" : "t%d B%d", i->arg[k],
+                i->block->pred[k]->id);
+      fprintf(cc->listing, ")");
+      break;
+    case IrJmp: fprintf(cc->listing, "goto B%d", i->block->succ[0]->id); break;
+    case IrBr:
+      fprintf(cc->listing, "if t%d goto B%d else B%d", i->arg[0],
+              i->block->succ[0]->id, i->block->succ[1]->id);
+      break;
+    case IrRet:
+      if (i->arg[0] == NOREG) fprintf(cc->listing, "return");
+      else fprintf(cc->listing, "return t%d", i->arg[0]);
+      break;
+  }
+  fprintf(cc->listing, "\n");
+}
+
+/* Procedure printIr prints the functions in the
+ * list f to the listing file
+ */
+void printIr(IrFunc f)
+{ IrInst i;
+  int b, k;
+  for (; f != NULL; f = f->next)
+  { fprintf(cc->listing, "\nFunction %s:\n", f->name);
+    if (f->kept != NULL)
+      fprintf(cc->listing, "  code kept from the last compile\n");
+    for (b = 0; b < f->nblock; b++)
+    { fprintf(cc->listing, "  B%d:", f->block[b]->id);
+      if (f->block[b]->npred > 0) fprintf(cc->listing, "  preds");
+      for (k = 0; k < f->block[b]->npred; k++)
+        fprintf(cc->listing, " B%d", f->block[b]->pred[k]->id);
+      fprintf(cc->listing, "\n");
+      for (i = f->block[b]->first; i != NULL; i = i->next)
+        printInst(i);
+    }
+  }
+}
@@ -0,0 +1,153 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Mid-level intermediate representation for the    */
+/* C-minus compiler: basic blocks of three-address  */
+/* instructions over virtual registers, in SSA form */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+#include "globals.h"
+#include "symtab.h"
+
+/* NOREG marks an operand or result that is absent */
+#define NOREG (-1)
+
+/* Memory operands address base - index + imm, where
+ * base is a virtual register or, when NOREG, the
+ * machine register breg (gp or fp). A store never
+ * has both a base and an index register: the TM has
+ * two registers to spare for it besides the value.
+ */
+typedef enum
+{ IrConst,  /* dst = imm */
+  IrParam,  /* dst = parameter imm, found in its frame slot */
+  IrCopy,   /* dst = arg[0] */
+  IrBin,    /* dst = arg[0] binop arg[1] */
+  IrAddr,   /* dst = base arg[0] - index arg[1] + imm */
+  IrLoad,   /* dst = mem[base arg[0] - index arg[1] + imm] */
+  IrStore,  /* mem[base arg[0] - index arg[1] + imm] = arg[2] */
+  IrIn,     /* dst = input() */
+  IrOut,    /* output(arg[0]) */
+  IrCall,   /* dst = callee(arg[0], ..., arg[narg-1]) */
+  IrPhi,    /* dst = arg[k] coming from pred[k]; imm is the variable */
+  IrJmp,    /* goto succ[0] */
+  IrBr,     /* if arg[0] goto succ[0] else goto succ[1] */
+  IrRet     /* return arg[0], NOREG in a void function */
+} IrOp;
+
+typedef struct IrInstRec
+{ IrOp op;
+  int dst;          /* result register, NOREG if none */
+  int * arg;        /* operand registers, NOREG if unused */
+  int narg;
+  int imm;
+  int breg;         /* machine base register of a memory operand */
+  TokenType binop;  /* operator of IrBin */
+  FuncParam callee; /* function of IrCall */
+  int line;         /* source line of IrCall */
+  struct IrBlockRec * block;
+  struct IrInstRec * prev;
+  struct IrInstRec * next;
+} * IrInst;
+
+typedef struct IrBlockRec
+{ int id;
+  IrInst first, last;            /* last is the terminator */
+  struct IrBlockRec * succ[2];
+  int nsucc;
+  struct IrBlockRec ** pred;     /* phi arguments follow this order */
+  int npred;
+  struct IrBlockRec * idom;      /* immediate dominator, NULL at entry */
+  int rpo;                       /* position in reverse postorder */
+  char * mark;                   /* debug map kind, NULL if none */
+  int line;                      /* source line of the mark */
+  long count;                    /* runs in the profile, -1 if unknown */
+} * IrBlock;
+
+typedef struct IrFuncRec
+{ char * name;
+  TreeNode * tree;
+  ScopeList scope;
+  FuncParam pl;
+  IrBlock * block;   /* block[0] is the entry */
+  int nblock;
+  int maxblock;
+  int nextId;        /* numbers its blocks from 0 */
+  int nvreg;         /* registers are numbered 0 .. nvreg-1 */
+  int nparam;
+  int storesMem;     /* it or a function it calls may store */
+  struct FuncCodeRec * kept; /* code -incremental placed instead
+                                (incr.c), NULL if built; with
+                                kept code it has no blocks */
+  struct IrFuncRec * next;
+} * IrFunc;
+
+/* Function buildIr translates each function of the
+ * checked syntax tree into a flow graph in SSA form
+ * and returns the list of functions
+ */
+IrFunc buildIr(TreeNode * syntaxTree);
+
+/* Function buildFuncIr translates function t of the
+ * checked syntax tree into a flow graph in SSA form
+ */
+IrFunc buildFuncIr(TreeNode * t);
+
+/* Function irNewInst creates an instruction with
+ * room for narg operands, all NOREG
+ */
+IrInst irNewInst(IrOp op, int narg);
+
+/* Function irNewBlock adds an empty block to f */
+IrBlock irNewBlock(IrFunc f);
+
+/* Function irNewVreg returns a fresh register of f */
+int irNewVreg(IrFunc f);
+
+/* Procedure irAppend adds i at the end of block b */
+void irAppend(IrBlock b, IrInst i);
+
+/* Procedure irInsertBefore puts i in front of pos */
+void irInsertBefore(IrInst pos, IrInst i);
+
+/* Procedure irRemove unlinks i from its block */
+void irRemove(IrInst i);
+
+/* Function irHasSideEffect returns TRUE if i may not
+ * be removed even when its result is unused
+ */
+int irHasSideEffect(IrInst i);
+
+/* Procedure irDominators orders the blocks of f in
+ * reverse postorder and computes their idom; of two
+ * arms of a branch, the one the profile shows taken
+ * more often is placed last, to fall through into
+ * the code that follows them
+ */
+void irDominators(IrFunc f);
+
+/* Function irDominates returns TRUE if block a
+ * dominates block b
+ */
+int irDominates(IrBlock a, IrBlock b);
+
+/* Procedure irCleanup propagates copies, removes
+ * trivial phis and deletes dead instructions
+ */
+void irCleanup(IrFunc f);
+
+/* Procedure printIr prints the functions in the
+ * list f to the listing file
+ */
+void printIr(IrFunc f);
+
+/* Procedure irCodeGen generates TM code for the
+ * functions in the list f to the code file
+ */
+void irCodeGen(IrFunc f, char * codefile);
+
+#endif
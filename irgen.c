@@ -0,0 +1,1010 @@
+/****************************************************/
+/* File: irgen.c                                    */
+/* TM code generation from the IR of ir.c: out of   */
+/* SSA form, frame slots for the registers, and     */
+/* emission with a cache of the two accumulators    */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "code.h"
+#include "ir.h"
+#include "incr.h"
+#include "context.h"
+
+/* the function being generated */
+static __thread IrFunc gf;
+
+/* Per register facts, indexed by register:
+   useCount   number of operands naming it
+   defCount   number of instructions assigning it
+   defOf      its assignment when there is one
+   transient  its value is used once, by the next
+              instruction, and never leaves ac
+   needsSlot  it lives in a frame slot or a variable
+              register
+   slot       fp offset of that slot
+   regOf      its variable register, NOREG if it
+              lives in the slot
+*/
+static __thread int * useCount;
+static __thread int * defCount;
+static __thread IrInst * defOf;
+static __thread char * transient;
+static __thread char * needsSlot;
+static __thread int * slot;
+static __thread int * regOf;
+
+/* frame words: locals of the tree, then the slots */
+static __thread int frameWords;
+
+/* paramReg holds the variable register of each
+   parameter, NOREG if it stays in its slot, and
+   paramDead is set for parameters never used;
+   bodyLoc is where the code after the prologue
+   starts */
+static __thread int * paramReg;
+static __thread char * paramDead;
+static __thread int bodyLoc;
+
+/* hasFrameAddr is set if the address of a local
+   array is taken, which forbids tail calls */
+static __thread int hasFrameAddr;
+
+/* cached holds the register whose value is in ac
+   and in ac1, NOREG if none */
+static __thread int cached[2];
+
+/* pendingCmp is the operator of a comparison left
+   in ac as a difference for the branch after it */
+static __thread TokenType pendingCmp;
+
+/* blockLoc holds the code location of each block,
+   by layout position, -1 until it is emitted */
+static __thread int * blockLoc;
+
+/* jump fixups: jumps to blocks not yet emitted, or
+   to the epilogue when target is NULL */
+typedef struct
+{ int loc;
+  char * op;
+  int reg;
+  IrBlock target;
+} JumpFixup;
+
+static __thread JumpFixup * jumpFixups = NULL;
+static __thread int jumpCount = 0;
+static __thread int jumpMax = 0;
+
+/**************************************************/
+/***********   Out of SSA form            *********/
+/**************************************************/
+
+/* Procedure splitEdges puts an empty block on each
+ * edge from a block with two successors to a block
+ * with phis, so that the copies replacing the phis
+ * have a place of their own; the new block follows
+ * its predecessor in the layout
+ */
+static void splitEdges(IrFunc f)
+{ int n = f->nblock, j, k, m, count = 0;
+  IrBlock b, p, s;
+  IrBlock * layout;
+  IrInst jmp;
+  for (j = 0; j < n; j++)
+  { b = f->block[j];
+    if (b->first == NULL || b->first->op != IrPhi) continue;
+    for (k = 0; k < b->npred; k++)
+    { p = b->pred[k];
+      if (p->nsucc < 2) continue;
+      s = irNewBlock(f);
+      jmp = irNewInst(IrJmp, 0);
+      irAppend(s, jmp);
+      s->succ[0] = b;
+      s->nsucc = 1;
+      s->pred = (IrBlock *) malloc(sizeof(IrBlock));
+      s->pred[0] = p;
+      s->npred = 1;
+      for (m = 0; m < p->nsucc; m++)
+        if (p->succ[m] == b) { p->succ[m] = s; break; }
+      b->pred[k] = s;
+      count++;
+    }
+  }
+  if (count == 0) return;
+  layout = (IrBlock *) malloc(f->nblock * sizeof(IrBlock));
+  for (j = 0, k = 0; j < n; j++)
+  { layout[k++] = f->block[j];
+    for (m = n; m < f->nblock; m++)
+      if (f->block[m]->pred[0] == f->block[j]) layout[k++] = f->block[m];
+  }
+  for (j = 0; j < f->nblock; j++) f->block[j] = layout[j];
+  free(layout);
+}
+
+/* Procedure removePhis replaces each d = phi(a...) by
+ * a copy t = a at the end of every predecessor and
+ * d = t in place of the phi, with t a fresh register
+ */
+static void removePhis(IrFunc f)
+{ IrBlock b;
+  IrInst i, c;
+  int j, k, t;
+  for (j = 0; j < f->nblock; j++)
+  { b = f->block[j];
+    for (i = b->first; i != NULL && i->op == IrPhi; i = i->next)
+    { t = irNewVreg(f);
+      for (k = 0; k < i->narg; k++)
+      { c = irNewInst(IrCopy, 1);
+        c->arg[0] = i->arg[k];
+        c->dst = t;
+        irInsertBefore(b->pred[k]->last, c);
+      }
+      i->op = IrCopy;
+      i->narg = 1;
+      i->arg[0] = t;
+    }
+  }
+}
+
+/**************************************************/
+/***********   Registers and frame slots  *********/
+/**************************************************/
+
+/* Function isConstReg returns TRUE if v is a constant,
+ * which is loaded with LDC wherever it is used
+ */
+static int isConstReg(int v)
+{ return defCount[v] == 1 && defOf[v]->op == IrConst; }
+
+/* Function isTailCall returns TRUE if call i is
+ * followed by a return of its value and may reuse
+ * the frame of the current function
+ */
+static int isTailCall(IrInst i)
+{ return i->op == IrCall && i->next != NULL && i->next->op == IrRet
+      && i->next->arg[0] == i->dst && !hasFrameAddr
+      && gf->name != mainName
+      && i->callee->name != mainName;
+}
+
+/* Procedure countUses fills useCount, defCount, defOf,
+ * transient and needsSlot
+ */
+static void countUses(IrFunc f)
+{ IrInst i;
+  int j, k, v;
+  useCount = (int *) calloc(f->nvreg, sizeof(int));
+  defCount = (int *) calloc(f->nvreg, sizeof(int));
+  defOf = (IrInst *) calloc(f->nvreg, sizeof(IrInst));
+  transient = (char *) calloc(f->nvreg, 1);
+  needsSlot = (char *) calloc(f->nvreg, 1);
+  hasFrameAddr = FALSE;
+  for (j = 0; j < f->nblock; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { for (k = 0; k < i->narg; k++)
+        if (i->arg[k] != NOREG) useCount[i->arg[k]]++;
+      if (i->dst != NOREG)
+      { defCount[i->dst]++;
+        defOf[i->dst] = i;
+      }
+      if (i->op == IrAddr && i->arg[0] == NOREG && i->breg == fp)
+        hasFrameAddr = TRUE;
+    }
+  for (j = 0; j < f->nblock; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { v = i->dst;
+      if (v == NOREG || defCount[v] != 1 || useCount[v] != 1) continue;
+      if (i->op != IrBin && i->op != IrLoad && i->op != IrAddr
+          && i->op != IrIn && i->op != IrCall)
+        continue;
+      if (i->next == NULL || i->next->op == IrPhi
+          || (i->next->op == IrCall && isTailCall(i->next)))
+        continue;
+      for (k = 0; k < i->next->narg; k++)
+        if (i->next->arg[k] == v) transient[v] = TRUE;
+    }
+  for (v = 0; v < f->nvreg; v++)
+    needsSlot[v] = useCount[v] > 0 && defCount[v] > 0
+                   && !transient[v] && !isConstReg(v);
+}
+
+/* bit sets over the registers */
+static __thread int words;
+
+static unsigned * newSet(void)
+{ return (unsigned *) calloc(words, sizeof(unsigned)); }
+
+static int inSet(unsigned * s, int v)
+{ return (s[v / 32] >> (v % 32)) & 1; }
+
+static void addSet(unsigned * s, int v)
+{ s[v / 32] |= 1u << (v % 32); }
+
+static void delSet(unsigned * s, int v)
+{ s[v / 32] &= ~(1u << (v % 32)); }
+
+/* interference matrix, one row of words per register */
+static __thread unsigned * adj;
+
+static unsigned * row(int v)
+{ return adj + (long) v * words; }
+
+static void addEdge(int a, int b)
+{ addSet(row(a), b);
+  addSet(row(b), a);
+}
+
+/* union-find over coalesced registers */
+static __thread int * leader;
+
+static int find(int v)
+{ while (leader[v] != v) v = leader[v] = leader[leader[v]];
+  return v;
+}
+
+/* Procedure allocSlots gives each register that
+ * needs a slot a frame offset. Liveness is computed
+ * on the blocks, registers live at the same time
+ * interfere, copies between registers that do not
+ * interfere are coalesced, and the graph is colored
+ * greedily. Color i < nparam is the slot in which
+ * the caller stored parameter i. The two colors used
+ * most, weighting uses by loop depth, go to the
+ * variable registers unless one of their values is
+ * live across a call.
+ */
+static void allocSlots(IrFunc f)
+{ int n = f->nvreg, nb = f->nblock;
+  unsigned ** liveIn, ** liveOut, ** use, ** def;
+  unsigned * live, * used;
+  IrInst i;
+  IrBlock b;
+  int * color, * pre, * depth, * colorReg, * colorSlot;
+  char * crossCall, * noReg;
+  long * weight, scale;
+  int j, k, w, v, x, changed, c, ncolor, a, d, best, nextra;
+  words = (n + 31) / 32 + 1;
+  liveIn = (unsigned **) malloc(nb * sizeof(unsigned *));
+  liveOut = (unsigned **) malloc(nb * sizeof(unsigned *));
+  use = (unsigned **) malloc(nb * sizeof(unsigned *));
+  def = (unsigned **) malloc(nb * sizeof(unsigned *));
+  for (j = 0; j < nb; j++)
+  { liveIn[j] = newSet();
+    liveOut[j] = newSet();
+    use[j] = newSet();
+    def[j] = newSet();
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { for (k = 0; k < i->narg; k++)
+      { v = i->arg[k];
+        if (v != NOREG && needsSlot[v] && !inSet(def[j], v))
+          addSet(use[j], v);
+      }
+      if (i->dst != NOREG && needsSlot[i->dst]) addSet(def[j], i->dst);
+    }
+  }
+  do
+  { changed = FALSE;
+    for (j = nb - 1; j >= 0; j--)
+    { b = f->block[j];
+      for (k = 0; k < b->nsucc; k++)
+        for (w = 0; w < words; w++)
+          liveOut[j][w] |= liveIn[b->succ[k]->rpo][w];
+      for (w = 0; w < words; w++)
+      { x = use[j][w] | (liveOut[j][w] & ~def[j][w]);
+        if (x != liveIn[j][w])
+        { liveIn[j][w] = x;
+          changed = TRUE;
+        }
+      }
+    }
+  } while (changed);
+  /* interference */
+  adj = (unsigned *) calloc((long) n * words, sizeof(unsigned));
+  crossCall = (char *) calloc(n, 1);
+  live = newSet();
+  for (j = 0; j < nb; j++)
+  { for (w = 0; w < words; w++) live[w] = liveOut[j][w];
+    for (i = f->block[j]->last; i != NULL; i = i->prev)
+    { d = i->dst;
+      if (i->op == IrCall)
+        for (v = 0; v < n; v++)
+          if (inSet(live, v) && v != d) crossCall[v] = TRUE;
+      if (d != NOREG && needsSlot[d])
+      { for (v = 0; v < n; v++)
+          if (inSet(live, v) && v != d
+              && !(i->op == IrCopy && v == i->arg[0]))
+            addEdge(d, v);
+        delSet(live, d);
+      }
+      for (k = 0; k < i->narg; k++)
+        if (i->arg[k] != NOREG && needsSlot[i->arg[k]])
+          addSet(live, i->arg[k]);
+    }
+  }
+  /* parameters keep the slots the caller used */
+  leader = (int *) malloc(n * sizeof(int));
+  pre = (int *) malloc(n * sizeof(int));
+  for (v = 0; v < n; v++)
+  { leader[v] = v;
+    pre[v] = -1;
+  }
+  for (j = 0; j < nb; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+      if (i->op == IrParam && needsSlot[i->dst]) pre[i->dst] = i->imm;
+  /* coalescing */
+  for (j = 0; j < nb; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { if (i->op != IrCopy || !needsSlot[i->dst] || !needsSlot[i->arg[0]])
+        continue;
+      a = find(i->arg[0]);
+      d = find(i->dst);
+      if (a == d || inSet(row(a), d) || (pre[a] >= 0 && pre[d] >= 0))
+        continue;
+      if (pre[d] >= 0) { x = a; a = d; d = x; }
+      leader[d] = a;
+      for (w = 0; w < words; w++) row(a)[w] |= row(d)[w];
+      for (v = 0; v < n; v++)
+        if (inSet(row(d), v)) addSet(row(v), a);
+    }
+  /* coloring */
+  color = (int *) malloc(n * sizeof(int));
+  used = (unsigned *) malloc((n + f->nparam + 1) * sizeof(unsigned));
+  ncolor = f->nparam;
+  for (v = 0; v < n; v++) color[v] = pre[v];
+  for (v = 0; v < n; v++)
+  { if (!needsSlot[v] || find(v) != v || color[v] >= 0) continue;
+    for (c = 0; c <= n + f->nparam; c++) used[c] = FALSE;
+    for (x = 0; x < n; x++)
+      if (inSet(row(v), x) && color[find(x)] >= 0) used[color[find(x)]] = TRUE;
+    for (c = 0; used[c]; c++) ;
+    color[v] = c;
+    if (c + 1 > ncolor) ncolor = c + 1;
+  }
+  /* loop depth: the back edges around each block of
+     the layout, which keeps loop bodies together */
+  depth = (int *) calloc(nb, sizeof(int));
+  for (j = 0; j < nb; j++)
+  { b = f->block[j];
+    for (k = 0; k < b->nsucc; k++)
+      for (x = b->succ[k]->rpo; x <= j; x++) depth[x]++;
+  }
+  weight = (long *) calloc(ncolor, sizeof(long));
+  noReg = (char *) calloc(ncolor, 1);
+  for (v = 0; v < n; v++)
+    if (needsSlot[v] && crossCall[v]) noReg[color[find(v)]] = TRUE;
+  for (j = 0; j < nb; j++)
+  { for (k = 0, scale = 1; k < depth[j] && k < 4; k++) scale *= 10;
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { for (k = 0; k < i->narg; k++)
+        if (i->arg[k] != NOREG && needsSlot[i->arg[k]])
+          weight[color[find(i->arg[k])]] += scale;
+      if (i->dst != NOREG && needsSlot[i->dst])
+        weight[color[find(i->dst)]] += scale;
+    }
+  }
+  colorReg = (int *) malloc(ncolor * sizeof(int));
+  for (c = 0; c < ncolor; c++) colorReg[c] = NOREG;
+  for (k = 0; k < 2; k++)
+  { best = -1;
+    for (c = 0; c < ncolor; c++)
+      if (!noReg[c] && colorReg[c] == NOREG && weight[c] > 0
+          && (best < 0 || weight[c] > weight[best]))
+        best = c;
+    if (best >= 0) colorReg[best] = k == 0 ? vr0 : vr1;
+  }
+  /* the colors left in memory get the frame slots */
+  colorSlot = (int *) malloc(ncolor * sizeof(int));
+  nextra = 0;
+  for (c = 0; c < ncolor; c++)
+    if (c < f->nparam) colorSlot[c] = -c;
+    else if (colorReg[c] == NOREG)
+      colorSlot[c] = -(f->scope->frameSize + nextra++);
+  slot = (int *) malloc(n * sizeof(int));
+  regOf = (int *) malloc(n * sizeof(int));
+  for (v = 0; v < n; v++)
+  { regOf[v] = NOREG;
+    if (!needsSlot[v]) continue;
+    c = color[find(v)];
+    regOf[v] = colorReg[c];
+    slot[v] = colorSlot[c];
+  }
+  frameWords = f->scope->frameSize + nextra;
+  free(depth);
+  free(weight);
+  free(noReg);
+  free(colorReg);
+  free(colorSlot);
+  free(crossCall);
+  for (j = 0; j < nb; j++)
+  { free(liveIn[j]);
+    free(liveOut[j]);
+    free(use[j]);
+    free(def[j]);
+  }
+  free(liveIn);
+  free(liveOut);
+  free(use);
+  free(def);
+  free(live);
+  free(used);
+  free(adj);
+  free(leader);
+  free(pre);
+  free(color);
+}
+
+/**************************************************/
+/***********   Emission                   *********/
+/**************************************************/
+
+/* Function isPureJmp returns TRUE if b only jumps */
+static int isPureJmp(IrBlock b)
+{ return b->first == b->last && b->first->op == IrJmp
+      && b != gf->block[0];
+}
+
+/* Function resolve returns the block where control
+ * lands when jumping to b, skipping blocks that only
+ * jump on
+ */
+static IrBlock resolve(IrBlock b)
+{ IrBlock t = b;
+  int steps = 0;
+  while (isPureJmp(t))
+  { t = t->succ[0];
+    if (++steps > gf->nblock) return b;
+  }
+  return t;
+}
+
+/* Function isSkipped returns TRUE if b is not
+ * emitted since every jump to it is resolved past it
+ */
+static int isSkipped(IrBlock b)
+{ return isPureJmp(b) && resolve(b) != b; }
+
+/* Function nextBlock returns the block emitted
+ * after b, NULL after the last one
+ */
+static IrBlock nextBlock(IrBlock b)
+{ int j;
+  for (j = b->rpo + 1; j < gf->nblock; j++)
+    if (!isSkipped(gf->block[j])) return gf->block[j];
+  return NULL;
+}
+
+/* Procedure emitJump emits a jump op on register r
+ * to target, or to the epilogue if target is NULL
+ */
+static void emitJump(char * op, int r, IrBlock target, char * c)
+{ if (target != NULL && blockLoc[target->rpo] >= 0)
+  { emitRM_Abs(op, r, blockLoc[target->rpo], c);
+    return;
+  }
+  if (jumpCount == jumpMax)
+  { jumpMax = jumpMax ? 2*jumpMax : 64;
+    jumpFixups = (JumpFixup *) realloc(jumpFixups, jumpMax * sizeof(JumpFixup));
+  }
+  jumpFixups[jumpCount].loc = emitSkip(1);
+  jumpFixups[jumpCount].op = op;
+  jumpFixups[jumpCount].reg = r;
+  jumpFixups[jumpCount].target = target;
+  jumpCount++;
+}
+
+/* Function other returns the accumulator that is not r */
+static int other(int r)
+{ return r == ac ? ac1 : ac; }
+
+/* Procedure load puts the value of v in register r */
+static void load(int v, int r)
+{ if (cached[r] == v) return;
+  if (isConstReg(v))
+    emitRM("LDC", r, defOf[v]->imm, 0, "load const");
+  else if (regOf[v] != NOREG)
+    emitRM("LDA", r, 0, regOf[v], "move from register");
+  else if (cached[other(r)] == v)
+    emitRM("LDA", r, 0, other(r), "move value");
+  else if (needsSlot[v])
+    emitRM("LD", r, slot[v], fp, "load value");
+  else
+    emitComment("BUG: value lost");
+  cached[r] = v;
+}
+
+/* Function place1 returns a register holding v,
+ * loading it into ac if it is in no register
+ */
+static int place1(int v)
+{ if (regOf[v] != NOREG) return regOf[v];
+  if (cached[ac] == v) return ac;
+  if (cached[ac1] == v) return ac1;
+  load(v, ac);
+  return ac;
+}
+
+/* Procedure place2 puts a and b in the two registers,
+ * keeping either where it already is
+ */
+static void place2(int a, int b, int * ra, int * rb)
+{ if (a == b)
+    *ra = *rb = place1(a);
+  else if (regOf[a] != NOREG)
+  { *ra = regOf[a];
+    *rb = place1(b);
+  }
+  else if (regOf[b] != NOREG)
+  { *rb = regOf[b];
+    *ra = place1(a);
+  }
+  else if (cached[ac] == a || cached[ac1] == a)
+  { *ra = cached[ac] == a ? ac : ac1;
+    *rb = other(*ra);
+    load(b, *rb);
+  }
+  else if (cached[ac] == b || cached[ac1] == b)
+  { *rb = cached[ac] == b ? ac : ac1;
+    *ra = other(*rb);
+    load(a, *ra);
+  }
+  else
+  { *ra = ac1;
+    *rb = ac;
+    load(a, ac1);
+    load(b, ac);
+  }
+}
+
+/* Procedure define records that register r holds
+ * the new value of d and moves it to the variable
+ * register or the slot of d
+ */
+static void define(int d, int r)
+{ cached[r] = d;
+  if (cached[other(r)] == d) cached[other(r)] = NOREG;
+  if (d == NOREG || !needsSlot[d]) return;
+  if (regOf[d] == NOREG)
+    emitRM("ST", r, slot[d], fp, "store value");
+  else if (regOf[d] != r)
+    emitRM("LDA", regOf[d], 0, r, "move to register");
+}
+
+/* Function sameHome returns TRUE if a and d are kept
+ * in the same variable register or frame slot
+ */
+static int sameHome(int a, int d)
+{ if (!needsSlot[a] || !needsSlot[d]) return FALSE;
+  if (regOf[a] != NOREG || regOf[d] != NOREG) return regOf[a] == regOf[d];
+  return slot[a] == slot[d];
+}
+
+/* Function jumpOp returns the TM jump taken when
+ * "x op 0" holds, or its negation if negate is set
+ */
+static char * jumpOp(TokenType op, int negate)
+{ switch (op)
+  { case LT: return negate ? "JGE" : "JLT";
+    case LE: return negate ? "JGT" : "JLE";
+    case GT: return negate ? "JLE" : "JGT";
+    case GE: return negate ? "JLT" : "JGE";
+    case EQ: return negate ? "JNE" : "JEQ";
+    default: return negate ? "JEQ" : "JNE";
+  }
+}
+
+/* Procedure genAddress emits op (LD or LDA) for the
+ * memory operand of i into ac
+ */
+static void genAddress(IrInst i, char * op)
+{ int rb, rx;
+  if (i->arg[0] == NOREG && i->arg[1] == NOREG)
+    emitRM(op, ac, i->imm, i->breg, "direct");
+  else
+  { if (i->arg[0] == NOREG)
+    { rx = place1(i->arg[1]);
+      emitRO("SUB", ac, i->breg, rx, "sub index");
+      rb = ac;
+    }
+    else if (i->arg[1] == NOREG)
+      rb = place1(i->arg[0]);
+    else
+    { place2(i->arg[0], i->arg[1], &rb, &rx);
+      emitRO("SUB", ac, rb, rx, "sub index");
+      rb = ac;
+    }
+    if (i->imm != 0 || op[1] == 'D' || rb != ac)
+      emitRM(op, ac, i->imm, rb, "indexed");
+  }
+  define(i->dst, ac);
+}
+
+/* Procedure genStore emits the store instruction i */
+static void genStore(IrInst i)
+{ int rv, ra, rx;
+  int v = i->arg[2];
+  if (i->arg[0] == NOREG && i->arg[1] == NOREG)
+  { rv = place1(v);
+    emitRM("ST", rv, i->imm, i->breg, "store direct");
+  }
+  else if (i->arg[0] == NOREG)
+  { if (v == i->arg[1])
+    { rv = place1(v);
+      ra = other(rv);
+      emitRO("SUB", ra, i->breg, rv, "sub index");
+    }
+    else
+    { place2(v, i->arg[1], &rv, &rx);
+      ra = other(rv);
+      emitRO("SUB", ra, i->breg, rx, "sub index");
+    }
+    cached[ra] = NOREG;
+    emitRM("ST", rv, i->imm, ra, "store indexed");
+  }
+  else
+  { place2(v, i->arg[0], &rv, &ra);
+    emitRM("ST", rv, i->imm, ra, "store indexed");
+  }
+}
+
+/* Procedure genCall emits call i: the arguments go
+ * below sp into the frame of the callee
+ */
+static void genCall(IrInst i)
+{ int n = i->narg, k, r;
+  if (n > 0)
+    emitRM("LDA", sp, -(n+2), sp, "reserve frame link and args");
+  for (k = 0; k < n; k++)
+    if (transient[i->arg[k]])
+    { r = place1(i->arg[k]);
+      emitRM("ST", r, n-k, sp, "store arg in frame");
+    }
+  for (k = 0; k < n; k++)
+    if (!transient[i->arg[k]])
+    { r = place1(i->arg[k]);
+      emitRM("ST", r, n-k, sp, "store arg in frame");
+    }
+  if (n > 0)
+  { emitRM("ST", fp, n+1, sp, "store old fp");
+    emitRM("LDA", fp, n, sp, "new fp");
+  }
+  else
+  { emitRM("ST", fp, -1, sp, "store old fp");
+    emitRM("LDA", fp, -2, sp, "new fp");
+  }
+  emitRM("LDA", ac1, 1, pc, "return addr");
+  emitMark(emitSkip(0), "call", i->line, i->callee->name);
+  emitCall(i->callee, 0, "call: jmp to function");
+  cached[ac] = cached[ac1] = NOREG;
+  if (i->dst != NOREG) define(i->dst, ac);
+}
+
+/* Function homeOf returns where the value of v is
+ * kept for genTailCall: its variable register, or a
+ * number past the 8 TM registers for its slot, NOREG
+ * if it has neither
+ */
+static int homeOf(int v)
+{ if (!needsSlot[v]) return NOREG;
+  if (regOf[v] != NOREG) return regOf[v];
+  return 8 - slot[v];
+}
+
+/* Procedure genTailCall emits return f(...) as moves
+ * of the arguments into the parameters of the current
+ * frame and a jump past the prologue of f. When f is
+ * the current function the parameters kept in
+ * variable registers are set directly and the jump
+ * goes to the body. The moves are ordered so that no
+ * argument is overwritten before it is read; a cycle
+ * of moves is broken by saving one argument in a word
+ * below both the frame and the n parameters of f.
+ */
+static void genTailCall(IrInst i)
+{ int n = i->narg, self = i->callee == gf->pl;
+  int k, m, r, left = 0, ntemp = 0;
+  int base = n > frameWords ? n : frameWords;
+  int * src = (int *) malloc((n + 1) * sizeof(int));
+  int * dst = (int *) malloc((n + 1) * sizeof(int));
+  int * temp = (int *) malloc((n + 1) * sizeof(int));
+  for (k = 0; k < n; k++)
+  { src[k] = homeOf(i->arg[k]);
+    dst[k] = self && paramReg[k] != NOREG ? paramReg[k] : 8 + k;
+    temp[k] = NOREG;
+    if (src[k] == dst[k] || (self && paramDead[k])) dst[k] = NOREG;
+    else left++;
+  }
+  while (left > 0)
+  { for (k = 0; k < n; k++)
+    { if (dst[k] == NOREG) continue;
+      for (m = 0; m < n; m++)
+        if (m != k && dst[m] != NOREG && src[m] == dst[k]) break;
+      if (m == n) break;
+    }
+    if (k == n)
+    { /* every move left overwrites a pending argument */
+      for (k = 0; dst[k] == NOREG; k++) ;
+      r = place1(i->arg[k]);
+      emitRM("ST", r, -(base + ntemp), fp, "save arg below params");
+      for (m = 0; m < n; m++)
+        if (dst[m] != NOREG && i->arg[m] == i->arg[k])
+        { src[m] = NOREG;
+          temp[m] = ntemp;
+        }
+      ntemp++;
+      continue;
+    }
+    if (temp[k] != NOREG)
+    { r = dst[k] < 8 ? dst[k] : ac;
+      emitRM("LD", r, -(base + temp[k]), fp, "load saved arg");
+    }
+    else
+      r = place1(i->arg[k]);
+    if (dst[k] >= 8)
+      emitRM("ST", r, -k, fp, "store arg in param slot");
+    else if (r != dst[k])
+      emitRM("LDA", dst[k], 0, r, "move arg to param register");
+    if (r == ac) cached[ac] = NOREG;
+    dst[k] = NOREG;
+    left--;
+  }
+  emitMark(emitSkip(0), "call", i->line, i->callee->name);
+  if (self)
+    emitRM_Abs("LDA", pc, bodyLoc, "tail call: jmp to body");
+  else
+    emitCall(i->callee, 1, "tail call: jmp past prologue");
+  free(src);
+  free(dst);
+  free(temp);
+}
+
+/* Procedure genBranch emits the terminator of b */
+static void genBranch(IrInst i)
+{ IrBlock b = i->block, next = nextBlock(b), t, f;
+  char * trueOp, * falseOp;
+  int r;
+  if (i->op == IrJmp)
+  { t = resolve(b->succ[0]);
+    if (t != next) emitJump("LDA", pc, t, "jmp");
+    return;
+  }
+  t = resolve(b->succ[0]);
+  f = resolve(b->succ[1]);
+  if (pendingCmp != ENDFILE)
+  { r = ac;
+    trueOp = jumpOp(pendingCmp, FALSE);
+    falseOp = jumpOp(pendingCmp, TRUE);
+    pendingCmp = ENDFILE;
+  }
+  else
+  { r = place1(i->arg[0]);
+    trueOp = "JNE";
+    falseOp = "JEQ";
+  }
+  if (t == f)
+  { if (t != next) emitJump("LDA", pc, t, "jmp");
+  }
+  else if (f == next)
+    emitJump(trueOp, r, t, "br if true");
+  else if (t == next)
+    emitJump(falseOp, r, f, "br if false");
+  else
+  { emitJump(falseOp, r, f, "br if false");
+    emitJump("LDA", pc, t, "jmp");
+  }
+}
+
+/* Procedure genInst emits instruction i */
+static void genInst(IrInst i)
+{ int ra, rb;
+  switch (i->op)
+  { case IrConst:
+    case IrParam:
+    case IrPhi:
+      break;
+    case IrCopy:
+      if (!needsSlot[i->dst]) break;
+      if (sameHome(i->arg[0], i->dst))
+      { if (cached[ac] == i->arg[0]) cached[ac] = i->dst;
+        if (cached[ac1] == i->arg[0]) cached[ac1] = i->dst;
+        break;
+      }
+      ra = place1(i->arg[0]);
+      define(i->dst, ra);
+      break;
+    case IrBin:
+      /* adding a constant is an LDA offset */
+      if ((i->binop == PLUS || i->binop == MINUS)
+          && isConstReg(i->arg[1]) && !isConstReg(i->arg[0]))
+      { ra = place1(i->arg[0]);
+        rb = defOf[i->arg[1]]->imm;
+        emitRM("LDA", ac, i->binop == PLUS ? rb : -rb, ra, "op + const");
+        define(i->dst, ac);
+        break;
+      }
+      if (i->binop == PLUS && isConstReg(i->arg[0]) && !isConstReg(i->arg[1]))
+      { ra = place1(i->arg[1]);
+        emitRM("LDA", ac, defOf[i->arg[0]]->imm, ra, "op + const");
+        define(i->dst, ac);
+        break;
+      }
+      place2(i->arg[0], i->arg[1], &ra, &rb);
+      switch (i->binop)
+      { case PLUS:  emitRO("ADD", ac, ra, rb, "op +"); break;
+        case MINUS: emitRO("SUB", ac, ra, rb, "op -"); break;
+        case TIMES: emitRO("MUL", ac, ra, rb, "op *"); break;
+        case OVER:  emitRO("DIV", ac, ra, rb, "op /"); break;
+        default:
+          emitRO("SUB", ac, ra, rb, "compare");
+          if (transient[i->dst] && i->next->op == IrBr)
+          { pendingCmp = i->binop;
+            cached[ac] = NOREG;
+            return;
+          }
+          emitRM(jumpOp(i->binop, FALSE), ac, 2, pc, "br if true");
+          emitRM("LDC", ac, 0, ac, "false case");
+          emitRM("LDA", pc, 1, pc, "unconditional jmp");
+          emitRM("LDC", ac, 1, ac, "true case");
+          break;
+      }
+      define(i->dst, ac);
+      break;
+    case IrAddr:
+      genAddress(i, "LDA");
+      break;
+    case IrLoad:
+      genAddress(i, "LD");
+      break;
+    case IrStore:
+      genStore(i);
+      break;
+    case IrIn:
+      emitRO("IN", ac, 0, 0, "input value");
+      define(i->dst, ac);
+      break;
+    case IrOut:
+      ra = place1(i->arg[0]);
+      emitRO("OUT", ra, 0, 0, "output value");
+      break;
+    case IrCall:
+      if (isTailCall(i)) genTailCall(i);
+      else genCall(i);
+      break;
+    case IrJmp:
+    case IrBr:
+      genBranch(i);
+      break;
+    case IrRet:
+      if (i->arg[0] != NOREG) load(i->arg[0], ac);
+      if (nextBlock(i->block) != NULL)
+        emitJump("LDA", pc, NULL, "return: jmp to epilogue");
+      break;
+  }
+}
+
+/* Procedure genFunc emits function f */
+static void genFunc(IrFunc f)
+{ IrBlock b;
+  IrInst i;
+  char buffer[100];
+  int j, isMain = f->name == mainName, epilogue;
+  gf = f;
+  splitEdges(f);
+  removePhis(f);
+  for (j = 0; j < f->nblock; j++) f->block[j]->rpo = j;
+  countUses(f);
+  allocSlots(f);
+  if (cc->TraceCode)
+  { sprintf(buffer, "-> Func Decl : %s", f->name);
+    emitComment(buffer);
+  }
+  f->pl->entry = emitSkip(0);
+  if (!isMain)
+    emitRM("ST", ac1, 2, fp, "store return addr");
+  emitRM("LDA", sp, -frameWords, fp, "reserve frame : params, vars, slots");
+  paramReg = (int *) malloc((f->nparam + 1) * sizeof(int));
+  paramDead = (char *) malloc(f->nparam + 1);
+  for (j = 0; j < f->nparam; j++)
+  { paramReg[j] = NOREG;
+    paramDead[j] = TRUE;
+  }
+  for (i = f->block[0]->first; i != NULL; i = i->next)
+    if (i->op == IrParam && needsSlot[i->dst])
+    { paramDead[i->imm] = FALSE;
+      paramReg[i->imm] = regOf[i->dst];
+      if (regOf[i->dst] != NOREG)
+        emitRM("LD", regOf[i->dst], -i->imm, fp, "load param to register");
+    }
+  bodyLoc = emitSkip(0);
+  blockLoc = (int *) malloc(f->nblock * sizeof(int));
+  for (j = 0; j < f->nblock; j++) blockLoc[j] = -1;
+  jumpCount = 0;
+  pendingCmp = ENDFILE;
+  for (j = 0; j < f->nblock; j++)
+  { b = f->block[j];
+    if (isSkipped(b)) continue;
+    blockLoc[j] = emitSkip(0);
+    if (cc->TraceCode)
+    { sprintf(buffer, "B%d:", b->id);
+      emitComment(buffer);
+    }
+    cached[ac] = cached[ac1] = NOREG;
+    for (i = b->first; i != NULL; i = i->next)
+    { genInst(i);
+      if (i->op == IrCall && isTailCall(i)) break;
+    }
+    /* an empty block shares its location with the next */
+    if (b->mark != NULL && emitSkip(0) > blockLoc[j])
+      emitMark(blockLoc[j], b->mark, b->line, NULL);
+  }
+  epilogue = emitSkip(0);
+  if (cc->TraceCode)
+  { sprintf(buffer, "<- Func Decl : %s", f->name);
+    emitComment(buffer);
+  }
+  if (isMain)
+  { emitComment("End of execution.");
+    emitRO("HALT", 0, 0, 0, "");
+  }
+  else
+  { if (cc->TraceCode) emitComment("-> epilogue");
+    emitRM("LDA", sp, 2, fp, "release frame");
+    emitRM("LD", fp, -1, sp, "restore old fp");
+    emitRM("LD", pc, 0, sp, "restore pc");
+    if (cc->TraceCode) emitComment("<- epilogue");
+  }
+  for (j = 0; j < jumpCount; j++)
+  { emitBackup(jumpFixups[j].loc);
+    emitRM_Abs(jumpFixups[j].op, jumpFixups[j].reg,
+               jumpFixups[j].target == NULL ? epilogue
+                 : blockLoc[jumpFixups[j].target->rpo], "jmp");
+  }
+  emitRestore();
+  free(blockLoc);
+  free(useCount);
+  free(defCount);
+  free(defOf);
+  free(transient);
+  free(needsSlot);
+  free(slot);
+  free(regOf);
+  free(paramReg);
+  free(paramDead);
+}
+
+/* Procedure irCodeGen generates TM code for the
+ * functions in the list f to the code file
+ */
+void irCodeGen(IrFunc f, char * codefile)
+{ FuncParam mainpl = getpl(mainName);
+  char * s = malloc(strlen(codefile)+7);
+  strcpy(s,"File: ");
+  strcat(s,codefile);
+  emitComment("TINY Compilation to TM Code");
+  emitComment(s);
+  /* generate standard prelude */
+  emitComment("Standard prelude:");
+  emitRM("LD",sp,0,ac,"load maxaddress from location 0");
+  emitRM("ST",ac,0,ac,"clear location 0");
+  emitRM("LDA",fp,0,sp,"sp->fp");
+  emitComment("End of standard prelude.");
+  if (mainpl != NULL)
+    emitCall(mainpl, 0, "jump to main");
+  else
+  { emitComment("End of execution.");
+    emitRO("HALT",0,0,0,"no main");
+  }
+  for (; f != NULL; f = f->next)
+    if (f->kept != NULL) placeCode(f->tree);
+    else if (cc->Incremental)
+    { beginCode(f->tree);
+      genFunc(f);
+      endCode(f->tree);
+    }
+    else genFunc(f);
+  /* link: patch the calls to functions placed later */
+  emitCallFixups();
+}
@@ -0,0 +1,762 @@
+/****************************************************/
+/* File: iropt.c                                    */
+/* Optimizations on the IR of the C-minus compiler  */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "ir.h"
+#include "iropt.h"
+#include "incr.h"
+#include "context.h"
+
+/**************************************************/
+/***********   Loops                      *********/
+/**************************************************/
+
+/* A natural loop: the blocks reaching a back edge
+ * to header without passing through it. pre is the
+ * single block outside the loop that jumps to the
+ * header, NULL when there is none.
+ */
+typedef struct
+{ IrBlock header;
+  IrBlock pre;
+  char * in;   /* in[rpo] is TRUE for the blocks of the loop */
+  int size;
+} Loop;
+
+static __thread Loop * loops = NULL;
+static __thread int nloop = 0;
+
+/* Procedure findLoops fills loops with the loops of
+ * f, inner loops first
+ */
+static void findLoops(IrFunc f)
+{ IrBlock * work = (IrBlock *) malloc(f->nblock * sizeof(IrBlock));
+  IrBlock b, h, x, p;
+  Loop * l, t;
+  int j, k, m, nwork, count;
+  loops = (Loop *) malloc(f->nblock * sizeof(Loop));
+  nloop = 0;
+  for (j = 0; j < f->nblock; j++)
+  { b = f->block[j];
+    for (k = 0; k < b->nsucc; k++)
+    { h = b->succ[k];
+      if (!irDominates(h, b)) continue;
+      for (m = 0; m < nloop && loops[m].header != h; m++) ;
+      l = &loops[m];
+      if (m == nloop)
+      { nloop++;
+        l->header = h;
+        l->pre = NULL;
+        l->in = (char *) calloc(f->nblock, 1);
+        l->in[h->rpo] = TRUE;
+        l->size = 1;
+      }
+      nwork = 0;
+      if (!l->in[b->rpo])
+      { l->in[b->rpo] = TRUE;
+        l->size++;
+        work[nwork++] = b;
+      }
+      while (nwork > 0)
+      { x = work[--nwork];
+        for (m = 0; m < x->npred; m++)
+        { p = x->pred[m];
+          if (l->in[p->rpo]) continue;
+          l->in[p->rpo] = TRUE;
+          l->size++;
+          work[nwork++] = p;
+        }
+      }
+    }
+  }
+  for (m = 0; m < nloop; m++)
+  { l = &loops[m];
+    count = 0;
+    for (k = 0; k < l->header->npred; k++)
+      if (!l->in[l->header->pred[k]->rpo])
+      { p = l->header->pred[k];
+        count++;
+      }
+    if (count == 1 && p->nsucc == 1) l->pre = p;
+  }
+  /* inner loops are smaller than the loops around them */
+  for (m = 1; m < nloop; m++)
+    for (k = m; k > 0 && loops[k-1].size > loops[k].size; k--)
+    { t = loops[k];
+      loops[k] = loops[k-1];
+      loops[k-1] = t;
+    }
+  free(work);
+}
+
+/* defOf holds the instruction defining each register
+ * and useCount the number of operands naming it
+ */
+static __thread IrInst * defOf = NULL;
+static __thread int * useCount = NULL;
+
+/* Procedure countRegs fills defOf and useCount for f */
+static void countRegs(IrFunc f)
+{ IrInst i;
+  int j, k;
+  free(defOf);
+  free(useCount);
+  defOf = (IrInst *) calloc(f->nvreg, sizeof(IrInst));
+  useCount = (int *) calloc(f->nvreg, sizeof(int));
+  for (j = 0; j < f->nblock; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+    { if (i->dst != NOREG) defOf[i->dst] = i;
+      for (k = 0; k < i->narg; k++)
+        if (i->arg[k] != NOREG) useCount[i->arg[k]]++;
+    }
+}
+
+/* Function isConstReg returns TRUE if v holds a
+ * constant, and its value in *val
+ */
+static int isConstReg(int v, int * val)
+{ if (v == NOREG || defOf[v] == NULL || defOf[v]->op != IrConst)
+    return FALSE;
+  *val = defOf[v]->imm;
+  return TRUE;
+}
+
+/* Function isInvariantReg returns TRUE if v is not
+ * computed in loop l
+ */
+static int isInvariantReg(int v, Loop * l)
+{ return v == NOREG || defOf[v] == NULL || !l->in[defOf[v]->block->rpo]; }
+
+/* Procedure freeLoops releases loops */
+static void freeLoops(void)
+{ int m;
+  for (m = 0; m < nloop; m++) free(loops[m].in);
+  free(loops);
+  loops = NULL;
+  nloop = 0;
+}
+
+/* Function funcOf returns the function named name
+ * in the list all, NULL if it is not there
+ */
+static IrFunc funcOf(IrFunc all, char * name)
+{ for (; all != NULL; all = all->next)
+    if (all->name == name) return all;
+  return NULL;
+}
+
+/* Procedure findStores sets storesMem in each
+ * function of the list f that may store to memory
+ * itself or through the functions it calls; one
+ * whose code was kept tells by the stores and calls
+ * kept along with it
+ */
+void findStores(IrFunc f)
+{ IrFunc g, h;
+  IrInst i;
+  int j, changed;
+  for (g = f; g != NULL; g = g->next) g->storesMem = FALSE;
+  do
+  { changed = FALSE;
+    for (g = f; g != NULL; g = g->next)
+    { if (g->storesMem) continue;
+      if (g->kept != NULL)
+      { g->storesMem = g->kept->stores;
+        for (j = 0; j < g->kept->ncallee && !g->storesMem; j++)
+        { h = funcOf(f, g->kept->callee[j].name);
+          if (h == NULL || h->storesMem) g->storesMem = TRUE;
+        }
+      }
+      for (j = 0; j < g->nblock && !g->storesMem; j++)
+        for (i = g->block[j]->first; i != NULL; i = i->next)
+        { if (i->op == IrStore) g->storesMem = TRUE;
+          else if (i->op == IrCall)
+          { h = funcOf(f, i->callee->name);
+            if (h == NULL || h->storesMem) g->storesMem = TRUE;
+          }
+        }
+      if (g->storesMem) changed = TRUE;
+    }
+  } while (changed);
+}
+
+/**************************************************/
+/***********   Loop-invariant code motion *********/
+/**************************************************/
+
+/* Function mayAlias returns TRUE if the memory
+ * operands of a and b may be the same word; only
+ * two direct operands are known apart
+ */
+static int mayAlias(IrInst a, IrInst b)
+{ if (a->arg[0] != NOREG || a->arg[1] != NOREG
+      || b->arg[0] != NOREG || b->arg[1] != NOREG)
+    return TRUE;
+  return a->breg == b->breg && a->imm == b->imm;
+}
+
+/* Function isInvariant returns TRUE if no operand
+ * of i is computed in loop l
+ */
+static int isInvariant(IrInst i, Loop * l)
+{ int k;
+  for (k = 0; k < i->narg; k++)
+    if (!isInvariantReg(i->arg[k], l)) return FALSE;
+  return TRUE;
+}
+
+/* Function runsEachTrip returns TRUE if block b is
+ * passed on each trip around loop l and before any
+ * way out of it
+ */
+static int runsEachTrip(IrFunc f, IrBlock b, Loop * l)
+{ IrBlock x;
+  int j, k;
+  for (j = 0; j < f->nblock; j++)
+  { x = f->block[j];
+    if (!l->in[j]) continue;
+    for (k = 0; k < x->nsucc; k++)
+      if ((x->succ[k] == l->header || !l->in[x->succ[k]->rpo])
+          && !irDominates(b, x))
+        return FALSE;
+    if (x->last->op == IrRet && !irDominates(b, x)) return FALSE;
+  }
+  return TRUE;
+}
+
+/* Function loadIsFixed returns TRUE if nothing in
+ * loop l may store to the word load i reads
+ */
+static int loadIsFixed(IrFunc f, IrFunc all, IrInst i, Loop * l)
+{ IrInst s;
+  IrFunc h;
+  int j;
+  for (j = 0; j < f->nblock; j++)
+  { if (!l->in[j]) continue;
+    for (s = f->block[j]->first; s != NULL; s = s->next)
+    { if (s->op == IrStore && mayAlias(s, i)) return FALSE;
+      if (s->op == IrCall)
+      { h = funcOf(all, s->callee->name);
+        if (h == NULL || h->storesMem) return FALSE;
+      }
+    }
+  }
+  return TRUE;
+}
+
+/* Function canHoist returns TRUE if i may run once
+ * in the preheader of l instead of in the loop
+ */
+static int canHoist(IrFunc f, IrFunc all, IrInst i, Loop * l)
+{ int c;
+  if (!isInvariant(i, l)) return FALSE;
+  switch (i->op)
+  { case IrConst:
+    case IrAddr:
+      return TRUE;
+    case IrBin:
+      if (i->binop != OVER) return TRUE;
+      /* only a division that cannot stop the TM */
+      return isConstReg(i->arg[1], &c) && c != 0;
+    case IrLoad:
+      /* an indexed load out of a guarded path might
+         read outside memory */
+      if ((i->arg[0] != NOREG || i->arg[1] != NOREG)
+          && !runsEachTrip(f, i->block, l))
+        return FALSE;
+      return loadIsFixed(f, all, i, l);
+    default:
+      return FALSE;
+  }
+}
+
+/* Function hoistInvariants moves the computations of
+ * each loop of f whose operands do not change in the
+ * loop into its preheader, inner loops first, and
+ * returns the number of instructions moved; all is
+ * the list of functions, for calls
+ */
+int hoistInvariants(IrFunc f, IrFunc all)
+{ IrInst i, next;
+  Loop * l;
+  int j, m, changed, count = 0;
+  countRegs(f);
+  findLoops(f);
+  for (m = 0; m < nloop; m++)
+  { l = &loops[m];
+    if (l->pre == NULL) continue;
+    do
+    { changed = FALSE;
+      for (j = 0; j < f->nblock; j++)
+      { if (!l->in[j]) continue;
+        for (i = f->block[j]->first; i != NULL; i = next)
+        { next = i->next;
+          if (!canHoist(f, all, i, l)) continue;
+          irRemove(i);
+          irInsertBefore(l->pre->last, i);
+          changed = TRUE;
+          count++;
+        }
+      }
+    } while (changed);
+  }
+  freeLoops();
+  return count;
+}
+
+/**************************************************/
+/***********   Induction variables        *********/
+/**************************************************/
+
+/* Function offsetOf returns TRUE if register w is v
+ * plus a constant, and that constant in *off
+ */
+static int offsetOf(int w, int v, int * off)
+{ IrInst d;
+  int c;
+  if (w == v)
+  { *off = 0;
+    return TRUE;
+  }
+  d = w == NOREG ? NULL : defOf[w];
+  if (d == NULL || d->op != IrBin) return FALSE;
+  if (d->binop == PLUS && d->arg[0] == v && isConstReg(d->arg[1], &c))
+    *off = c;
+  else if (d->binop == PLUS && d->arg[1] == v && isConstReg(d->arg[0], &c))
+    *off = c;
+  else if (d->binop == MINUS && d->arg[0] == v && isConstReg(d->arg[1], &c))
+    *off = -c;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+/* Function mirror returns the relation op with its
+ * operands exchanged
+ */
+static TokenType mirror(TokenType op)
+{ switch (op)
+  { case LT: return GT;
+    case LE: return GE;
+    case GT: return LT;
+    case GE: return LE;
+    default: return op;
+  }
+}
+
+/* Function isCompare returns TRUE for relational ops */
+static int isCompare(TokenType op)
+{ return op == LT || op == LE || op == GT || op == GE
+      || op == EQ || op == NE;
+}
+
+/* Function reduceInduction strength-reduces the
+ * array accesses indexed by the induction variable
+ * defined by phi in the header of l: for each array
+ * base B a pointer p = B - v is kept, stepped along
+ * with v, and the accesses address p directly. When
+ * v is left with no other use the loop test is moved
+ * onto the pointer too. kpre is the position of the
+ * preheader among the header preds. Returns the
+ * number of accesses rewritten.
+ */
+static int reduceInduction(IrFunc f, Loop * l, IrInst phi, int kpre)
+{ IrBlock h = l->header, latch = h->pred[1-kpre];
+  IrInst d, i, cmp = NULL, a, p0, pphi, p1;
+  IrInst * acc;
+  int * accOff, * gBase, * gBreg, * gOf;
+  int v = phi->dst, init = phi->arg[kpre], next = phi->arg[1-kpre];
+  int step, backward, nacc = 0, ngroup = 0, left, deadOff = 0;
+  int j, k, g, off, lim, other, dies;
+  countRegs(f);
+  d = defOf[next];
+  if (d == NULL || d->op != IrBin || !l->in[d->block->rpo]) return 0;
+  if (d->binop == PLUS && d->arg[0] == v) step = d->arg[1];
+  else if (d->binop == PLUS && d->arg[1] == v) step = d->arg[0];
+  else if (d->binop == MINUS && d->arg[0] == v) step = d->arg[1];
+  else return 0;
+  if (step == v || !isInvariantReg(step, l)) return 0;
+  backward = d->binop == MINUS;
+  /* the accesses with an index v + c and a base fixed in the loop */
+  acc = (IrInst *) malloc(f->nvreg * sizeof(IrInst));
+  accOff = (int *) malloc(f->nvreg * sizeof(int));
+  for (j = 0; j < f->nblock; j++)
+  { if (!l->in[j]) continue;
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+      if ((i->op == IrLoad || i->op == IrStore || i->op == IrAddr)
+          && i->arg[1] != NOREG && isInvariantReg(i->arg[0], l)
+          && offsetOf(i->arg[1], v, &off))
+      { acc[nacc] = i;
+        accOff[nacc++] = off;
+      }
+  }
+  if (nacc == 0)
+  { free(acc);
+    free(accOff);
+    return 0;
+  }
+  gBase = (int *) malloc(nacc * sizeof(int));
+  gBreg = (int *) malloc(nacc * sizeof(int));
+  gOf = (int *) malloc(nacc * sizeof(int));
+  for (k = 0; k < nacc; k++)
+  { for (g = 0; g < ngroup; g++)
+      if (gBase[g] == acc[k]->arg[0]
+          && (gBase[g] != NOREG || gBreg[g] == acc[k]->breg))
+        break;
+    if (g == ngroup)
+    { gBase[ngroup] = acc[k]->arg[0];
+      gBreg[ngroup++] = acc[k]->breg;
+    }
+    gOf[k] = g;
+  }
+  /* does v die once the accesses use the pointers? */
+  left = useCount[v] - 1;
+  for (k = 0; k < nacc; k++)
+  { if (acc[k]->arg[1] == v) left--;
+    else
+    { for (j = 0; j < k; j++)
+        if (acc[j]->arg[1] == acc[k]->arg[1]) break;
+      if (j < k) continue;
+      for (j = k, off = 0; j < nacc; j++)
+        if (acc[j]->arg[1] == acc[k]->arg[1]) off++;
+      if (useCount[acc[k]->arg[1]] == off)
+      { left--;
+        deadOff++;
+      }
+    }
+  }
+  if (latch->last->op == IrBr && latch->last->arg[0] != NOREG)
+    cmp = defOf[latch->last->arg[0]];
+  if (cmp != NULL && (cmp->op != IrBin || !isCompare(cmp->binop)))
+    cmp = NULL;
+  other = NOREG;
+  if (cmp != NULL && cmp->arg[0] == next) other = cmp->arg[1];
+  else if (cmp != NULL && cmp->arg[1] == next) other = cmp->arg[0];
+  dies = left == 0 && useCount[next] == 2 && other != NOREG
+         && other != next && isInvariantReg(other, l);
+  /* each access saves its index arithmetic, each
+     pointer costs a step per trip */
+  if (nacc + (dies ? 3 + 2*deadOff : 0) - 3*ngroup <= 0)
+  { free(acc);
+    free(accOff);
+    free(gBase);
+    free(gBreg);
+    free(gOf);
+    return 0;
+  }
+  for (g = 0; g < ngroup; g++)
+  { p0 = irNewInst(IrAddr, 2);
+    p0->arg[0] = gBase[g];
+    p0->arg[1] = init;
+    p0->breg = gBreg[g];
+    p0->dst = irNewVreg(f);
+    irInsertBefore(l->pre->last, p0);
+    p1 = irNewInst(IrBin, 2);
+    p1->binop = backward ? PLUS : MINUS;
+    p1->dst = irNewVreg(f);
+    pphi = irNewInst(IrPhi, 2);
+    pphi->dst = irNewVreg(f);
+    pphi->arg[kpre] = p0->dst;
+    pphi->arg[1-kpre] = p1->dst;
+    pphi->imm = NOREG;
+    irInsertBefore(h->first, pphi);
+    p1->arg[0] = pphi->dst;
+    p1->arg[1] = step;
+    irInsertBefore(d->next, p1);
+    for (k = 0; k < nacc; k++)
+      if (gOf[k] == g)
+      { acc[k]->arg[0] = pphi->dst;
+        acc[k]->arg[1] = NOREG;
+        acc[k]->imm -= accOff[k];
+      }
+    if (g == 0 && dies)
+    { /* v < n holds when B - v > B - n */
+      a = irNewInst(IrAddr, 2);
+      a->arg[0] = gBase[g];
+      a->arg[1] = other;
+      a->breg = gBreg[g];
+      a->dst = irNewVreg(f);
+      irInsertBefore(l->pre->last, a);
+      lim = a->dst;
+      if (cmp->arg[0] == next)
+      { cmp->arg[0] = p1->dst;
+        cmp->arg[1] = lim;
+      }
+      else
+      { cmp->arg[0] = lim;
+        cmp->arg[1] = p1->dst;
+      }
+      cmp->binop = mirror(cmp->binop);
+    }
+  }
+  free(acc);
+  free(accOff);
+  free(gBase);
+  free(gBreg);
+  free(gOf);
+  return nacc;
+}
+
+/* Function reduceInductions strength-reduces the
+ * array accesses indexed by induction variables in
+ * the loops of f and returns how many it rewrote
+ */
+int reduceInductions(IrFunc f)
+{ IrInst phi;
+  Loop * l;
+  int m, kpre, count = 0;
+  countRegs(f);
+  findLoops(f);
+  for (m = 0; m < nloop; m++)
+  { l = &loops[m];
+    if (l->pre == NULL || l->header->npred != 2) continue;
+    kpre = l->header->pred[0] == l->pre ? 0 : 1;
+    for (phi = l->header->first; phi != NULL && phi->op == IrPhi; phi = phi->next)
+      if (phi->imm != NOREG) count += reduceInduction(f, l, phi, kpre);
+  }
+  freeLoops();
+  if (count > 0) irCleanup(f);
+  return count;
+}
+
+/**************************************************/
+/***********   Common subexpressions      *********/
+/**************************************************/
+
+/* CSE_HASH is the size of the table of available
+ * expressions
+ */
+#define CSE_HASH 211
+
+/* an available expression: the instruction that
+ * computed it, into register value
+ */
+typedef struct ExprRec
+{ IrInst inst;
+  int value;
+  struct ExprRec * next;
+} * Expr;
+
+static __thread Expr exprTable[CSE_HASH];
+
+/* exprStack holds the entries in the order they were
+ * made, so that leaving a block of the dominator tree
+ * removes its own
+ */
+static __thread Expr * exprStack = NULL;
+static __thread int exprCount = 0, exprMax = 0;
+
+/* memory words known in the current block: the load
+ * or store that accessed them and the value there
+ */
+static __thread struct ExprRec * memAvail = NULL;
+static __thread int memCount = 0, memMax = 0;
+
+/* rep maps each removed register to the one that
+ * replaces it
+ */
+static __thread int * rep;
+
+/* Function sameAddress returns TRUE if memory
+ * instructions a and b access the same operand
+ */
+static int sameAddress(IrInst a, IrInst b)
+{ return a->arg[0] == b->arg[0] && a->arg[1] == b->arg[1]
+      && a->imm == b->imm && (a->arg[0] != NOREG || a->breg == b->breg);
+}
+
+/* Function sameExpr returns TRUE if a and b compute
+ * the same value from the same registers
+ */
+static int sameExpr(IrInst a, IrInst b)
+{ if (a->op != b->op) return FALSE;
+  if (a->op == IrBin)
+    return a->binop == b->binop && a->arg[0] == b->arg[0]
+        && a->arg[1] == b->arg[1];
+  return sameAddress(a, b);
+}
+
+/* Function hashExpr returns the bucket of i */
+static int hashExpr(IrInst i)
+{ unsigned h = i->op * 31 + i->binop;
+  int k;
+  for (k = 0; k < 2; k++) h = h * 31 + (unsigned) i->arg[k];
+  h = h * 31 + (unsigned) i->imm;
+  return h % CSE_HASH;
+}
+
+/* Procedure pushExpr makes the value of i available */
+static void pushExpr(IrInst i)
+{ Expr e = (Expr) malloc(sizeof(struct ExprRec));
+  int h = hashExpr(i);
+  e->inst = i;
+  e->value = i->dst;
+  e->next = exprTable[h];
+  exprTable[h] = e;
+  if (exprCount == exprMax)
+  { exprMax = exprMax ? 2*exprMax : 64;
+    exprStack = (Expr *) realloc(exprStack, exprMax * sizeof(Expr));
+  }
+  exprStack[exprCount++] = e;
+}
+
+/* Function findExpr returns the available value
+ * computed as i computes it, NULL if there is none
+ */
+static Expr findExpr(IrInst i)
+{ Expr e;
+  for (e = exprTable[hashExpr(i)]; e != NULL; e = e->next)
+    if (sameExpr(e->inst, i)) return e;
+  return NULL;
+}
+
+/* Procedure addMem records that the word accessed
+ * by i holds value
+ */
+static void addMem(IrInst i, int value)
+{ if (memCount == memMax)
+  { memMax = memMax ? 2*memMax : 32;
+    memAvail = (struct ExprRec *) realloc(memAvail, memMax * sizeof(struct ExprRec));
+  }
+  memAvail[memCount].inst = i;
+  memAvail[memCount++].value = value;
+}
+
+/* Procedure killMem forgets the words store i may
+ * overwrite
+ */
+static void killMem(IrInst i)
+{ int j, n = 0;
+  for (j = 0; j < memCount; j++)
+    if (!mayAlias(memAvail[j].inst, i)) memAvail[n++] = memAvail[j];
+  memCount = n;
+}
+
+/* Function isCommutative returns TRUE for operators
+ * whose operands may be exchanged
+ */
+static int isCommutative(TokenType op)
+{ return op == PLUS || op == TIMES || op == EQ || op == NE; }
+
+/* Function cseBlock removes the instructions of b and
+ * of the blocks it dominates that recompute a value
+ * available from a dominating block, or a word read or
+ * written earlier in the same block, and returns how
+ * many it removed. Memory words are not carried into
+ * other blocks: the reuse would have to be stored on
+ * every path, where a reload is paid only on the path
+ * that needs it.
+ */
+static int cseBlock(IrFunc f, IrFunc all, IrBlock b)
+{ IrInst i, next;
+  IrFunc h;
+  Expr e;
+  int j, k, t, mark = exprCount, count = 0;
+  memCount = 0;
+  for (i = b->first; i != NULL; i = next)
+  { next = i->next;
+    for (k = 0; k < i->narg; k++)
+      if (i->arg[k] != NOREG) i->arg[k] = rep[i->arg[k]];
+    switch (i->op)
+    { case IrBin:
+      case IrAddr:
+        if (i->op == IrAddr && i->arg[0] == NOREG && i->arg[1] == NOREG)
+          break; /* a single LDA anyway */
+        if (i->op == IrBin && isCommutative(i->binop) && i->arg[0] > i->arg[1])
+        { t = i->arg[0];
+          i->arg[0] = i->arg[1];
+          i->arg[1] = t;
+        }
+        if ((e = findExpr(i)) != NULL)
+        { rep[i->dst] = e->value;
+          irRemove(i);
+          count++;
+        }
+        else
+          pushExpr(i);
+        break;
+      case IrLoad:
+        for (j = memCount - 1; j >= 0; j--)
+          if (sameAddress(memAvail[j].inst, i)) break;
+        if (j >= 0)
+        { rep[i->dst] = memAvail[j].value;
+          irRemove(i);
+          count++;
+        }
+        else
+          addMem(i, i->dst);
+        break;
+      case IrStore:
+        killMem(i);
+        addMem(i, i->arg[2]);
+        break;
+      case IrCall:
+        h = funcOf(all, i->callee->name);
+        if (h == NULL || h->storesMem) memCount = 0;
+        break;
+      default:
+        break;
+    }
+  }
+  for (j = b->rpo + 1; j < f->nblock; j++)
+    if (f->block[j]->idom == b) count += cseBlock(f, all, f->block[j]);
+  while (exprCount > mark)
+  { e = exprStack[--exprCount];
+    exprTable[hashExpr(e->inst)] = e->next;
+    free(e);
+  }
+  return count;
+}
+
+/* Function eliminateCommon removes the computations
+ * of f that repeat a value already available, and
+ * returns how many it removed; all is the list of
+ * functions, for calls
+ */
+int eliminateCommon(IrFunc f, IrFunc all)
+{ IrInst i;
+  int j, k, v, count;
+  rep = (int *) malloc(f->nvreg * sizeof(int));
+  for (v = 0; v < f->nvreg; v++) rep[v] = v;
+  count = cseBlock(f, all, f->block[0]);
+  /* phis may name registers removed in later blocks */
+  for (j = 0; j < f->nblock; j++)
+    for (i = f->block[j]->first; i != NULL; i = i->next)
+      for (k = 0; k < i->narg; k++)
+        if (i->arg[k] != NOREG) i->arg[k] = rep[i->arg[k]];
+  free(rep);
+  if (count > 0) irCleanup(f);
+  return count;
+}
+
+/* Function countIr returns the number of instructions
+ * of the functions in the list f, and in *dynamic an
+ * estimate of how often they run: each counts 10
+ * times for each loop around it, up to 4
+ */
+int countIr(IrFunc f, long * dynamic)
+{ IrInst i;
+  int j, m, d, count = 0;
+  long w;
+  *dynamic = 0;
+  for (; f != NULL; f = f->next)
+  { findLoops(f);
+    for (j = 0; j < f->nblock; j++)
+    { for (m = 0, d = 0; m < nloop; m++)
+        if (loops[m].in[j]) d++;
+      for (w = 1; d > 0 && w < 10000; d--) w *= 10;
+      for (i = f->block[j]->first; i != NULL; i = i->next)
+      { count++;
+        *dynamic += w;
+      }
+    }
+    freeLoops();
+  }
+  return count;
+}
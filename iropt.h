@@ -0,0 +1,50 @@
+/****************************************************/
+/* File: iropt.h                                    */
+/* Optimizer interface for the IR of the            */
+/* C-minus compiler                                 */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _IROPT_H_
+#define _IROPT_H_
+
+#include "ir.h"
+
+/* Procedure findStores sets storesMem in each
+ * function of the list f that may store to memory
+ * itself or through the functions it calls, as the
+ * code kept for a function records them
+ */
+void findStores(IrFunc f);
+
+/* Function eliminateCommon removes the computations
+ * of f that repeat a value available in a dominating
+ * block, and the loads of words already read or
+ * written in the same block, and returns how many it
+ * removed; all is the list of functions
+ */
+int eliminateCommon(IrFunc f, IrFunc all);
+
+/* Function hoistInvariants moves the computations
+ * of each loop of f whose operands do not change in
+ * the loop into its preheader and returns how many
+ * it moved; all is the list of functions
+ */
+int hoistInvariants(IrFunc f, IrFunc all);
+
+/* Function reduceInductions keeps a pointer stepped
+ * along each induction variable of a loop of f that
+ * indexes arrays, in place of the index arithmetic,
+ * and returns the number of accesses rewritten
+ */
+int reduceInductions(IrFunc f);
+
+/* Function countIr returns the number of instructions
+ * of the functions in the list f, and in *dynamic an
+ * estimate of how often they run: each counts 10
+ * times for each loop around it, up to 4
+ */
+int countIr(IrFunc f, long * dynamic);
+
+#endif
@@ -8,95 +8,166 @@
 #include "globals.h"
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
+#ifndef NO_PARSE
 #define NO_PARSE FALSE
+#endif
 /* set NO_ANALYZE to TRUE to get a parser-only compiler */
+#ifndef NO_ANALYZE
 #define NO_ANALYZE FALSE
+#endif
 
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
+#ifndef NO_CODE
 #define NO_CODE FALSE
+#endif
 
 #include "util.h"
-#if NO_PARSE
-#include "scan.h"
-#else
-#include "parse.h"
-#if !NO_ANALYZE
-#include "analyze.h"
-#if !NO_CODE
-#include "cgen.h"
-#endif
-#endif
+#include "context.h"
+#include "compile.h"
+#if !NO_PARSE && !NO_ANALYZE && !NO_CODE
+#include "pass.h"
 #endif
 
-/* allocate global variables */
-int lineno = 0;
-FILE * source;
-FILE * listing;
-FILE * code;
+#include <unistd.h>
 
-/* allocate and set tracing flags */
-int EchoSource = TRUE;
-int TraceScan = FALSE;
-int TraceParse = FALSE;
-int TraceAnalyze = FALSE;
-int TraceCode = TRUE;
+/* the options and programs of the command line; each
+ * program of a batch gets a context of its own with
+ * the options set again
+ */
+static char ** options;
+static int noptions = 0;
+static char ** pgms;
+static int npgms = 0, maxpgms = 0;
 
-int Error = FALSE;
+/* Procedure usage prints the command line syntax
+ * and exits
+ */
+static void usage(char * prog)
+{ fprintf(stderr,"usage: %s [-O0|-O1|-O2] [-fPASS|-fno-PASS] "
+                 "[-passes=PASS,...] [-time-passes] [-unroll-factor=N] "
+                 "[-debug-map] [-profile-use=NAME] [-rdparse] [-ast-cache] "
+                 "[-incremental] [-iaddr-size=N] [-jobs=N] [-manifest=FILE] "
+                 "<filename>...\n",prog);
+  exit(1);
+}
 
-main( int argc, char * argv[] )
-{ TreeNode * syntaxTree;
-  char pgm[120]; /* source code file name */
-  if (argc != 2)
-    { fprintf(stderr,"usage: %s <filename>\n",argv[0]);
-      exit(1);
-    }
-  strcpy(pgm,argv[1]) ;
-  if (strchr (pgm, '.') == NULL)
-     strcat(pgm,".tny");
-  source = fopen(pgm,"r");
-  if (source==NULL)
-  { fprintf(stderr,"File %s not found\n",pgm);
+/* Function setOption sets option arg in the context
+ * of the calling thread; it returns FALSE if arg is
+ * not an option of the compiler
+ */
+static int setOption(char * arg)
+{ if (arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0'
+      && arg[2] <= '2' && arg[3] == '\0')
+    cc->OptLevel = arg[2] - '0';
+  else if (strcmp(arg,"-rdparse") == 0)
+    cc->RdParse = TRUE;
+  else if (strcmp(arg,"-ast-cache") == 0)
+    cc->AstCache = TRUE;
+  else if (strcmp(arg,"-incremental") == 0)
+    cc->Incremental = TRUE;
+  else if (strncmp(arg,"-iaddr-size=",12) == 0 && atoi(arg + 12) > 0)
+    cc->IaddrSize = atoi(arg + 12);
+#if !NO_PARSE && !NO_ANALYZE && !NO_CODE
+  else if (passOption(arg))
+    ;
+#endif
+  else
+    return FALSE;
+  return TRUE;
+}
+
+/* Function optionContext returns a new context with
+ * the options of the command line, for compileBatch
+ */
+static CompilerContext * optionContext(void)
+{ CompilerContext * c = newContext();
+  int k;
+  useContext(c);
+  for (k = 0; k < noptions; k++) setOption(options[k]);
+  return c;
+}
+
+/* Procedure addProgram adds the program in file to
+ * those to compile, with extension .tny if it has none
+ */
+static void addProgram(char * file)
+{ char * pgm = (char *) malloc(strlen(file) + 5);
+  if (npgms == maxpgms)
+  { maxpgms = maxpgms == 0 ? 16 : 2 * maxpgms;
+    pgms = (char **) realloc(pgms, maxpgms * sizeof(char *));
+  }
+  if (pgm == NULL || pgms == NULL)
+  { fprintf(stderr,"Out of memory error reading the command line\n");
     exit(1);
   }
-  listing = stdout; /* send listing to screen */
-  fprintf(listing,"\nTINY COMPILATION: %s\n",pgm);
-#if NO_PARSE
-  while (getToken()!=ENDFILE);
-#else
-  syntaxTree = parse();
-  if (TraceParse) {
-    fprintf(listing,"\nSyntax tree:\n");
-    printTree(syntaxTree);
+  strcpy(pgm,file);
+  if (strchr(pgm,'.') == NULL)
+    strcat(pgm,".tny");
+  pgms[npgms++] = pgm;
+}
+
+/* Procedure readManifest adds the programs listed in
+ * file manifest, one to a line; blank lines and lines
+ * that start with # are skipped
+ */
+static void readManifest(char * manifest)
+{ char line[1024];
+  char * s, * e;
+  FILE * f = fopen(manifest,"r");
+  if (f == NULL)
+  { fprintf(stderr,"Manifest %s not found\n",manifest);
+    exit(1);
   }
-#if !NO_ANALYZE
-  if (! Error)
-  { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
-    buildSymtab(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
-    typeCheck(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
+  while (fgets(line,sizeof(line),f) != NULL)
+  { s = line;
+    while (isspace(*s)) s++;
+    e = s + strlen(s);
+    while (e > s && isspace(e[-1])) e--;
+    *e = '\0';
+    if (*s != '\0' && *s != '#') addProgram(s);
   }
-#if !NO_CODE
-  if (! Error)
-  { char * codefile;
-    int fnlen = strcspn(pgm,".");
-    codefile = (char *) calloc(fnlen+4, sizeof(char));
-    strncpy(codefile,pgm,fnlen);
-    strcat(codefile,".tm");
-    code = fopen(codefile,"w");
-    if (code == NULL)
-    { printf("Unable to open %s\n",codefile);
-      exit(1);
+  fclose(f);
+}
+
+main( int argc, char * argv[] )
+{ CompilerContext * c = newContext();
+  int argi, k, status;
+  int jobs = 0, batch = FALSE;
+  options = (char **) malloc(argc * sizeof(char *));
+  useContext(c); /* setOption sets the options of cc */
+  for (argi = 1; argi < argc; argi++)
+  { char * arg = argv[argi];
+    if (strncmp(arg,"-jobs=",6) == 0 && atoi(arg + 6) > 0)
+    { jobs = atoi(arg + 6);
+      batch = TRUE;
+    }
+    else if (strncmp(arg,"-manifest=",10) == 0)
+    { readManifest(arg + 10);
+      batch = TRUE;
     }
-    codeGen(syntaxTree,codefile);
-    fclose(code);
+    else if (setOption(arg))
+      options[noptions++] = arg;
+    else if (arg[0] != '-')
+      addProgram(arg);
+    else
+      usage(argv[0]);
   }
-#endif
-#endif
-#endif
-  fclose(source);
-  return 0;
+  if (npgms == 0) usage(argv[0]);
+  if (npgms > 1) batch = TRUE;
+  if (!batch)
+  { compileFile(c,pgms[0]);
+    status = c->source == NULL; /* the file was not found */
+    freeContext(c);
+  }
+  else
+  { freeContext(c);
+    if (jobs == 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    status = compileBatch(pgms,npgms,jobs,optionContext) > 0;
+  }
+  for (k = 0; k < npgms; k++) free(pgms[k]);
+  free(pgms);
+  free(options);
+  return status;
 }
-
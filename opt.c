@@ -0,0 +1,1346 @@
+/****************************************************/
+/* File: opt.c                                      */
+/* Syntax tree optimizer implementation             */
+/* for the C-minus compiler                         */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "opt.h"
+#include "profile.h"
+#include "context.h"
+#include "pass.h"
+
+/* INLINE_SIZE is the largest function body, in
+ * syntax tree nodes, that inlineCalls substitutes
+ */
+#define INLINE_SIZE 40
+
+/* INLINE_HOT_SIZE replaces INLINE_SIZE for a call
+ * made at least INLINE_HOT_CALLS times in the profile
+ */
+#define INLINE_HOT_SIZE 100
+#define INLINE_HOT_CALLS 100
+
+/* INLINE_BUDGET bounds the number of nodes that
+ * inlineCalls may add to the whole program
+ */
+#define INLINE_BUDGET 2000
+
+/* MAXRENAME bounds the parameters and locals of
+ * an inlined function
+ */
+#define MAXRENAME 64
+
+/* SPECIALIZE_SIZE is the largest function body, in
+ * syntax tree nodes, that specializeCalls clones
+ */
+#define SPECIALIZE_SIZE 200
+
+/* SPECIALIZE_GROWTH bounds the number of nodes that
+ * the clones of specializeCalls may add to the
+ * program, in percent of its size
+ */
+#define SPECIALIZE_GROWTH 50
+
+/* MAXCLONES bounds the specialized functions */
+#define MAXCLONES 32
+
+/* UNROLL_SIZE is the largest loop body, in syntax
+ * tree nodes, that unrollLoops unrolls
+ */
+#define UNROLL_SIZE 60
+
+/* UNROLL_FULL bounds the nodes a loop may take once
+ * unrolled completely
+ */
+#define UNROLL_FULL 240
+
+/* UNROLL_BUDGET bounds the number of nodes that
+ * unrollLoops may add to the whole program
+ */
+#define UNROLL_BUDGET 1000
+
+/* TREE_NODE_INSTS and IR_NODE_INSTS are about the
+ * most TM instructions a hundred syntax tree nodes
+ * become with the code generator of -O0 and with the
+ * IR one; the passes that copy code keep the program
+ * within the nodes whose code fills cc->IaddrSize
+ * at that rate
+ */
+#define TREE_NODE_INSTS 280
+#define IR_NODE_INSTS 120
+
+/* changed is set whenever the tree is rewritten,
+ * so that foldConstants can iterate to a fixed point
+ */
+static __thread int changed;
+
+/* Function isConst returns TRUE if t is a constant */
+static int isConst(TreeNode * t)
+{ return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK; }
+
+/* Function isVarRef returns TRUE if t is a plain
+ * (non-array) reference to the variable name
+ */
+static int isVarRef(TreeNode * t, char * name)
+{ return t != NULL && t->nodekind == ExpK && t->kind.exp == IdK
+      && t->attr.name == name;
+}
+
+/* Function isScalarAssign returns TRUE if t assigns
+ * to a plain variable (child[0] is written, not read)
+ */
+static int isScalarAssign(TreeNode * t)
+{ return t->nodekind == ExpK && t->kind.exp == AssignK
+      && t->child[0]->kind.exp == IdK;
+}
+
+/* Function hasSideEffect returns TRUE if evaluating
+ * expression t may call a function or assign
+ */
+static int hasSideEffect(TreeNode * t)
+{ TreeNode * c;
+  int i;
+  if (t->nodekind == ExpK && (t->kind.exp == CallK
+      || t->kind.exp == AssignK || t->kind.exp == InlineK))
+    return TRUE;
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      if (hasSideEffect(c)) return TRUE;
+  return FALSE;
+}
+
+/* Function foldOp computes l op r into val. It returns
+ * FALSE if the operation has to be left to run time
+ */
+static int foldOp(TokenType op, int l, int r, int * val)
+{ switch (op)
+  { case PLUS:  *val = (int) ((unsigned) l + (unsigned) r); break;
+    case MINUS: *val = (int) ((unsigned) l - (unsigned) r); break;
+    case TIMES: *val = (int) ((unsigned) l * (unsigned) r); break;
+    case OVER:
+      /* division by zero traps in TM: keep it */
+      if (r == 0 || (l == INT_MIN && r == -1)) return FALSE;
+      *val = l / r;
+      break;
+    case LT: *val = l <  r; break;
+    case LE: *val = l <= r; break;
+    case GT: *val = l >  r; break;
+    case GE: *val = l >= r; break;
+    case EQ: *val = l == r; break;
+    case NE: *val = l != r; break;
+    default: return FALSE;
+  }
+  return TRUE;
+}
+
+/* Procedure makeConst turns node t into constant val */
+static void makeConst(TreeNode * t, int val)
+{ int i;
+  for (i=0; i < MAXCHILDREN; i++) t->child[i] = NULL;
+  t->nodekind = ExpK;
+  t->kind.exp = ConstK;
+  t->attr.val = val;
+  t->type = Integer;
+  changed = TRUE;
+}
+
+/* Procedure replaceNode overwrites t with its operand c,
+ * keeping t's place in the sibling list
+ */
+static void replaceNode(TreeNode * t, TreeNode * c)
+{ TreeNode * sibling = t->sibling;
+  *t = *c;
+  t->sibling = sibling;
+  changed = TRUE;
+}
+
+/* Procedure foldExp folds the expression tree t
+ * bottom-up; operands that are both constant are
+ * evaluated and identities (x+0, x*1, ...) removed
+ */
+static TreeNode * foldStmt(TreeNode * t);
+
+static void foldExp(TreeNode * t)
+{ TreeNode * c, * l, * r;
+  int i, val;
+  if (t == NULL || t->nodekind != ExpK) return;
+  if (t->kind.exp == InlineK)
+  { for (c = t->child[0]; c != NULL; c = c->sibling)
+      foldExp(c);
+    foldStmt(t->child[1]);
+    return;
+  }
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      foldExp(c);
+  if (t->kind.exp != OpK) return;
+  l = t->child[0];
+  r = t->child[1];
+  if (isConst(l) && isConst(r))
+  { if (foldOp(t->attr.op, l->attr.val, r->attr.val, &val))
+      makeConst(t, val);
+  }
+  else if (isConst(r) && r->attr.val == 0
+           && (t->attr.op == PLUS || t->attr.op == MINUS))
+    replaceNode(t, l);
+  else if (isConst(l) && l->attr.val == 0 && t->attr.op == PLUS)
+    replaceNode(t, r);
+  else if (isConst(r) && r->attr.val == 1
+           && (t->attr.op == TIMES || t->attr.op == OVER))
+    replaceNode(t, l);
+  else if (isConst(l) && l->attr.val == 1 && t->attr.op == TIMES)
+    replaceNode(t, r);
+  else if (t->attr.op == TIMES
+           && ((isConst(r) && r->attr.val == 0 && !hasSideEffect(l))
+            || (isConst(l) && l->attr.val == 0 && !hasSideEffect(r))))
+    makeConst(t, 0);
+}
+
+static TreeNode * foldStmts(TreeNode * t);
+
+/* Function foldStmt folds statement t and returns the
+ * statement that replaces it, or NULL if it is removed
+ * (an if or while whose test is decided statically)
+ */
+static TreeNode * foldStmt(TreeNode * t)
+{ switch (t->nodekind)
+  { case StmtK:
+      switch (t->kind.stmt)
+      { case CompK:
+          t->child[1] = foldStmts(t->child[1]);
+          break;
+        case IfK:
+          foldExp(t->child[0]);
+          t->child[1] = foldStmts(t->child[1]);
+          t->child[2] = foldStmts(t->child[2]);
+          if (isConst(t->child[0]))
+          { changed = TRUE;
+            return t->child[0]->attr.val ? t->child[1] : t->child[2];
+          }
+          break;
+        case IterK:
+          foldExp(t->child[0]);
+          t->child[1] = foldStmts(t->child[1]);
+          /* while(true) is kept; cgen drops its test */
+          if (isConst(t->child[0]) && t->child[0]->attr.val == 0)
+          { changed = TRUE;
+            return NULL;
+          }
+          break;
+        case RetK:
+          foldExp(t->child[0]);
+          break;
+        default:
+          break;
+      }
+      break;
+    case ExpK:
+      foldExp(t);
+      break;
+    default:
+      break;
+  }
+  return t;
+}
+
+/* Function foldStmts folds the statement list t
+ * and returns its (possibly new) head
+ */
+static TreeNode * foldStmts(TreeNode * t)
+{ TreeNode * head = NULL, * prev = NULL, * next, * r;
+  while (t != NULL)
+  { next = t->sibling;
+    r = foldStmt(t);
+    if (r != NULL)
+    { r->sibling = next;
+      if (prev == NULL) head = r;
+      else prev->sibling = r;
+      prev = r;
+    }
+    else if (prev != NULL)
+      prev->sibling = next;
+    t = next;
+  }
+  return head;
+}
+
+/* Function countAssigns counts the assignments to the
+ * variable name in t and its subtrees; last is set
+ * to the assignment node found last
+ */
+static int countAssigns(TreeNode * t, char * name, TreeNode ** last)
+{ TreeNode * c;
+  int i, n = 0;
+  if (isScalarAssign(t) && isVarRef(t->child[0], name))
+  { n++;
+    *last = t;
+  }
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      n += countAssigns(c, name, last);
+  return n;
+}
+
+/* Function substReads replaces every read of the
+ * variable name in t by the constant val (only when
+ * subst is TRUE); it returns the number of reads found
+ */
+static int substReads(TreeNode * t, char * name, int subst, int val)
+{ TreeNode * c;
+  int i, n = 0;
+  if (isVarRef(t, name))
+  { if (subst) makeConst(t, val);
+    return 1;
+  }
+  for (i=0; i < MAXCHILDREN; i++)
+  { if (i == 0 && isScalarAssign(t)) continue; /* a write */
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      n += substReads(c, name, subst, val);
+  }
+  return n;
+}
+
+/* Procedure propagateVar substitutes the value of local
+ * name of function f when it is assigned exactly once,
+ * by a constant assignment at the top level of the
+ * body, and is not read before that assignment
+ */
+static void propagateVar(TreeNode * f, char * name)
+{ TreeNode * body = f->child[2];
+  TreeNode * assign = NULL, * s;
+  if (countAssigns(body, name, &assign) != 1) return;
+  if (!isConst(assign->child[1])) return;
+  for (s = body->child[1]; s != NULL && s != assign; s = s->sibling)
+    if (substReads(s, name, FALSE, 0) > 0) return;
+  if (s == NULL) return; /* not a top-level statement */
+  for (s = s->sibling; s != NULL; s = s->sibling)
+    substReads(s, name, TRUE, assign->child[1]->attr.val);
+}
+
+/* Procedure propagateLocals calls propagateVar for
+ * each scalar local declared in a block of t
+ */
+static void propagateLocals(TreeNode * f, TreeNode * t)
+{ TreeNode * c;
+  int i;
+  if (t->nodekind == StmtK && t->kind.stmt == CompK)
+    for (c = t->child[0]; c != NULL; c = c->sibling)
+      if (c->nodekind == DeclK && c->kind.decl == VarK)
+        propagateVar(f, c->attr.name);
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      propagateLocals(f, c);
+}
+
+/* Procedure foldConstants folds constant operator
+ * nodes, propagates the values of locals that are
+ * assigned a constant exactly once, and prunes
+ * if/while statements whose test is constant.
+ * Runs between typeCheck and codeGen.
+ */
+void foldConstants(TreeNode * syntaxTree)
+{ TreeNode * t;
+  do
+  { changed = FALSE;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+      if (t->nodekind == DeclK && t->kind.decl == FuncK)
+      { foldStmt(t->child[2]);
+        propagateLocals(t, t->child[2]);
+      }
+  } while (changed);
+}
+
+/* a parameter or local of an inlined function and
+ * what it becomes in the caller: a name, or a
+ * constant when isConst is set
+ */
+typedef struct
+{ char * from;
+  char * to;
+  ExpType type;
+  int size;
+  int isConst;
+  int val;
+} Rename;
+
+/* Function countNodes returns the number of nodes
+ * in t and its subtrees
+ */
+static int countNodes(TreeNode * t)
+{ TreeNode * c;
+  int i, n = 1;
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      n += countNodes(c);
+  return n;
+}
+
+/* Function programSize returns the number of nodes
+ * of the program syntaxTree
+ */
+static int programSize(TreeNode * syntaxTree)
+{ int size = 0;
+  for (; syntaxTree != NULL; syntaxTree = syntaxTree->sibling)
+    size += countNodes(syntaxTree);
+  return size;
+}
+
+/* Function growthBudget returns the nodes a pass may
+ * add to a program of size nodes, at most limit: no
+ * more than keeps its code within the instruction
+ * memory of TM
+ */
+static int growthBudget(int size, int limit)
+{ long room = (long) cc->IaddrSize * 100
+              / (usesIr() ? IR_NODE_INSTS : TREE_NODE_INSTS) - size;
+  if (room > limit) room = limit;
+  return room < 0 ? 0 : (int) room;
+}
+
+/* Function isBuiltin returns TRUE for the names of
+ * the input and output functions
+ */
+static int isBuiltin(char * name)
+{ return name == inputName || name == outputName; }
+
+/* Function hasCall returns TRUE if t calls a function
+ * other than input and output
+ */
+static int hasCall(TreeNode * t)
+{ TreeNode * c;
+  int i;
+  if (t->nodekind == ExpK && (t->kind.exp == InlineK ||
+      (t->kind.exp == CallK && !isBuiltin(t->attr.name))))
+    return TRUE;
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      if (hasCall(c)) return TRUE;
+  return FALSE;
+}
+
+/* Function findRename returns the entry for name
+ * in map, or NULL for a global of the callee
+ */
+static Rename * findRename(Rename * map, int n, char * name)
+{ int i;
+  for (i=0; i < n; i++)
+    if (map[i].from == name) return &map[i];
+  return NULL;
+}
+
+/* Function collectLocals adds the locals declared in
+ * the blocks of t to map; it returns the new number
+ * of entries, or -1 if map is full or a name is
+ * declared twice (a block shadowing another)
+ */
+static int collectLocals(TreeNode * t, Rename * map, int n)
+{ TreeNode * c;
+  char * name;
+  int i;
+  if (t->nodekind == StmtK && t->kind.stmt == CompK)
+    for (c = t->child[0]; c != NULL; c = c->sibling)
+    { name = c->kind.decl == ArrVarK ? c->attr.arr.name : c->attr.name;
+      if (n == MAXRENAME || findRename(map, n, name) != NULL) return -1;
+      map[n].from = name;
+      map[n].isConst = FALSE;
+      map[n].type = c->kind.decl == ArrVarK ? IntegerArray : Integer;
+      map[n].size = c->kind.decl == ArrVarK ? c->attr.arr.size : 1;
+      n++;
+    }
+  for (i=0; i < MAXCHILDREN && n >= 0; i++)
+    for (c = t->child[i]; c != NULL && n >= 0; c = c->sibling)
+      n = collectLocals(c, map, n);
+  return n;
+}
+
+/* Function shadowsGlobal returns TRUE if a global used
+ * in t (a name not in map) is declared in scope cs,
+ * where the inlined body would see the local instead
+ */
+static int shadowsGlobal(TreeNode * t, Rename * map, int n, ScopeList cs)
+{ TreeNode * c;
+  int i, shadowed;
+  if (t->nodekind == ExpK && (t->kind.exp == IdK || t->kind.exp == ArrIdK)
+      && findRename(map, n, t->attr.name) == NULL)
+  { push_scope(cs);
+    st_lookup("temp", t->attr.name);
+    shadowed = cc->symtab.scope_name != globalName;
+    pop_scope();
+    if (shadowed) return TRUE;
+  }
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      if (shadowsGlobal(c, map, n, cs)) return TRUE;
+  return FALSE;
+}
+
+/* Function newLocal adds a fresh local of size words
+ * to the frame of scope cs and returns its name
+ */
+static char * newLocal(ScopeList cs, char * callee, Rename * r)
+{ char buffer[256];
+  char * fresh;
+  sprintf(buffer, "%s.%s.%d", callee, r->from, ++cc->opt.inlineCount);
+  fresh = internString(buffer);
+  push_scope(cs);
+  st_insert("Var", fresh, r->type, 0, 0, cs->frameSize);
+  pop_scope();
+  cs->frameSize += r->size;
+  return fresh;
+}
+
+/* Procedure renameTree applies map to the variable
+ * references of t and drops its local declarations
+ */
+static void renameTree(TreeNode * t, Rename * map, int n)
+{ TreeNode * c;
+  Rename * r;
+  int i;
+  if (t->nodekind == StmtK && t->kind.stmt == CompK)
+    t->child[0] = NULL;
+  if (t->nodekind == ExpK && (t->kind.exp == IdK || t->kind.exp == ArrIdK)
+      && (r = findRename(map, n, t->attr.name)) != NULL)
+  { if (r->isConst) makeConst(t, r->val);
+    else t->attr.name = r->to;
+  }
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      renameTree(c, map, n);
+}
+
+/* Procedure inlineCall replaces call t in the function
+ * with scope cs by an InlineK node: child[0] assigns
+ * the arguments to fresh locals (last argument first,
+ * as a call evaluates them), child[1] is a renamed
+ * copy of the body. Array parameters are replaced by
+ * the array passed, and scalar parameters that are
+ * never assigned by a constant argument.
+ */
+static void inlineCall(TreeNode * t, ScopeList cs)
+{ TreeNode * f = getpl(t->attr.name)->treenode;
+  TreeNode * body = f->child[2];
+  TreeNode * p, * arg, * next, * assign, * init = NULL, * last;
+  Rename map[MAXRENAME];
+  int i, n = 0, size;
+  long calls = profileCount("call", t->lineno, t->attr.name);
+  /* a call the profile never saw made is not worth
+     the code, and one made often is worth more */
+  if (calls == 0) return;
+  size = countNodes(body);
+  if (size > (calls >= INLINE_HOT_CALLS ? INLINE_HOT_SIZE : INLINE_SIZE)
+      || cc->opt.inlineGrowth + size > INLINE_BUDGET) return;
+  if (hasCall(body)) return;
+  for (p = f->child[1]; p != NULL && p->nodekind == ParamK; p = p->sibling)
+  { if (n == MAXRENAME) return;
+    map[n].from = p->attr.name;
+    map[n].isConst = FALSE;
+    map[n].type = Integer;
+    map[n++].size = 1;
+  }
+  i = n;
+  n = collectLocals(body, map, n);
+  if (n < 0 || shadowsGlobal(body, map, n, cs)) return;
+  cc->opt.inlineGrowth += size;
+  for (; i < n; i++)
+    map[i].to = newLocal(cs, f->attr.name, &map[i]);
+  arg = t->child[0];
+  for (p = f->child[1], i = 0; p != NULL && p->nodekind == ParamK;
+       p = p->sibling, i++)
+  { next = arg->sibling;
+    arg->sibling = NULL;
+    if (p->kind.param == ArrParamK)
+      map[i].to = arg->attr.name;
+    else if (isConst(arg) && countAssigns(body, p->attr.name, &last) == 0)
+    { map[i].isConst = TRUE;
+      map[i].val = arg->attr.val;
+    }
+    else
+    { map[i].to = newLocal(cs, f->attr.name, &map[i]);
+      assign = newExpNode(AssignK);
+      assign->lineno = t->lineno;
+      assign->type = Integer;
+      assign->child[0] = newExpNode(IdK);
+      assign->child[0]->lineno = t->lineno;
+      assign->child[0]->type = Integer;
+      assign->child[0]->attr.name = map[i].to;
+      assign->child[1] = arg;
+      assign->sibling = init;
+      init = assign;
+    }
+    arg = next;
+  }
+  body = copyTree(body);
+  renameTree(body, map, n);
+  t->kind.exp = InlineK;
+  t->child[0] = init;
+  t->child[1] = body;
+  t->type = f->type;
+}
+
+/* Procedure inlineTree inlines the calls in t, a part
+ * of the body of function f with scope cs; arguments
+ * are visited first, so calls nested in them go too
+ */
+static void inlineTree(TreeNode * t, TreeNode * f, ScopeList cs)
+{ TreeNode * c;
+  FuncParam pl;
+  int i;
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      inlineTree(c, f, cs);
+  if (t->nodekind != ExpK || t->kind.exp != CallK) return;
+  pl = getpl(t->attr.name);
+  if (pl == NULL || pl->treenode == f || isBuiltin(t->attr.name)
+      || t->attr.name == mainName)
+    return;
+  inlineCall(t, cs);
+}
+
+/* Procedure inlineCalls replaces calls to small leaf
+ * functions by a copy of their body, with parameters
+ * and locals mapped to fresh locals of the caller.
+ * Runs between typeCheck and foldConstants, which
+ * then folds the constant arguments into the body.
+ */
+void inlineCalls(TreeNode * syntaxTree)
+{ TreeNode * t;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind.decl == FuncK)
+      inlineTree(t->child[2], t, scope_lookup(t->attr.name));
+}
+
+/* Function isFunc returns TRUE if t declares a function */
+static int isFunc(TreeNode * t)
+{ return t->nodekind == DeclK && t->kind.decl == FuncK; }
+
+/* Procedure markCalls marks the functions called in
+ * t, and the functions they call, as reachable
+ */
+static void markCalls(TreeNode * t, char * reached, TreeNode * prog)
+{ TreeNode * c, * f;
+  int i, n;
+  if (t->nodekind == ExpK && t->kind.exp == CallK)
+    for (f = prog, n = 0; f != NULL; f = f->sibling, n++)
+      if (isFunc(f) && !reached[n] && f->attr.name == t->attr.name)
+      { reached[n] = TRUE;
+        markCalls(f->child[2], reached, prog);
+      }
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      markCalls(c, reached, prog);
+}
+
+/* Function isLocal returns TRUE if name refers to a
+ * local or parameter in the scope at the top of the
+ * scope stack
+ */
+static int isLocal(char * name)
+{ return st_lookup("temp", name) != -1
+      && cc->symtab.scope_name != globalName;
+}
+
+/* Function usesGlobal returns TRUE if t refers to the
+ * global variable name
+ */
+static int usesGlobal(TreeNode * t, char * name)
+{ TreeNode * c;
+  int i;
+  if (t->nodekind == ExpK && (t->kind.exp == IdK || t->kind.exp == ArrIdK)
+      && t->attr.name == name && !isLocal(name))
+    return TRUE;
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      if (usesGlobal(c, name)) return TRUE;
+  return FALSE;
+}
+
+/* Function isDeadAssign returns TRUE if t assigns to
+ * a scalar local of the current scope that body never
+ * reads
+ */
+static int isDeadAssign(TreeNode * t, TreeNode * body)
+{ char * name;
+  if (t == NULL || !isScalarAssign(t)) return FALSE;
+  name = t->child[0]->attr.name;
+  return isLocal(name) && substReads(body, name, FALSE, 0) == 0;
+}
+
+static TreeNode * pruneStmts(TreeNode * t, TreeNode * body);
+
+/* Procedure pruneStmt removes the dead statements in
+ * the statement lists below t
+ */
+static void pruneStmt(TreeNode * t, TreeNode * body)
+{ if (t->nodekind == StmtK)
+    switch (t->kind.stmt)
+    { case CompK:
+        t->child[1] = pruneStmts(t->child[1], body);
+        break;
+      case IfK:
+        t->child[1] = pruneStmts(t->child[1], body);
+        t->child[2] = pruneStmts(t->child[2], body);
+        break;
+      case IterK:
+        t->child[1] = pruneStmts(t->child[1], body);
+        break;
+      default:
+        break;
+    }
+  else if (t->nodekind == ExpK && t->kind.exp == InlineK)
+  { t->child[0] = pruneStmts(t->child[0], body);
+    pruneStmt(t->child[1], body);
+  }
+}
+
+/* Function pruneStmts drops from the statement list t
+ * the statements following a return and the dead
+ * assignments, keeping the right-hand side of those
+ * with side effects, and returns the new head
+ */
+static TreeNode * pruneStmts(TreeNode * t, TreeNode * body)
+{ TreeNode * head = NULL, * prev = NULL, * next, * r;
+  while (t != NULL)
+  { next = t->sibling;
+    r = t;
+    if (isDeadAssign(t, body))
+    { r = hasSideEffect(t->child[1]) ? t->child[1] : NULL;
+      changed = TRUE;
+    }
+    if (r != NULL)
+    { pruneStmt(r, body);
+      r->sibling = next;
+      if (prev == NULL) head = r;
+      else prev->sibling = r;
+      prev = r;
+      if (r->nodekind == StmtK && r->kind.stmt == RetK && next != NULL)
+      { r->sibling = NULL;
+        changed = TRUE;
+        break;
+      }
+    }
+    else if (prev != NULL)
+      prev->sibling = next;
+    t = next;
+  }
+  return head;
+}
+
+/* Function declName returns the name declared by t */
+static char * declName(TreeNode * t)
+{ return t->nodekind == DeclK && t->kind.decl == ArrVarK
+      ? t->attr.arr.name : t->attr.name;
+}
+
+/* Function removeDeadCode drops the functions that
+ * main never reaches through calls, the globals that
+ * no remaining function uses, the statements after a
+ * return and the assignments to locals never read.
+ * It returns the new head of the declaration list.
+ */
+TreeNode * removeDeadCode(TreeNode * syntaxTree)
+{ TreeNode * t, * f, * head = NULL, * prev = NULL;
+  char * reached;
+  int n = 0, j, k, used;
+  for (t = syntaxTree; t != NULL; t = t->sibling) n++;
+  reached = (char *) calloc(n, 1);
+  for (t = syntaxTree, k = 0; t != NULL; t = t->sibling, k++)
+    if (isFunc(t) && t->attr.name == mainName)
+    { reached[k] = TRUE;
+      markCalls(t->child[2], reached, syntaxTree);
+    }
+  /* without a main nothing runs; keep the program */
+  for (k = 0; k < n; k++)
+    if (reached[k]) break;
+  if (k == n) memset(reached, TRUE, n);
+  for (t = syntaxTree, k = 0; t != NULL; t = t->sibling, k++)
+    if (isFunc(t) && reached[k])
+    { push_scope(scope_lookup(t->attr.name));
+      do
+      { changed = FALSE;
+        pruneStmt(t->child[2], t->child[2]);
+      } while (changed);
+      pop_scope();
+    }
+  for (t = syntaxTree, k = 0; t != NULL; t = t->sibling, k++)
+  { if (isFunc(t)) used = reached[k];
+    else
+    { used = FALSE;
+      for (f = syntaxTree, j = 0; f != NULL && !used; f = f->sibling, j++)
+        if (isFunc(f) && reached[j])
+        { push_scope(scope_lookup(f->attr.name));
+          used = usesGlobal(f->child[2], declName(t));
+          pop_scope();
+        }
+    }
+    if (!used) continue;
+    if (prev == NULL) head = t;
+    else prev->sibling = t;
+    prev = t;
+  }
+  if (prev != NULL) prev->sibling = NULL;
+  free(reached);
+  return head;
+}
+
+/* Function newConst returns a constant node */
+static TreeNode * newConst(int val, int line)
+{ TreeNode * t = newExpNode(ConstK);
+  t->attr.val = val;
+  t->type = Integer;
+  t->lineno = line;
+  return t;
+}
+
+/* Function newVar returns a reference to the
+ * scalar name
+ */
+static TreeNode * newVar(char * name, int line)
+{ TreeNode * t = newExpNode(IdK);
+  t->attr.name = name;
+  t->type = Integer;
+  t->lineno = line;
+  return t;
+}
+
+/* Function newOp returns the node l op r */
+static TreeNode * newOp(TokenType op, TreeNode * l, TreeNode * r)
+{ TreeNode * t = newExpNode(OpK);
+  t->attr.op = op;
+  t->child[0] = l;
+  t->child[1] = r;
+  t->type = Integer;
+  t->lineno = l->lineno;
+  return t;
+}
+
+/* Function isInvariantExp returns TRUE if the value
+ * of t cannot change while body runs: t only reads
+ * constants and locals that body does not assign
+ */
+static int isInvariantExp(TreeNode * t, TreeNode * body)
+{ TreeNode * last;
+  if (t->nodekind != ExpK) return FALSE;
+  switch (t->kind.exp)
+  { case ConstK:
+      return TRUE;
+    case IdK:
+      return isLocal(t->attr.name)
+          && countAssigns(body, t->attr.name, &last) == 0;
+    case OpK:
+      return isInvariantExp(t->child[0], body)
+          && isInvariantExp(t->child[1], body);
+    default:
+      return FALSE;
+  }
+}
+
+/* Function countedLoop returns TRUE if the while
+ * statement w counts a scalar local up to a bound
+ * that does not change in the loop:
+ *   while (i < n) { ...; i = i + step; }
+ * with the test i <= n, n > i or n >= i as well and
+ * i assigned nowhere else. It sets *var to i, *bound
+ * to n, *op to LT or LE and *step, and *last to the
+ * statement before the increment, NULL if none.
+ */
+static int countedLoop(TreeNode * w, char ** var, TreeNode ** bound,
+                       TokenType * op, int * step, TreeNode ** last)
+{ TreeNode * test = w->child[0], * body = w->child[1];
+  TreeNode * s, * inc, * rhs, * found;
+  if (test->nodekind != ExpK || test->kind.exp != OpK) return FALSE;
+  if ((test->attr.op == LT || test->attr.op == LE)
+      && test->child[0]->kind.exp == IdK)
+  { *var = test->child[0]->attr.name;
+    *bound = test->child[1];
+    *op = test->attr.op;
+  }
+  else if ((test->attr.op == GT || test->attr.op == GE)
+           && test->child[1]->kind.exp == IdK)
+  { *var = test->child[1]->attr.name;
+    *bound = test->child[0];
+    *op = test->attr.op == GT ? LT : LE;
+  }
+  else return FALSE;
+  if (body == NULL || body->nodekind != StmtK || body->kind.stmt != CompK
+      || body->child[1] == NULL)
+    return FALSE;
+  *last = NULL;
+  for (inc = body->child[1]; inc->sibling != NULL; inc = inc->sibling)
+    *last = inc;
+  if (!isScalarAssign(inc) || !isVarRef(inc->child[0], *var)) return FALSE;
+  rhs = inc->child[1];
+  if (rhs->nodekind != ExpK || rhs->kind.exp != OpK || rhs->attr.op != PLUS)
+    return FALSE;
+  if (isVarRef(rhs->child[0], *var) && isConst(rhs->child[1]))
+    *step = rhs->child[1]->attr.val;
+  else if (isVarRef(rhs->child[1], *var) && isConst(rhs->child[0]))
+    *step = rhs->child[0]->attr.val;
+  else return FALSE;
+  if (*step <= 0 || !isLocal(*var)) return FALSE;
+  for (s = body->child[1]; s != inc; s = s->sibling)
+    if (countAssigns(s, *var, &found) > 0) return FALSE;
+  return isInvariantExp(*bound, body);
+}
+
+/* Function copyBody returns copies of the statements
+ * from first up to and including last, with the local
+ * declarations dropped: they are in the scope of the
+ * function already. When subst is TRUE the reads of
+ * var become the constant val. tail is set to the
+ * last statement of the copy.
+ */
+static TreeNode * copyBody(TreeNode * first, TreeNode * last, char * var,
+                           int subst, int val, TreeNode ** tail)
+{ TreeNode * head, * t, * end = last->sibling;
+  Rename none;
+  last->sibling = NULL;
+  head = copyTree(first);
+  last->sibling = end;
+  for (t = head; t != NULL; t = t->sibling)
+  { renameTree(t, &none, 0);
+    if (subst) substReads(t, var, TRUE, val);
+    *tail = t;
+  }
+  return head;
+}
+
+/* Function unrollLoop rewrites while statement w,
+ * which follows statement prev in its list, if it is
+ * a counted loop. A loop whose trip count is known
+ * and small is replaced by as many copies of its body
+ * with the counter turned into constants. Otherwise
+ * a loop running factor copies of the body, each
+ * with its increment, while factor iterations remain
+ * is put in front of w, which is left to run the
+ * rest. TM compares by subtracting, so that loop is
+ * entered only if i < n: its test, with ahead the
+ * (factor-1)*step the copies look ahead, is
+ * i < n - ahead for a constant n far enough from the
+ * least int and i - n < -ahead otherwise. Either adds
+ * ahead to the i - n the test of w computes, at most
+ * step there, and cannot overflow. The increments
+ * are kept rather than reading the counter as
+ * i + step, i + 2*step, ...: those values would
+ * compete for the two variable registers. It returns
+ * the statement that replaces w, or w itself.
+ */
+static TreeNode * unrollLoop(TreeNode * w, TreeNode * prev, int factor,
+                             int * full)
+{ TreeNode * body = w->child[1], * bound, * last, * head = NULL;
+  TreeNode * tail = NULL, * copy, * end, * loop, * enter;
+  TokenType op;
+  char * var;
+  int step, size, init, trips, k, ahead;
+  long runs = profileCount("body", w->lineno, NULL);
+  long entries = profileEntries(w->lineno);
+  if (!countedLoop(w, &var, &bound, &op, &step, &last)) return w;
+  size = countNodes(body);
+  /* a loop the profile never ran is left alone */
+  if (size > UNROLL_SIZE || runs == 0) return w;
+  if (prev != NULL && isScalarAssign(prev) && isVarRef(prev->child[0], var)
+      && isConst(prev->child[1]) && isConst(bound))
+  { init = prev->child[1]->attr.val;
+    trips = 0;
+    if (op == LT && init < bound->attr.val)
+      trips = (int) (((long) bound->attr.val - init + step - 1) / step);
+    else if (op == LE && init <= bound->attr.val)
+      trips = (int) (((long) bound->attr.val - init) / step + 1);
+    if ((long) trips * size <= UNROLL_FULL
+        && cc->opt.unrollGrowth + (trips - 1) * size <= cc->opt.unrollBudget)
+    { cc->opt.unrollGrowth += (trips - 1) * size;
+      for (k = 0; k < trips && last != NULL; k++)
+      { copy = copyBody(body->child[1], last, var, TRUE,
+                        init + k * step, &end);
+        if (head == NULL) head = copy;
+        else tail->sibling = copy;
+        tail = end;
+      }
+      /* the counter ends as the loop would leave it */
+      copy = newExpNode(AssignK);
+      copy->type = Integer;
+      copy->lineno = w->lineno;
+      copy->child[0] = newVar(var, w->lineno);
+      copy->child[1] = newConst(init + trips * step, w->lineno);
+      if (head == NULL) head = copy;
+      else tail->sibling = copy;
+      copy->sibling = w->sibling;
+      *full = TRUE;
+      changed = TRUE;
+      return head;
+    }
+  }
+  if (factor < 2 || last == NULL || size * factor > UNROLL_FULL
+      || (long) factor * step > INT_MAX
+      || cc->opt.unrollGrowth + size * factor > cc->opt.unrollBudget)
+    return w;
+  ahead = (factor - 1) * step;
+  /* nor is one that ran fewer than factor trips at
+     a time, which the remainder loop would run */
+  if (runs > 0 && entries > 0 && runs < factor * entries) return w;
+  cc->opt.unrollGrowth += size * factor;
+  for (k = 0; k < factor; k++)
+  { copy = copyBody(body->child[1], last->sibling, var, FALSE, 0, &end);
+    if (head == NULL) head = copy;
+    else tail->sibling = copy;
+    tail = end;
+  }
+  loop = newStmtNode(IterK);
+  loop->lineno = w->lineno;
+  loop->child[1] = newStmtNode(CompK);
+  loop->child[1]->lineno = w->lineno;
+  loop->child[1]->child[1] = head;
+  if (isConst(bound) && (long) bound->attr.val - ahead >= INT_MIN)
+    loop->child[0] = newOp(op, newVar(var, w->lineno),
+                           newConst(bound->attr.val - ahead, w->lineno));
+  else
+    loop->child[0] = newOp(op, newOp(MINUS, newVar(var, w->lineno),
+                                     copyTree(bound)),
+                           newConst(-ahead, w->lineno));
+  enter = newStmtNode(IfK);
+  enter->lineno = w->lineno;
+  enter->child[0] = newOp(op, newVar(var, w->lineno), copyTree(bound));
+  enter->child[1] = loop;
+  enter->sibling = w;
+  changed = TRUE;
+  return enter;
+}
+
+static TreeNode * unrollStmts(TreeNode * t, int factor, int * full);
+
+/* Procedure unrollStmt unrolls the loops in the
+ * statement lists below t, inner loops first
+ */
+static void unrollStmt(TreeNode * t, int factor, int * full)
+{ if (t->nodekind == StmtK)
+    switch (t->kind.stmt)
+    { case CompK:
+        t->child[1] = unrollStmts(t->child[1], factor, full);
+        break;
+      case IfK:
+        t->child[1] = unrollStmts(t->child[1], factor, full);
+        t->child[2] = unrollStmts(t->child[2], factor, full);
+        break;
+      case IterK:
+        unrollStmt(t->child[1], factor, full);
+        break;
+      default:
+        break;
+    }
+  else if (t->nodekind == ExpK && t->kind.exp == InlineK)
+    unrollStmt(t->child[1], factor, full);
+}
+
+/* Function unrollStmts unrolls the counted loops of
+ * the statement list t and returns its new head
+ */
+static TreeNode * unrollStmts(TreeNode * t, int factor, int * full)
+{ TreeNode * head = t, * prev = NULL, * r, * next;
+  for (; t != NULL; t = next)
+  { next = t->sibling;
+    unrollStmt(t, factor, full);
+    r = t;
+    if (t->nodekind == StmtK && t->kind.stmt == IterK)
+      r = unrollLoop(t, prev, factor, full);
+    if (prev == NULL) head = r;
+    else prev->sibling = r;
+    if (r != t)
+      for (prev = r; prev->sibling != next; prev = prev->sibling) ;
+    else prev = t;
+  }
+  return head;
+}
+
+/* Procedure unrollLoops unrolls the counted loops
+ * of each function by factor, and completely those
+ * whose trip count is known and small, while the
+ * copies stay within UNROLL_BUDGET and the code the
+ * instruction memory of TM; a loop fully unrolled is
+ * folded again.
+ */
+void unrollLoops(TreeNode * syntaxTree, int factor)
+{ TreeNode * t;
+  int full = FALSE;
+  changed = FALSE;
+  cc->opt.unrollBudget = growthBudget(programSize(syntaxTree), UNROLL_BUDGET);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (isFunc(t))
+    { push_scope(scope_lookup(t->attr.name));
+      unrollStmt(t->child[2], factor, &full);
+      pop_scope();
+    }
+  if (full) foldConstants(syntaxTree);
+}
+
+/* a call to a function declared in the program and
+ * the function making it
+ */
+typedef struct
+{ TreeNode * call;
+  TreeNode * caller;
+} CallSite;
+
+static __thread CallSite * sites = NULL;
+static __thread int siteCount = 0;
+static __thread int siteMax = 0;
+
+/* a specialized copy of function orig: the scalar
+ * parameters where fixed is set always get val; the
+ * copies of the program, MAXCLONES at most, are
+ * kept in cc->opt.clones
+ */
+typedef struct CloneRec
+{ TreeNode * orig;
+  TreeNode * clone;
+  char fixed[MAXRENAME];
+  int val[MAXRENAME];
+} Clone;
+
+/* Procedure collectCalls adds the calls in t, a part
+ * of function caller, to sites
+ */
+static void collectCalls(TreeNode * t, TreeNode * caller)
+{ TreeNode * c;
+  FuncParam pl;
+  int i;
+  if (t->nodekind == ExpK && t->kind.exp == CallK && !isBuiltin(t->attr.name)
+      && (pl = getpl(t->attr.name)) != NULL && pl->treenode != NULL)
+  { if (siteCount == siteMax)
+    { siteMax = siteMax ? 2*siteMax : 64;
+      sites = (CallSite *) realloc(sites, siteMax * sizeof(CallSite));
+    }
+    sites[siteCount].call = t;
+    sites[siteCount].caller = caller;
+    siteCount++;
+  }
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      collectCalls(c, caller);
+}
+
+/* Function isFixable returns TRUE if parameter p of
+ * function f can be replaced by a constant: it is a
+ * scalar that the body reads and never assigns
+ */
+static int isFixable(TreeNode * f, TreeNode * p)
+{ TreeNode * last;
+  return p->kind.param == NonArrParamK
+      && countAssigns(f->child[2], p->attr.name, &last) == 0
+      && substReads(f->child[2], p->attr.name, FALSE, 0) > 0;
+}
+
+/* Function passesOn returns TRUE if call is a call
+ * of f from f itself that passes parameter p, the
+ * kth, on unchanged
+ */
+static int passesOn(TreeNode * call, TreeNode * caller, TreeNode * f,
+                    TreeNode * p, int k)
+{ TreeNode * arg = call->child[0];
+  if (caller != f) return FALSE;
+  for (; arg != NULL && k > 0; k--) arg = arg->sibling;
+  return isVarRef(arg, p->attr.name);
+}
+
+/* Function keepsParam returns TRUE if every call of
+ * f from t, a part of f, passes its kth parameter p
+ * on unchanged
+ */
+static int keepsParam(TreeNode * t, TreeNode * f, TreeNode * p, int k)
+{ TreeNode * c;
+  int i;
+  if (t->nodekind == ExpK && t->kind.exp == CallK
+      && t->attr.name == f->attr.name
+      && !passesOn(t, f, f, p, k))
+    return FALSE;
+  for (i=0; i < MAXCHILDREN; i++)
+    for (c = t->child[i]; c != NULL; c = c->sibling)
+      if (!keepsParam(c, f, p, k)) return FALSE;
+  return TRUE;
+}
+
+/* Function constArgs sets fixed and val for the
+ * fixable parameters of f that call passes a
+ * constant, and returns how many there are. A
+ * parameter that f changes in calls to itself is
+ * left alone: fixing it would only peel off the
+ * outermost call of the recursion.
+ */
+static int constArgs(TreeNode * call, TreeNode * f, char * fixed, int * val)
+{ TreeNode * p, * arg = call->child[0];
+  int k, n = 0;
+  for (p = f->child[1], k = 0; p != NULL && p->nodekind == ParamK
+       && k < MAXRENAME; p = p->sibling, k++)
+  { fixed[k] = arg != NULL && isConst(arg) && isFixable(f, p)
+               && keepsParam(f->child[2], f, p, k);
+    if (fixed[k])
+    { val[k] = arg->attr.val;
+      n++;
+    }
+    if (arg != NULL) arg = arg->sibling;
+  }
+  for (; k < MAXRENAME; k++) fixed[k] = FALSE;
+  return n;
+}
+
+/* Procedure fixParams replaces the reads of the
+ * parameters of f selected by fixed by their value
+ */
+static void fixParams(TreeNode * f, char * fixed, int * val)
+{ TreeNode * p;
+  int k;
+  for (p = f->child[1], k = 0; p != NULL && p->nodekind == ParamK
+       && k < MAXRENAME; p = p->sibling, k++)
+    if (fixed[k]) substReads(f->child[2], p->attr.name, TRUE, val[k]);
+}
+
+/* Function foldGain returns how many nodes the body
+ * of f loses to folding once the parameters selected
+ * by fixed are replaced by their value
+ */
+static int foldGain(TreeNode * f, char * fixed, int * val)
+{ TreeNode copy = *f;
+  int saved = changed;
+  copy.child[2] = copyTree(f->child[2]);
+  fixParams(&copy, fixed, val);
+  do
+  { changed = FALSE;
+    foldStmt(copy.child[2]);
+  } while (changed);
+  changed = saved;
+  return countNodes(f->child[2]) - countNodes(copy.child[2]);
+}
+
+/* Function cloneFunc adds after f a copy of it named
+ * name, with its own scope and function record, and
+ * the parameters selected by fixed replaced by val
+ */
+static TreeNode * cloneFunc(TreeNode * f, char * name, char * fixed, int * val)
+{ TreeNode * c, * next = f->sibling;
+  ScopeList from = scope_lookup(f->attr.name), to;
+  FuncParam pl;
+  f->sibling = NULL;
+  c = copyTree(f);
+  f->sibling = next;
+  c->attr.name = name;
+  c->sibling = next;
+  f->sibling = c;
+  fixParams(c, fixed, val);
+  to = createscope(name);
+  st_copy(from, to);
+  to->parent = from->parent;
+  to->paramNum = from->paramNum;
+  to->varNum = from->varNum;
+  to->frameSize = from->frameSize;
+  pl = createpl(name, c);
+  pl->paramNum = getpl(f->attr.name)->paramNum;
+  push_pl(pl);
+  return c;
+}
+
+/* Procedure propagateArgs replaces a fixable
+ * parameter by a constant when every call of its
+ * function passes that constant, or passes it on
+ * from a call of itself
+ */
+static void propagateArgs(TreeNode * prog)
+{ TreeNode * f, * p, * arg;
+  int j, k, m, have, val;
+  for (f = prog; f != NULL; f = f->sibling)
+  { if (!isFunc(f)) continue;
+    for (p = f->child[1], k = 0; p != NULL && p->nodekind == ParamK;
+         p = p->sibling, k++)
+    { if (!isFixable(f, p)) continue;
+      have = FALSE;
+      for (j = 0; j < siteCount; j++)
+      { if (sites[j].call->attr.name != f->attr.name
+            || passesOn(sites[j].call, sites[j].caller, f, p, k))
+          continue;
+        for (arg = sites[j].call->child[0], m = 0; arg != NULL && m < k; m++)
+          arg = arg->sibling;
+        if (arg == NULL || !isConst(arg)
+            || (have && arg->attr.val != val))
+          break;
+        have = TRUE;
+        val = arg->attr.val;
+      }
+      if (j == siteCount && have)
+      { substReads(f->child[2], p->attr.name, TRUE, val);
+        changed = TRUE;
+      }
+    }
+  }
+}
+
+/* Procedure specializeSite sends call site s to a
+ * copy of its callee with its constant arguments
+ * folded in, made if none fits yet and the copy
+ * folds better than the original
+ */
+static void specializeSite(CallSite * s)
+{ TreeNode * f = getpl(s->call->attr.name)->treenode;
+  char fixed[MAXRENAME];
+  int val[MAXRENAME];
+  char buffer[256];
+  int j, k, size;
+  if (constArgs(s->call, f, fixed, val) == 0) return;
+  for (j = 0; j < cc->opt.cloneCount; j++)
+  { if (cc->opt.clones[j].orig != f) continue;
+    for (k = 0; k < MAXRENAME; k++)
+      if (cc->opt.clones[j].fixed[k] != fixed[k]
+          || (fixed[k] && cc->opt.clones[j].val[k] != val[k]))
+        break;
+    if (k == MAXRENAME) break;
+  }
+  if (j == cc->opt.cloneCount)
+  { if (cc->opt.clones == NULL)
+      cc->opt.clones = (Clone *) calloc(MAXCLONES, sizeof(Clone));
+    size = countNodes(f->child[2]);
+    if (cc->opt.cloneCount == MAXCLONES || size > SPECIALIZE_SIZE
+        || cc->opt.specializeGrowth + size > cc->opt.specializeBudget
+        || foldGain(f, fixed, val) <= 0)
+      return;
+    sprintf(buffer, "%s.spec.%d", f->attr.name, cc->opt.cloneCount + 1);
+    cc->opt.clones[j].orig = f;
+    memcpy(cc->opt.clones[j].fixed, fixed, sizeof(fixed));
+    memcpy(cc->opt.clones[j].val, val, sizeof(val));
+    cc->opt.clones[j].clone = cloneFunc(f, internString(buffer), fixed, val);
+    cc->opt.cloneCount++;
+    cc->opt.specializeGrowth += size;
+  }
+  s->call->attr.name = cc->opt.clones[j].clone->attr.name;
+  changed = TRUE;
+}
+
+/* Procedure specializeCalls propagates constant
+ * arguments across calls. A parameter that every
+ * call sets to the same constant becomes that
+ * constant; a call passing constants that others do
+ * not goes to a copy of the callee specialized for
+ * them, when the constants let more of it fold and
+ * the copies stay within SPECIALIZE_GROWTH percent of
+ * the program and its code within the instruction
+ * memory of TM. Folding runs after each round, which
+ * may make more arguments constant, until nothing
+ * changes.
+ */
+void specializeCalls(TreeNode * syntaxTree)
+{ TreeNode * t;
+  int j, round = 0, size = programSize(syntaxTree);
+  cc->opt.specializeBudget =
+    growthBudget(size, (int) ((long) size * SPECIALIZE_GROWTH / 100));
+  do
+  { changed = FALSE;
+    siteCount = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+      if (isFunc(t)) collectCalls(t->child[2], t);
+    propagateArgs(syntaxTree);
+    for (j = 0; j < siteCount; j++)
+      specializeSite(&sites[j]);
+    if (changed) foldConstants(syntaxTree);
+  } while (changed && ++round < 4);
+}
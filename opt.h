@@ -0,0 +1,54 @@
+/****************************************************/
+/* File: opt.h                                      */
+/* Syntax tree optimizer interface                  */
+/* for the C-minus compiler                         */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _OPT_H_
+#define _OPT_H_
+
+/* Procedure foldConstants folds constant operator
+ * nodes, propagates the values of locals that are
+ * assigned a constant exactly once, and prunes
+ * if/while statements whose test is constant.
+ * Runs between typeCheck and codeGen.
+ */
+void foldConstants(TreeNode * syntaxTree);
+
+/* Procedure inlineCalls replaces calls to small leaf
+ * functions by a copy of their body, with parameters
+ * and locals mapped to fresh locals of the caller;
+ * with a profile, calls it shows made often may
+ * bring larger bodies and calls never made none
+ */
+void inlineCalls(TreeNode * syntaxTree);
+
+/* Function removeDeadCode drops the functions that
+ * main never reaches through calls, the globals no
+ * remaining function uses, statements following a
+ * return and assignments to locals that are never
+ * read; it returns the new head of the program
+ */
+TreeNode * removeDeadCode(TreeNode * syntaxTree);
+
+/* Procedure specializeCalls replaces parameters
+ * that every call sets to the same constant by that
+ * constant, and sends calls with other constant
+ * arguments to copies of the callee specialized for
+ * them when that lets more of it fold
+ */
+void specializeCalls(TreeNode * syntaxTree);
+
+/* Procedure unrollLoops unrolls by factor the while
+ * loops that step a local counter towards a bound
+ * fixed in the loop, leaving the original loop for
+ * the remaining iterations; loops with a small
+ * known trip count are unrolled completely. With a
+ * profile, loops that never ran or averaged fewer
+ * than factor trips are left alone.
+ */
+void unrollLoops(TreeNode * syntaxTree, int factor);
+
+#endif
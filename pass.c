@@ -0,0 +1,413 @@
+/****************************************************/
+/* File: pass.c                                     */
+/* Pass manager for the C-minus compiler: keeps the */
+/* optimization passes in order, decides which run  */
+/* at each -O level and reports what each one did   */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <time.h>
+#include "globals.h"
+#include "symtab.h"
+#include "code.h"
+#include "opt.h"
+#include "cgen.h"
+#include "ir.h"
+#include "iropt.h"
+#include "profile.h"
+#include "pass.h"
+#include "incr.h"
+#include "context.h"
+
+/* MAXPASSES bounds the passes that can be registered */
+#define MAXPASSES 32
+
+/* enabled of a pass that follows the -O level */
+#define BYLEVEL (-1)
+
+typedef struct PassRec
+{ char * name;
+  PassStage stage;
+  int level;       /* lowest -O level that runs it */
+  PassFn run;
+  int enabled;     /* TRUE, FALSE or BYLEVEL */
+  int order;       /* runs before the passes of higher order */
+} Pass;
+
+/* Row is a line of the report: a pass, or one of the
+ * code generators with its time only
+ */
+typedef struct RowRec
+{ char * name;
+  PassStage stage;
+  double ms;
+  int before, after;      /* program size, -1 if not measured */
+  long dynBefore, dynAfter;
+} Row;
+
+/* The passes, unrollFactor, the iterations per trip
+ * of a loop unrolled partially, and the rows of the
+ * report are kept in cc->pass; passes holds MAXPASSES
+ * and rows MAXPASSES + 2
+ */
+
+static char * stageName[] = { "tree", "ir", "tm" };
+
+/* Procedure registerPass adds a pass after those
+ * already registered for its stage
+ */
+void registerPass(char * name, PassStage stage, int level, PassFn run)
+{ Pass * p;
+  if (cc->pass.npass == MAXPASSES)
+  { fprintf(stderr,"too many passes\n");
+    exit(1);
+  }
+  p = &cc->pass.passes[cc->pass.npass];
+  p->name = name;
+  p->stage = stage;
+  p->level = level;
+  p->run = run;
+  p->enabled = BYLEVEL;
+  p->order = cc->pass.npass++;
+}
+
+/**************************************************/
+/***********   The passes                 *********/
+/**************************************************/
+
+static void runInline(Program * p)
+{ inlineCalls(p->tree); }
+
+static void runFold(Program * p)
+{ foldConstants(p->tree); }
+
+static void runSpecialize(Program * p)
+{ specializeCalls(p->tree); }
+
+static void runUnroll(Program * p)
+{ unrollLoops(p->tree, cc->pass.unrollFactor); }
+
+static void runDeadCode(Program * p)
+{ p->tree = removeDeadCode(p->tree); }
+
+/* the IR passes skip the functions whose code was
+ * kept by -incremental */
+
+static void runCommon(Program * p)
+{ IrFunc f;
+  for (f = p->ir; f != NULL; f = f->next)
+    if (f->kept == NULL) eliminateCommon(f, p->ir);
+}
+
+static void runHoist(Program * p)
+{ IrFunc f;
+  for (f = p->ir; f != NULL; f = f->next)
+    if (f->kept == NULL) hoistInvariants(f, p->ir);
+}
+
+static void runInductions(Program * p)
+{ IrFunc f;
+  for (f = p->ir; f != NULL; f = f->next)
+    if (f->kept == NULL) reduceInductions(f);
+}
+
+static void runPeephole(Program * p)
+{ peephole(); }
+
+/* Procedure initPasses registers the passes of the
+ * compiler, in the order they run, the first time
+ * it is called
+ */
+static void initPasses(void)
+{ if (cc->pass.npass > 0) return;
+  cc->pass.passes = (Pass *) calloc(MAXPASSES, sizeof(Pass));
+  cc->pass.rows = (Row *) calloc(MAXPASSES + 2, sizeof(Row));
+  if (cc->pass.passes == NULL || cc->pass.rows == NULL)
+  { fprintf(stderr,"Out of memory error registering passes\n");
+    exit(1);
+  }
+  registerPass("inline", TreeStage, 1, runInline);
+  registerPass("fold", TreeStage, 1, runFold);
+  registerPass("ipcp", TreeStage, 2, runSpecialize);
+  registerPass("unroll", TreeStage, 2, runUnroll);
+  registerPass("dce", TreeStage, 1, runDeadCode);
+  registerPass("cse", IrStage, 1, runCommon);
+  registerPass("licm", IrStage, 1, runHoist);
+  registerPass("iv", IrStage, 1, runInductions);
+  registerPass("peephole", TmStage, 2, runPeephole);
+}
+
+/**************************************************/
+/***********   Options                    *********/
+/**************************************************/
+
+/* Function findPass returns the pass called name,
+ * or exits if there is none
+ */
+static Pass * findPass(char * name, int len)
+{ int k;
+  for (k = 0; k < cc->pass.npass; k++)
+    if (strncmp(cc->pass.passes[k].name, name, len) == 0
+        && cc->pass.passes[k].name[len] == '\0')
+      return &cc->pass.passes[k];
+  fprintf(stderr,"unknown pass %.*s\n",len,name);
+  exit(1);
+  return NULL;
+}
+
+/* Function passOption handles the command line
+ * options of the pass manager
+ */
+int passOption(char * arg)
+{ Pass * p;
+  char * s;
+  int k, len;
+  initPasses();
+  if (strcmp(arg, "-time-passes") == 0)
+    cc->TimePasses = TRUE;
+  else if (strcmp(arg, "-debug-map") == 0)
+    cc->DebugMap = TRUE;
+  else if (strncmp(arg, "-profile-use=", 13) == 0)
+  { if (!loadProfile(arg + 13))
+    { fprintf(stderr,"cannot read profile %s.map, %s.prof\n",
+              arg + 13, arg + 13);
+      exit(1);
+    }
+  }
+  else if (strncmp(arg, "-unroll-factor=", 15) == 0)
+    cc->pass.unrollFactor = atoi(arg + 15);
+  else if (strncmp(arg, "-passes=", 8) == 0)
+  { for (k = 0; k < cc->pass.npass; k++) cc->pass.passes[k].enabled = FALSE;
+    for (s = arg + 8, k = 0; *s != '\0'; s += len + (s[len] == ','))
+    { len = strcspn(s, ",");
+      p = findPass(s, len);
+      p->enabled = TRUE;
+      p->order = k++;
+    }
+  }
+  else if (strncmp(arg, "-fno-", 5) == 0)
+    findPass(arg + 5, strlen(arg + 5))->enabled = FALSE;
+  else if (strncmp(arg, "-f", 2) == 0)
+    findPass(arg + 2, strlen(arg + 2))->enabled = TRUE;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+/* Function isEnabled returns TRUE if p runs */
+static int isEnabled(Pass * p)
+{ if (p->enabled == BYLEVEL) return cc->OptLevel >= p->level;
+  return p->enabled;
+}
+
+/**************************************************/
+/***********   Running and reporting      *********/
+/**************************************************/
+
+/* Function countTree returns the number of statement
+ * and expression nodes in the tree t and adds to
+ * *dynamic that number weighted by 10 for each loop
+ * around a node, up to 4
+ */
+static int countTree(TreeNode * t, int depth, long * dynamic)
+{ int count = 0, k;
+  long w;
+  for (; t != NULL; t = t->sibling)
+  { if (t->nodekind == StmtK || t->nodekind == ExpK)
+    { for (k = 0, w = 1; k < depth && k < 4; k++) w *= 10;
+      count++;
+      *dynamic += w;
+    }
+    for (k = 0; k < MAXCHILDREN; k++)
+      count += countTree(t->child[k], depth +
+                 (t->nodekind == StmtK && t->kind.stmt == IterK), dynamic);
+  }
+  return count;
+}
+
+/* Function measure returns the size of the program
+ * p in the form stage works on, and its estimated
+ * dynamic size in *dynamic
+ */
+static int measure(Program * p, PassStage stage, long * dynamic)
+{ *dynamic = 0;
+  switch (stage)
+  { case TreeStage: return countTree(p->tree, 0, dynamic);
+    case IrStage: return countIr(p->ir, dynamic);
+    default: return emitCount(dynamic);
+  }
+}
+
+/* Function now returns the CPU time of the calling
+ * thread in ms: clock() would count the time of all
+ * the workers of a batch
+ */
+static double now(void)
+{ struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* Function elapsed returns the milliseconds since
+ * start
+ */
+static double elapsed(double start)
+{ return now() - start; }
+
+/* Procedure addRow adds a generator to the report */
+static void addRow(char * name, PassStage stage, double start)
+{ Row * r = &cc->pass.rows[cc->pass.nrow++];
+  r->name = name;
+  r->stage = stage;
+  r->ms = elapsed(start);
+  r->before = r->after = -1;
+}
+
+/* Procedure runStage runs the enabled passes of
+ * stage over p in order, measuring each if the
+ * report is on
+ */
+static void runStage(Program * p, PassStage stage)
+{ Pass * order[MAXPASSES];
+  Row * r;
+  double start;
+  int k, m, n = 0;
+  for (k = 0; k < cc->pass.npass; k++)
+    if (cc->pass.passes[k].stage == stage && isEnabled(&cc->pass.passes[k]))
+    { for (m = n++; m > 0 && order[m-1]->order > cc->pass.passes[k].order; m--)
+        order[m] = order[m-1];
+      order[m] = &cc->pass.passes[k];
+    }
+  for (k = 0; k < n && !cc->Error; k++)
+  { if (cc->TraceAnalyze)
+      fprintf(cc->listing,"\nRunning pass %s...\n",order[k]->name);
+    if (!cc->TimePasses)
+    { order[k]->run(p);
+      continue;
+    }
+    r = &cc->pass.rows[cc->pass.nrow++];
+    r->name = order[k]->name;
+    r->stage = stage;
+    r->before = measure(p, stage, &r->dynBefore);
+    start = now();
+    order[k]->run(p);
+    r->ms = elapsed(start);
+    r->after = measure(p, stage, &r->dynAfter);
+  }
+}
+
+/* Function anyEnabled returns TRUE if some pass of
+ * stage runs
+ */
+static int anyEnabled(PassStage stage)
+{ int k;
+  for (k = 0; k < cc->pass.npass; k++)
+    if (cc->pass.passes[k].stage == stage && isEnabled(&cc->pass.passes[k])) return TRUE;
+  return FALSE;
+}
+
+/* Function usesIr returns TRUE if the code is
+ * generated through the IR: above -O0, or at -O0
+ * when -passes or -f enables an IR pass, which the
+ * tree code generator would leave out
+ */
+int usesIr(void)
+{ initPasses();
+  return cc->OptLevel > 0 || anyEnabled(IrStage);
+}
+
+/* Procedure report prints the measures of the passes
+ * and generators that ran to the listing. Sizes are
+ * syntax tree nodes, IR or TM instructions as fits
+ * the stage; the estimated run counts each once, 10
+ * times in a loop, 100 times in two and so on.
+ */
+static void report(void)
+{ Row * r;
+  double total = 0;
+  int k;
+  fprintf(cc->listing,"\nPass report (-O%d):\n",cc->OptLevel);
+  fprintf(cc->listing,"%-10s %-5s %9s %7s %7s %10s %10s %10s\n","pass",
+          "stage","ms","size","after","est. run","after","saved");
+  for (k = 0; k < cc->pass.nrow; k++)
+  { r = &cc->pass.rows[k];
+    total += r->ms;
+    fprintf(cc->listing,"%-10s %-5s %9.3f",r->name,stageName[r->stage],r->ms);
+    if (r->before >= 0)
+      fprintf(cc->listing," %7d %7d %10ld %10ld %10ld",r->before,r->after,
+              r->dynBefore,r->dynAfter,r->dynBefore-r->dynAfter);
+    fprintf(cc->listing,"\n");
+  }
+  fprintf(cc->listing,"%-10s %-5s %9.3f\n","total","",total);
+}
+
+/* Procedure writeMap writes the debug map of the
+ * code file codefile next to it, as <program>.map
+ */
+static void writeMap(char * codefile)
+{ char * mapfile = (char *) malloc(strlen(codefile) + 5);
+  char * dot;
+  strcpy(mapfile, codefile);
+  dot = strrchr(mapfile, '.');
+  if (dot != NULL) *dot = '\0';
+  strcat(mapfile, ".map");
+  emitMap(mapfile);
+  free(mapfile);
+}
+
+/* Function settingsKey returns the hash of the
+ * options that the code of a function depends on
+ * besides its tree, for -incremental
+ */
+static FuncKey settingsKey(void)
+{ FuncKey h = mixKey(0, cc->OptLevel);
+  int k;
+  h = mixKey(h, cc->pass.unrollFactor);
+  h = mixKey(h, cc->TraceCode);
+  h = mixKey(h, cc->DebugMap);
+  for (k = 0; k < cc->pass.npass; k++)
+    if (isEnabled(&cc->pass.passes[k]))
+      h = mixKey(mixKey(h, k), cc->pass.passes[k].order);
+  return h;
+}
+
+/* Procedure runPasses runs the enabled passes over
+ * the checked syntax tree and generates its code;
+ * with -incremental the code is buffered, so that
+ * the code of each function can be kept
+ */
+void runPasses(TreeNode * syntaxTree, char * codefile)
+{ Program p;
+  double start;
+  p.tree = syntaxTree;
+  p.ir = NULL;
+  initPasses();
+  cc->pass.nrow = 0;
+  runStage(&p, TreeStage);
+  if (cc->Error) return;
+  if (anyEnabled(TmStage) || cc->Incremental) emitBuffer();
+  if (cc->Incremental) beginCodes(p.tree, settingsKey());
+  if (!usesIr())
+  { start = now();
+    codeGen(p.tree, codefile);
+    addRow("codegen", TreeStage, start);
+  }
+  else
+  { start = now();
+    p.ir = buildIr(p.tree);
+    findStores(p.ir);
+    if (cc->Incremental) checkKept(p.ir);
+    addRow("buildir", IrStage, start);
+    runStage(&p, IrStage);
+    if (cc->TraceIR) printIr(p.ir);
+    start = now();
+    irCodeGen(p.ir, codefile);
+    addRow("irgen", IrStage, start);
+  }
+  if (cc->Incremental) keepCode();
+  runStage(&p, TmStage);
+  emitFlush();
+  if (cc->DebugMap) writeMap(codefile);
+  if (cc->TimePasses) report();
+}
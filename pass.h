@@ -0,0 +1,64 @@
+/****************************************************/
+/* File: pass.h                                     */
+/* Pass manager interface for the C-minus compiler  */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _PASS_H_
+#define _PASS_H_
+
+#include "ir.h"
+
+/* the form of the program a pass works on */
+typedef enum { TreeStage, IrStage, TmStage } PassStage;
+
+/* Program holds the syntax tree, and the IR once it
+ * is built; the TM code is kept by the emitting
+ * utilities while a TmStage pass is enabled
+ */
+typedef struct
+{ TreeNode * tree;
+  IrFunc ir;
+} Program;
+
+typedef void (* PassFn)(Program * p);
+
+/* Procedure registerPass adds a pass after those
+ * already registered for its stage; it runs from
+ * optimization level level on unless enabled or
+ * disabled by passOption
+ */
+void registerPass(char * name, PassStage stage, int level, PassFn run);
+
+/* Function passOption handles the command line
+ * options of the pass manager and returns FALSE if
+ * arg is none of them:
+ *   -fNAME, -fno-NAME  enable or disable pass NAME
+ *   -passes=A,B,...    run exactly these passes, in
+ *                      this order within each stage
+ *   -time-passes       report each pass when done
+ *   -unroll-factor=N   iterations per trip of a loop
+ *                      unrolled partially, 1 for none
+ *   -debug-map         write the debug map <program>.map
+ *   -profile-use=NAME  guide inlining, unrolling and
+ *                      the layout of branches by the
+ *                      counts tm -p wrote to NAME.prof
+ *                      for the code NAME.map maps
+ */
+int passOption(char * arg);
+
+/* Function usesIr returns TRUE if runPasses
+ * generates the code through the IR, as it does
+ * above -O0 and when an IR pass is enabled at -O0
+ */
+int usesIr(void);
+
+/* Procedure runPasses runs the enabled passes over
+ * the checked syntax tree and generates its code,
+ * from the tree at -O0 and through the IR above or
+ * when an IR pass is enabled
+ */
+void runPasses(TreeNode * syntaxTree, char * codefile);
+
+#endif
@@ -0,0 +1,123 @@
+/****************************************************/
+/* File: profile.c                                  */
+/* Execution profile for the C-minus compiler: the  */
+/* counts of tm -p summed by source construct       */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "profile.h"
+#include "context.h"
+
+/* the hash table of Counts, of SIZE buckets, is
+   kept in cc->profile.counts */
+
+/* SHIFT is the power of two used as multiplier
+   in hash function  */
+#define SHIFT 4
+
+
+/* the hash function */
+static int hash(char * kind, int line, char * name)
+{ int temp = line % SIZE;
+  for (; *kind != '\0'; kind++) temp = ((temp << SHIFT) + *kind) % SIZE;
+  for (; *name != '\0'; name++) temp = ((temp << SHIFT) + *name) % SIZE;
+  return temp;
+}
+
+/* Function lookup returns the entry of a construct,
+ * or NULL if there is none
+ */
+static Count lookup(char * kind, int line, char * name)
+{ Count c = cc->profile.counts[hash(kind, line, name)];
+  while (c != NULL && (c->line != line || strcmp(c->kind, kind) != 0
+                       || strcmp(c->name, name) != 0))
+    c = c->next;
+  return c;
+}
+
+/* Procedure addCount adds n to the count of a
+ * construct, entering it if new
+ */
+static void addCount(char * kind, int line, char * name, long n)
+{ Count c = lookup(kind, line, name);
+  int h;
+  if (c == NULL)
+  { h = hash(kind, line, name);
+    c = (Count) malloc(sizeof(struct CountRec));
+    c->kind = copyString(kind);
+    c->line = line;
+    c->name = copyString(name);
+    c->count = 0;
+    c->next = cc->profile.counts[h];
+    cc->profile.counts[h] = c;
+  }
+  c->count += n;
+}
+
+/* Function loadProfile reads the debug map name.map
+ * and the profile name.prof
+ */
+int loadProfile(char * name)
+{ char * file = (char *) malloc(strlen(name) + 6);
+  char kind[32], callee[256];
+  FILE * f;
+  long * exec = NULL, n, taken;
+  int nexec = 0, loc, line, m;
+  sprintf(file, "%s.prof", name);
+  f = fopen(file, "r");
+  if (f == NULL)
+  { free(file);
+    return FALSE;
+  }
+  while (fscanf(f, "%d %ld %ld", &loc, &n, &taken) == 3)
+  { if (loc < 0) continue;
+    if (loc >= nexec)
+    { m = nexec ? 2*nexec : 256;
+      while (m <= loc) m *= 2;
+      exec = (long *) realloc(exec, m * sizeof(long));
+      for (; nexec < m; nexec++) exec[nexec] = 0;
+    }
+    exec[loc] = n;
+  }
+  fclose(f);
+  sprintf(file, "%s.map", name);
+  f = fopen(file, "r");
+  free(file);
+  if (f == NULL)
+  { free(exec);
+    return FALSE;
+  }
+  while (fscanf(f, "%d %31s %d %255s", &loc, kind, &line, callee) == 4)
+    addCount(kind, line, strcmp(callee, "-") == 0 ? "" : callee,
+             loc >= 0 && loc < nexec ? exec[loc] : 0);
+  fclose(f);
+  free(exec);
+  cc->profile.loaded = TRUE;
+  return TRUE;
+}
+
+/* Function profileCount returns how often construct
+ * kind at line ran in the profile, or -1
+ */
+long profileCount(char * kind, int line, char * name)
+{ Count c;
+  if (!cc->profile.loaded) return -1;
+  c = lookup(kind, line, name == NULL ? "" : name);
+  return c == NULL ? -1 : c->count;
+}
+
+/* Function profileEntries returns how often the loop
+ * at line was entered, or -1: the IR marks the entry
+ * to the loop, the tree code generator its test only
+ */
+long profileEntries(int line)
+{ long test = profileCount("test", line, NULL);
+  long body = profileCount("body", line, NULL);
+  long loop = profileCount("loop", line, NULL);
+  if (loop >= 0) return loop;
+  if (test < 0 || body < 0) return -1;
+  return test - body;
+}
@@ -0,0 +1,60 @@
+/****************************************************/
+/* File: profile.h                                  */
+/* Execution profile interface for the C-minus      */
+/* compiler: counts gathered by tm -p, mapped back  */
+/* to source constructs by the debug map            */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/* The debug map written with -debug-map has a line
+ * "loc kind line name" for each construct, giving
+ * the first TM location of its code; name is the
+ * callee of a call and "-" for the other kinds:
+ *   then, else  the arms of the if statement at line
+ *   endif       the code following that if
+ *   test        the test of the while loop at line,
+ *               run once more than its body
+ *   loop        the entry to the loop at line when
+ *               its body runs at least once
+ *   body        the body of that loop
+ *   call        a call to name at line
+ * Code copied by the optimizer keeps its line, so
+ * the copies of a construct add up.
+ */
+
+/* the counts of a construct, summed over the
+ * locations the map gives for it; kind and name
+ * are copies owned by the entry
+ */
+typedef struct CountRec
+{ char * kind;
+  int line;
+  char * name;
+  long count;
+  struct CountRec * next;
+} * Count;
+
+/* Function loadProfile reads the debug map name.map
+ * and the profile name.prof that tm -p wrote for a
+ * run of the code it maps; it returns FALSE if
+ * either cannot be read
+ */
+int loadProfile(char * name);
+
+/* Function profileCount returns how often construct
+ * kind at line ran in the profile, or -1 if there is
+ * no profile or the construct is not in the map
+ */
+long profileCount(char * kind, int line, char * name);
+
+/* Function profileEntries returns how often the loop
+ * at line was entered, or -1 if the profile does not
+ * tell
+ */
+long profileEntries(int line);
+
+#endif
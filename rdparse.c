@@ -0,0 +1,408 @@
+/****************************************************/
+/* File: rdparse.c                                  */
+/* Recursive-descent parser for the C-minus         */
+/* compiler, building the same tree as cminus.y     */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "rdparse.h"
+#include "context.h"
+
+/* The grammar is that of cminus.y, parsed with one
+ * token of lookahead that is read only when a choice
+ * needs it. Nodes take the line of the last token
+ * read when they are made, and Yacc reads its
+ * lookahead at the same points, so the trees agree
+ * in their line numbers too.
+ */
+
+/* Function peek returns the lookahead token,
+ * reading it if it has not been read yet
+ */
+static TokenType peek(Parser p)
+{ if (!p->ahead)
+  { p->token = scanToken(&p->scan);
+    p->ahead = TRUE;
+  }
+  return p->token;
+}
+
+/* Procedure advance consumes the lookahead token */
+static void advance(Parser p)
+{ peek(p);
+  p->ahead = FALSE;
+}
+
+/* Procedure syntaxError reports the lookahead token
+ * as Yacc does and abandons the parse
+ */
+static void syntaxError(Parser p)
+{ fprintf(cc->listing,"Syntax error at line %d: syntax error\n",p->scan.lineno);
+  fprintf(cc->listing,"Current token: ");
+  printToken(p->token,p->scan.text+p->scan.tokenOffset,p->scan.tokenLength);
+  p->error = TRUE;
+  longjmp(p->fail,1);
+}
+
+/* Procedure match consumes the lookahead token if
+ * it is expected, and reports a syntax error if not
+ */
+static void match(Parser p, TokenType expected)
+{ if (peek(p) != expected) syntaxError(p);
+  p->ahead = FALSE;
+}
+
+static TreeNode * newNode(Parser p, NodeKind nodekind, int kind)
+{ return newNodeIn(&p->nodes,nodekind,kind,p->scan.lineno); }
+
+/* Procedure append adds t, with its siblings, to
+ * the list from *first to *last
+ */
+static void append(TreeNode ** first, TreeNode ** last, TreeNode * t)
+{ if (t == NULL) return;
+  if (*first == NULL) *first = t;
+  else (*last)->sibling = t;
+  while (t->sibling != NULL) t = t->sibling;
+  *last = t;
+}
+
+/* Function name consumes an identifier and returns
+ * its interned name
+ */
+static char * name(Parser p)
+{ match(p,ID);
+  return internText(p->scan.text+p->scan.tokenOffset,p->scan.tokenLength);
+}
+
+/* Function number consumes a number and returns
+ * its value
+ */
+static int number(Parser p)
+{ int i, val = 0;
+  match(p,NUM);
+  for (i = 0; i < p->scan.tokenLength; i++)
+    val = val * 10 + (p->scan.text[p->scan.tokenOffset+i] - '0');
+  return val;
+}
+
+static TreeNode * typeSpec(Parser p)
+{ TreeNode * t;
+  TokenType type = peek(p);
+  if (type != INT && type != VOID) syntaxError(p);
+  advance(p);
+  t = newNode(p,TypeK,TypeNameK);
+  t->attr.type = type;
+  return t;
+}
+
+static TreeNode * expression(Parser p);
+static TreeNode * statement(Parser p);
+static TreeNode * compoundStmt(Parser p);
+
+/* Function varDeclRest parses a variable
+ * declaration after its type and name
+ */
+static TreeNode * varDeclRest(Parser p, TreeNode * type, char * id)
+{ TreeNode * t;
+  int size;
+  if (peek(p) == LBRACE)
+  { advance(p);
+    size = number(p);
+    match(p,RBRACE);
+    match(p,SEMI);
+    t = newNode(p,DeclK,ArrVarK);
+    t->attr.arr.name = id;
+    t->attr.arr.size = size;
+  }
+  else
+  { match(p,SEMI);
+    t = newNode(p,DeclK,VarK);
+    t->attr.name = id;
+  }
+  t->child[0] = type;
+  return t;
+}
+
+static TreeNode * params(Parser p);
+
+/* Function declaration parses a declaration after
+ * its type: a function is made as soon as the "("
+ * after its name is seen, as Yacc does
+ */
+static TreeNode * declaration(Parser p, TreeNode * type)
+{ TreeNode * t;
+  char * id = name(p);
+  if (peek(p) != LPAREN) return varDeclRest(p,type,id);
+  t = newNode(p,DeclK,FuncK);
+  t->attr.name = id;
+  advance(p);
+  t->child[0] = type;
+  t->child[1] = params(p);
+  match(p,RPAREN);
+  t->child[2] = compoundStmt(p);
+  return t;
+}
+
+/* Function paramRest parses a parameter after
+ * its type
+ */
+static TreeNode * paramRest(Parser p, TreeNode * type)
+{ TreeNode * t;
+  char * id = name(p);
+  if (peek(p) == LBRACE)
+  { advance(p);
+    match(p,RBRACE);
+    t = newNode(p,ParamK,ArrParamK);
+  }
+  else t = newNode(p,ParamK,NonArrParamK);
+  t->child[0] = type;
+  t->attr.name = id;
+  return t;
+}
+
+/* Function params parses a parameter list, or
+ * void alone; a void type is only made once the
+ * token after it tells which of the two it begins
+ */
+static TreeNode * params(Parser p)
+{ TreeNode * first = NULL, * last = NULL, * t;
+  if (peek(p) == VOID)
+  { advance(p);
+    peek(p);
+    t = newNode(p,TypeK,TypeNameK);
+    t->attr.type = VOID;
+    if (p->token == RPAREN) return t;
+    append(&first,&last,paramRest(p,t));
+  }
+  else append(&first,&last,paramRest(p,typeSpec(p)));
+  while (peek(p) == COMMA)
+  { advance(p);
+    append(&first,&last,paramRest(p,typeSpec(p)));
+  }
+  return first;
+}
+
+static TreeNode * compoundStmt(Parser p)
+{ TreeNode * decls = NULL, * lastDecl = NULL;
+  TreeNode * stmts = NULL, * lastStmt = NULL;
+  TreeNode * t, * type;
+  match(p,LCURLY);
+  while (peek(p) == INT || p->token == VOID)
+  { type = typeSpec(p);
+    append(&decls,&lastDecl,varDeclRest(p,type,name(p)));
+  }
+  while (peek(p) != RCURLY)
+    append(&stmts,&lastStmt,statement(p));
+  advance(p);
+  t = newNode(p,StmtK,CompK);
+  t->child[0] = decls;
+  t->child[1] = stmts;
+  return t;
+}
+
+static TreeNode * statement(Parser p)
+{ TreeNode * t, * test, * body, * other = NULL;
+  switch (peek(p))
+  { case LCURLY:
+      return compoundStmt(p);
+    case IF:
+      advance(p);
+      match(p,LPAREN);
+      test = expression(p);
+      match(p,RPAREN);
+      body = statement(p);
+      if (peek(p) == ELSE)
+      { advance(p);
+        other = statement(p);
+      }
+      t = newNode(p,StmtK,IfK);
+      t->child[0] = test;
+      t->child[1] = body;
+      t->child[2] = other;
+      return t;
+    case WHILE:
+      advance(p);
+      match(p,LPAREN);
+      test = expression(p);
+      match(p,RPAREN);
+      body = statement(p);
+      t = newNode(p,StmtK,IterK);
+      t->child[0] = test;
+      t->child[1] = body;
+      return t;
+    case RETURN:
+      advance(p);
+      if (peek(p) != SEMI) other = expression(p);
+      match(p,SEMI);
+      t = newNode(p,StmtK,RetK);
+      t->child[0] = other;
+      return t;
+    case SEMI:
+      advance(p);
+      return NULL;
+    default:
+      t = expression(p);
+      match(p,SEMI);
+      return t;
+  }
+}
+
+/* Function idFactor parses a variable, array
+ * element or call, once the identifier that starts
+ * it is the lookahead
+ */
+static TreeNode * idFactor(Parser p)
+{ TreeNode * t, * first = NULL, * last = NULL;
+  char * id = name(p);
+  switch (peek(p))
+  { case LBRACE:
+      t = newNode(p,ExpK,ArrIdK);
+      t->attr.name = id;
+      advance(p);
+      t->child[0] = expression(p);
+      match(p,RBRACE);
+      return t;
+    case LPAREN:
+      t = newNode(p,ExpK,CallK);
+      t->attr.name = id;
+      advance(p);
+      if (peek(p) != RPAREN)
+      { append(&first,&last,expression(p));
+        while (peek(p) == COMMA)
+        { advance(p);
+          append(&first,&last,expression(p));
+        }
+      }
+      match(p,RPAREN);
+      t->child[0] = first;
+      return t;
+    default:
+      t = newNode(p,ExpK,IdK);
+      t->attr.name = id;
+      return t;
+  }
+}
+
+static TreeNode * factor(Parser p)
+{ TreeNode * t;
+  int val;
+  switch (peek(p))
+  { case LPAREN:
+      advance(p);
+      t = expression(p);
+      match(p,RPAREN);
+      return t;
+    case ID:
+      return idFactor(p);
+    case NUM:
+      val = number(p);
+      t = newNode(p,ExpK,ConstK);
+      t->attr.val = val;
+      return t;
+    default:
+      syntaxError(p);
+      return NULL;
+  }
+}
+
+/* Function binary makes the operator node for the
+ * lookahead token, which it consumes first
+ */
+static TreeNode * binary(Parser p, TreeNode * left)
+{ TreeNode * t;
+  TokenType op = p->token;
+  advance(p);
+  t = newNode(p,ExpK,OpK);
+  t->attr.op = op;
+  t->child[0] = left;
+  return t;
+}
+
+/* The functions for the operator levels take the
+ * first factor if the caller has parsed it already
+ */
+static TreeNode * term(Parser p, TreeNode * first)
+{ TreeNode * t = first != NULL ? first : factor(p);
+  while (peek(p) == TIMES || p->token == OVER)
+  { t = binary(p,t);
+    t->child[1] = factor(p);
+  }
+  return t;
+}
+
+static TreeNode * addExp(Parser p, TreeNode * first)
+{ TreeNode * t = term(p,first);
+  while (peek(p) == PLUS || p->token == MINUS)
+  { t = binary(p,t);
+    t->child[1] = term(p,NULL);
+  }
+  return t;
+}
+
+static TreeNode * simpleExp(Parser p, TreeNode * first)
+{ TreeNode * t = addExp(p,first);
+  switch (peek(p))
+  { case LE: case EQ: case NE: case LT: case GT: case GE:
+      t = binary(p,t);
+      t->child[1] = addExp(p,NULL);
+      break;
+  }
+  return t;
+}
+
+/* Function expression parses an assignment or a
+ * simple expression: a leading variable is parsed
+ * first, and is assigned to if "=" follows it
+ */
+static TreeNode * expression(Parser p)
+{ TreeNode * t, * var, * value;
+  if (peek(p) != ID) return simpleExp(p,NULL);
+  var = idFactor(p);
+  if (var->kind.exp == CallK || peek(p) != ASSIGN)
+    return simpleExp(p,var);
+  advance(p);
+  value = expression(p);
+  t = newNode(p,ExpK,AssignK);
+  t->child[0] = var;
+  t->child[1] = value;
+  return t;
+}
+
+/****************************************/
+/* the primary function of the parser   */
+/****************************************/
+/* Function rdParse returns the newly
+ * constructed syntax tree
+ */
+TreeNode * rdParse(Parser p)
+{ TreeNode * first = NULL, * last = NULL, * type;
+  if (setjmp(p->fail)) return NULL;
+  do
+  { type = typeSpec(p);
+    append(&first,&last,declaration(p,type));
+  } while (peek(p) != ENDFILE);
+  return first;
+}
+
+Parser newParser(FILE * f)
+{ Parser p = (Parser) malloc(sizeof(struct ParserRec));
+  if (p == NULL)
+  { fprintf(cc->listing,"Out of memory error making a parser\n");
+    exit(1);
+  }
+  initScanner(&p->scan,f);
+  p->ahead = FALSE;
+  p->nodes = NULL;
+  p->error = FALSE;
+  return p;
+}
+
+void freeParser(Parser p)
+{ freeScanner(&p->scan);
+  freeArena(&p->nodes);
+  free(p);
+}
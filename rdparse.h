@@ -0,0 +1,45 @@
+/****************************************************/
+/* File: rdparse.h                                  */
+/* Recursive-descent parser interface for the       */
+/* C-minus compiler                                 */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#ifndef _RDPARSE_H_
+#define _RDPARSE_H_
+
+#include <setjmp.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+
+/* A Parser holds all the state of parsing one
+ * source file, so that several may be parsed at
+ * once on different threads; its syntax tree is
+ * made in its own arena and lives as long as it
+ */
+typedef struct ParserRec
+{ Scanner scan;
+  TokenType token;  /* the lookahead token, if ahead */
+  int ahead;
+  NodeArena nodes;
+  int error;        /* TRUE after a syntax error */
+  jmp_buf fail;     /* where a syntax error returns */
+} * Parser;
+
+/* Function newParser returns a parser for file f */
+Parser newParser(FILE * f);
+
+/* Function rdParse returns the syntax tree of the
+ * file of p, the same one parse builds, or NULL
+ * after reporting a syntax error
+ */
+TreeNode * rdParse(Parser p);
+
+/* Procedure freeParser releases p, its text and
+ * its tree
+ */
+void freeParser(Parser p);
+
+#endif
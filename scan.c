@@ -1,6 +1,8 @@
 /****************************************************/
 /* File: scan.c                                     */
-/* The scanner implementation for the TINY compiler */
+/* The scanner implementation for the C-minus       */
+/* compiler, written by hand to replace the flex    */
+/* scanner of cminus.l                              */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -8,293 +10,317 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "context.h"
 
-/* states in scanner DFA */
-typedef enum
-   { START,INEQ,INCOMMENT,INNUM,INID,DONE,INLT,INGT,INNE,INOVER,INCOMMENT_ }
-   StateType;
-
-/* lexeme of identifier or reserved word */
-char tokenString[MAXTOKENLEN+1];
+/* set NO_SIMD to TRUE to scan one character at a
+ * time even where SSE2 or AVX2 is available
+ */
+#ifndef NO_SIMD
+#define NO_SIMD FALSE
+#endif
 
-/* BUFLEN = length of the input buffer for
-   source code lines */
-#define BUFLEN 256
+/* Runs of blanks, letters and digits and comment
+ * bodies are skipped VECLEN bytes at a time: each
+ * block is loaded whole and its bytes classified
+ * into a bit mask, whose lowest clear bit ends the
+ * run. Only the bytes of the run are used, but the
+ * loads may read up to VECLEN-1 bytes past its end,
+ * so the text is followed by SCANPAD '\0' bytes,
+ * which belong to no class and stop every run.
+ */
+#if !NO_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#define VECLEN 32
+typedef __m256i Vec;
+#define vload(p) _mm256_loadu_si256((const __m256i *) (p))
+#define vsplat(c) _mm256_set1_epi8(c)
+#define veq(a,b) _mm256_cmpeq_epi8(a,b)
+#define vgt(a,b) _mm256_cmpgt_epi8(a,b)
+#define vand(a,b) _mm256_and_si256(a,b)
+#define vor(a,b) _mm256_or_si256(a,b)
+#define vmask(a) ((unsigned) _mm256_movemask_epi8(a))
+#elif !NO_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#define VECLEN 16
+typedef __m128i Vec;
+#define vload(p) _mm_loadu_si128((const __m128i *) (p))
+#define vsplat(c) _mm_set1_epi8(c)
+#define veq(a,b) _mm_cmpeq_epi8(a,b)
+#define vgt(a,b) _mm_cmpgt_epi8(a,b)
+#define vand(a,b) _mm_and_si128(a,b)
+#define vor(a,b) _mm_or_si128(a,b)
+#define vmask(a) ((unsigned) _mm_movemask_epi8(a))
+#endif
 
-static char lineBuf[BUFLEN]; /* holds the current line */
-static int linepos = 0; /* current position in LineBuf */
-static int bufsize = 0; /* current size of buffer string */
-static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
+#define SCANPAD 64
 
-/* getNextChar fetches the next non-blank character
-   from lineBuf, reading in a new line if lineBuf is
-   exhausted */
-static int getNextChar(void)
-{ if (!(linepos < bufsize))
-  { lineno++;
-    if (fgets(lineBuf,BUFLEN-1,source))
-    { if (EchoSource) fprintf(listing,"%4d: %s",lineno,lineBuf);
-      bufsize = strlen(lineBuf);
-      linepos = 0;
-      return lineBuf[linepos++];
-    }
-    else
-    { EOF_flag = TRUE;
-      return EOF;
-    }
-  }
-  else return lineBuf[linepos++];
-}
+/* character classes of the scalar scanner */
+#define BLANK  1
+#define LETTER 2
+#define DIGIT  4
 
-/* ungetNextChar backtracks one character
-   in lineBuf */
-static void ungetNextChar(void)
-{ if (!EOF_flag) linepos-- ;}
+static const unsigned char charClass[256] =
+{ [' '] = BLANK, ['\t'] = BLANK, ['\n'] = BLANK,
+  ['a' ... 'z'] = LETTER, ['A' ... 'Z'] = LETTER,
+  ['0' ... '9'] = DIGIT };
 
 /* lookup table of reserved words */
 static struct
-    { char* str;
-      TokenType tok;
-    } reservedWords[MAXRESERVED]
-   = {{"if",IF},{"else",ELSE},
-      {"while",WHILE},{"return",RETURN},{"int",INT},
-      {"void",VOID}};
+{ char * str;
+  int len;
+  TokenType tok;
+} reservedWords[] =
+{ {"if",2,IF}, {"else",4,ELSE}, {"while",5,WHILE},
+  {"int",3,INT}, {"void",4,VOID}, {"return",6,RETURN} };
 
-/* lookup an identifier to see if it is a reserved word */
-/* uses linear search */
-static TokenType reservedLookup (char * s)
+#define NRESERVED (sizeof(reservedWords) / sizeof(reservedWords[0]))
+
+/* lookup an identifier of n letters at s to see if
+ * it is a reserved word; uses linear search
+ */
+static TokenType reservedLookup(char * s, int n)
 { int i;
-  for (i=0;i<MAXRESERVED;i++)
-    if (!strcmp(s,reservedWords[i].str))
+  for (i = 0; i < NRESERVED; i++)
+    if (reservedWords[i].len == n && memcmp(s,reservedWords[i].str,n) == 0)
       return reservedWords[i].tok;
   return ID;
 }
 
+#ifdef VECLEN
+
+/* VECMASK keeps the VECLEN bits of a byte mask */
+#if VECLEN == 32
+#define VECMASK 0xffffffffu
+#else
+#define VECMASK 0xffffu
+#endif
+
+/* Function spanLetters returns the length of the
+ * run of letters at p; letters are folded to lower
+ * case first, and bytes above 127 compare as
+ * negative, so they are no letters
+ */
+static int spanLetters(const char * p)
+{ Vec v;
+  unsigned m;
+  int n = 0;
+  for (;;)
+  { v = vor(vload(p+n),vsplat(0x20));
+    m = ~vmask(vand(vgt(v,vsplat('a'-1)),vgt(vsplat('z'+1),v))) & VECMASK;
+    if (m != 0) return n + __builtin_ctz(m);
+    n += VECLEN;
+  }
+}
+
+/* Function spanDigits returns the length of the
+ * run of digits at p
+ */
+static int spanDigits(const char * p)
+{ Vec v;
+  unsigned m;
+  int n = 0;
+  for (;;)
+  { v = vload(p+n);
+    m = ~vmask(vand(vgt(v,vsplat('0'-1)),vgt(vsplat('9'+1),v))) & VECMASK;
+    if (m != 0) return n + __builtin_ctz(m);
+    n += VECLEN;
+  }
+}
+
+/* Function skipBlanks returns the first character
+ * at or after p that is not a blank, counting the
+ * lines it passes in s
+ */
+static char * skipBlanks(Scanner * s, char * p)
+{ Vec v, nl;
+  unsigned m;
+  if (*p != ' ' && *p != '\t' && *p != '\n') return p;
+  for (;;)
+  { v = vload(p);
+    nl = veq(v,vsplat('\n'));
+    m = ~vmask(vor(vor(veq(v,vsplat(' ')),veq(v,vsplat('\t'))),nl)) & VECMASK;
+    if (m != 0)
+    { m &= -m;
+      s->lineno += __builtin_popcount(vmask(nl) & (m - 1));
+      return p + __builtin_ctz(m);
+    }
+    s->lineno += __builtin_popcount(vmask(nl));
+    p += VECLEN;
+  }
+}
+
+/* Function skipComment returns the character after
+ * the "*" "/" that closes the comment whose body
+ * starts at p, or the end of the text, counting the
+ * lines it passes in s
+ */
+static char * skipComment(Scanner * s, char * p)
+{ Vec v, nl;
+  unsigned m;
+  for (;;)
+  { v = vload(p);
+    nl = veq(v,vsplat('\n'));
+    m = vmask(vor(veq(v,vsplat('*')),veq(v,vsplat('\0'))));
+    if (m == 0)
+    { s->lineno += __builtin_popcount(vmask(nl));
+      p += VECLEN;
+      continue;
+    }
+    m &= -m;
+    s->lineno += __builtin_popcount(vmask(nl) & (m - 1));
+    p += __builtin_ctz(m);
+    if (*p == '*' && p[1] == '/') return p + 2;
+    if (*p == '\0' && p >= s->end) return s->end;
+    p++;
+  }
+}
+
+#else
+
+/* the scalar versions classify one character at a
+ * time through charClass
+ */
+static int spanClass(const char * p, int class)
+{ const char * q = p;
+  while (charClass[(unsigned char) *q] & class) q++;
+  return q - p;
+}
+
+static char * skipBlanks(Scanner * s, char * p)
+{ while (charClass[(unsigned char) *p] & BLANK)
+    if (*p++ == '\n') s->lineno++;
+  return p;
+}
+
+static char * skipComment(Scanner * s, char * p)
+{ for (; p < s->end; p++)
+  { if (*p == '*' && p[1] == '/') return p + 2;
+    if (*p == '\n') s->lineno++;
+  }
+  return s->end;
+}
+
+#define spanLetters(p) spanClass(p,LETTER)
+#define spanDigits(p) spanClass(p,DIGIT)
+
+#endif
+
+/* Procedure initScanner makes s scan the file f
+ * from its first line
+ */
+void initScanner(Scanner * s, FILE * f)
+{ size_t size;
+  s->text = mapSource(f,SCANPAD,&size);
+  s->cur = s->text;
+  s->end = s->text + size;
+  s->lineno = 1;
+  s->tokenOffset = 0;
+  s->tokenLength = 0;
+}
+
+/* Procedure freeScanner releases the text of s */
+void freeScanner(Scanner * s)
+{ unmapSource(s->text,s->end - s->text,SCANPAD); }
+
 /****************************************/
 /* the primary function of the scanner  */
 /****************************************/
-/* function getToken returns the 
- * next token in source file
+/* function scanToken returns the
+ * next token s finds in its file
+ */
+TokenType scanToken(Scanner * s)
+{ TokenType currentToken;
+  char * cur = s->cur;
+  char * start;
+  for (;;)
+  { cur = skipBlanks(s,cur);
+    if (cur[0] != '/' || cur[1] != '*') break;
+    cur = skipComment(s,cur+2);
+  }
+  start = cur;
+  switch (charClass[(unsigned char) *cur++])
+  { case LETTER:
+      cur += spanLetters(cur);
+      currentToken = reservedLookup(start,cur-start);
+      break;
+    case DIGIT:
+      cur += spanDigits(cur);
+      currentToken = NUM;
+      break;
+    default:
+      switch (start[0])
+      { case '=':
+          if (*cur == '=') { cur++; currentToken = EQ; }
+          else currentToken = ASSIGN;
+          break;
+        case '<':
+          if (*cur == '=') { cur++; currentToken = LE; }
+          else currentToken = LT;
+          break;
+        case '>':
+          if (*cur == '=') { cur++; currentToken = GE; }
+          else currentToken = GT;
+          break;
+        case '!':
+          if (*cur == '=') { cur++; currentToken = NE; }
+          else currentToken = ERROR;
+          break;
+        case '+': currentToken = PLUS; break;
+        case '-': currentToken = MINUS; break;
+        case '*': currentToken = TIMES; break;
+        case '/': currentToken = OVER; break;
+        case '(': currentToken = LPAREN; break;
+        case ')': currentToken = RPAREN; break;
+        case '[': currentToken = LBRACE; break;
+        case ']': currentToken = RBRACE; break;
+        case '{': currentToken = LCURLY; break;
+        case '}': currentToken = RCURLY; break;
+        case ';': currentToken = SEMI; break;
+        case ',': currentToken = COMMA; break;
+        case '\0':
+          if (start >= s->end)
+          { cur = start;
+            currentToken = ENDFILE;
+            break;
+          }
+          /* fall through */
+        default:
+          currentToken = ERROR;
+          break;
+      }
+  }
+  s->cur = cur;
+  s->tokenOffset = start - s->text;
+  s->tokenLength = cur - start;
+  if (cc->TraceScan) {
+    fprintf(cc->listing,"\t%d: ",s->lineno);
+    printToken(currentToken,start,s->tokenLength);
+  }
+  return currentToken;
+} /* end scanToken */
+
+/* function getToken returns the
+ * next token in source file, read
+ * with the scanner of the context
  */
 TokenType getToken(void)
-{  /* index for storing into tokenString */
-   int tokenStringIndex = 0;
-   /* holds current token to be returned */
-   TokenType currentToken;
-   /* current state - always begins at START */
-   StateType state = START;
-   /* flag to indicate save to tokenString */
-   int save;
-   while (state != DONE)
-   { int c = getNextChar();
-     save = TRUE;
-     switch (state)
-     { case START:
-         if (isdigit(c))
-           state = INNUM;
-         else if (isalpha(c))
-           state = INID;
-         else if ((c == ' ') || (c == '\t') || (c == '\n'))
-           save = FALSE;
-         else if (c == '/')
-         { save = FALSE;
-           state = INOVER;
-         }
-	 else if (c == '<')
-	 {
-	     save = FALSE;
-	     state = INLT;
-	 }
-	 else if (c == '>')
-	 {
-	     save = FALSE;
-	     state = INGT;
-	 }
-	 else if (c == '!')
-	 {
-	     save = FALSE;
-	     state = INNE;
-	 }
-	 else if (c == '=')
-	 {
-	     save = FALSE;
-	     state = INEQ;
-	 }
-         else
-         { state = DONE;
-           switch (c)
-           { case EOF:
-               save = FALSE;
-               currentToken = ENDFILE;
-               break;
-             case '=':
-               currentToken = ASSIGN;
-               break;
-             case '<':
-               currentToken = LT;
-               break;
-             case '+':
-               currentToken = PLUS;
-               break;
-             case '-':
-               currentToken = MINUS;
-               break;
-             case '*':
-               currentToken = TIMES;
-               break;
-             case '(':
-               currentToken = LPAREN;
-               break;
-             case ')':
-               currentToken = RPAREN;
-               break;
-             case ';':
-               currentToken = SEMI;
-               break;
-	     case '{':
-	       currentToken = LCURLY;
-	       break;
-	     case '}':
-	       currentToken = RCURLY;
-	       break;
-	     case '[':
-	       currentToken = LBRACE;
-	       break;
-	     case ']':
-	       currentToken = RBRACE;
-	       break;
-	     case '/':
-	       currentToken = OVER;
-	       break;
-	     case ',':
-	       currentToken = COMMA;
-	       break;
-             default:
-               currentToken = ERROR;
-               break;
-           }
-         }
-         break;
-	
-       case INOVER:
-	 save = FALSE;
-	 if(c == '*')
-	 {
-	     state=INCOMMENT;
-	     save=FALSE;
-	 }
-	 else
-	 {
-	     state=DONE;
-	     ungetNextChar();
-	     currentToken = OVER;
-	 }
-	 break;
-       case INCOMMENT:
-         save = FALSE;
-         if (c == EOF)
-         { state = DONE;
-           currentToken = ENDFILE;
-         }
-	 else if(c=='*')
-	     state = INCOMMENT_;
-         break;
-       case INCOMMENT_:
-	 save = FALSE;
-	 if (c == EOF)
-	 {
-	     state = DONE;
-	     currentToken = ENDFILE;
-	 }
-	 else if(c=='/')
-	     state = START;
-	 else
-	     state = INCOMMENT;
-	 break;
-       case INEQ:
-	 state = DONE;
-	 if (c == '=')
-	 {
-	     currentToken = EQ;
-	 }
-	 else {
-	     ungetNextChar();
-	     currentToken = ASSIGN;
-	 }
-	 break;
-       case INLT:
-	 state = DONE;
-	 if(c == '=')
-	 {
-	     currentToken = LE;
-	 }
-	 else{
-	     ungetNextChar();
-	     currentToken = LT;
-	 }
-	 break;
-       case INGT:
-	 state = DONE;
-	 if(c == '=')
-	 {
-	     currentToken = GE;
-	 }
-	 else
-	 {
-	     ungetNextChar();
-	     currentToken = GT;
-	 }
-	 break;
-       case INNE:
-	 state = DONE;
-	 if (c == '=')
-	 {
-	     currentToken = NE;
-	 }
-	 else
-	 {
-	     ungetNextChar();
-	     save = FALSE;
-	     currentToken  = ERROR;
-	 }
-	 break;
-       case INNUM:
-         if (!isdigit(c))
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           state = DONE;
-           currentToken = NUM;
-         }
-         break;
-       case INID:
-         if (!isalpha(c))
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           state = DONE;
-           currentToken = ID;
-         }
-         break;
-       case DONE:
-       default: /* should never happen */
-         fprintf(listing,"Scanner Bug: state= %d\n",state);
-         state = DONE;
-         currentToken = ERROR;
-         break;
-     }
-     if ((save) && (tokenStringIndex <= MAXTOKENLEN))
-       tokenString[tokenStringIndex++] = (char) c;
-     if (state == DONE)
-     { tokenString[tokenStringIndex] = '\0';
-       if (currentToken == ID)
-         currentToken = reservedLookup(tokenString);
-     }
-   }
-   if (TraceScan) {
-     fprintf(listing,"\t%d: ",lineno);
-     printToken(currentToken,tokenString);
-   }
-   return currentToken;
-} /* end getToken */
+{ Scanner * s = &cc->scanner;
+  TokenType currentToken;
+  if (s->text == NULL) initScanner(s,cc->source);
+  currentToken = scanToken(s);
+  cc->lineno = s->lineno;
+  return currentToken;
+}
 
+char * tokenName(void)
+{ Scanner * s = &cc->scanner;
+  return internText(s->text+s->tokenOffset,s->tokenLength);
+}
+
+int tokenValue(void)
+{ Scanner * s = &cc->scanner;
+  int i, val = 0;
+  for (i = 0; i < s->tokenLength; i++)
+    val = val * 10 + (s->text[s->tokenOffset+i] - '0');
+  return val;
+}
@@ -8,17 +8,49 @@
 #ifndef _SCAN_H_
 #define _SCAN_H_
 
-/* MAXTOKENLEN is the maximum size of a token */
-#define MAXTOKENLEN 40
-
-/* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN+1];
-extern char numString[MAXTOKENLEN+1];
-extern char prevToken[MAXTOKENLEN+1];
-extern char tempString[MAXTOKENLEN+1];
 /* function getToken returns the 
- * next token in source file
+ * next token in source file; the
+ * scanner of the compiler context
+ * maps the whole file into memory
+ * when it starts, and lexemes are
+ * not '\0' terminated nor copied
  */
 TokenType getToken(void);
 
+/* A Scanner reads one source file on its own, for
+ * parsers that keep their state to themselves; the
+ * text is followed by '\0' bytes to read ahead into
+ */
+typedef struct ScannerRec
+{ char * text;
+  char * cur;       /* next character to scan */
+  char * end;       /* end of the text */
+  int lineno;       /* line of the last token */
+  int tokenOffset;  /* lexeme of the last token */
+  int tokenLength;
+} Scanner;
+
+/* Procedure initScanner makes s scan file f; the
+ * file is mapped or read whole
+ */
+void initScanner(Scanner * s, FILE * f);
+
+/* Procedure freeScanner releases the text of s */
+void freeScanner(Scanner * s);
+
+/* Function scanToken returns the next token s
+ * finds in its file
+ */
+TokenType scanToken(Scanner * s);
+
+/* Function tokenName returns the interned name
+ * of the last token, an identifier
+ */
+char * tokenName(void);
+
+/* Function tokenValue returns the value of the
+ * last token, a number
+ */
+int tokenValue(void);
+
 #endif
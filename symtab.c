@@ -13,26 +13,15 @@
 #include <string.h>
 #include "symtab.h"
 #include "globals.h"
+#include "util.h"
+#include "context.h"
 
-char * scope_name;
-/* the hash function */
+/* the hash function: names are interned, and keep
+   the hash computed when they were entered */
 static int hash ( char * key )
-{ int temp = 0;
-  int i = 0;
-  while (key[i] != '\0')
-  { temp = ((temp << SHIFT) + key[i]) % SIZE;
-    ++i;
-  }
-  return temp;
+{ return internHash(key) % SIZE;
 }
 
-/* the hash table */
-static ScopeList scopeStack[STACK];
-static ScopeList scopelist[SIZE];
-static FuncParam funclist[SIZE];
-int scopeindex = 0;
-int scopestack_i = 0;
-int plindex = 0;
 FuncParam createpl(char * name, TreeNode * tree)
 {
   FuncParam newpl;
@@ -40,54 +29,74 @@ FuncParam createpl(char * name, TreeNode * tree)
   newpl = (FuncParam) malloc(sizeof(struct FuncParamRec));
   newpl->name = name;
   newpl->treenode = tree;
+  newpl->entry = -1;
 
   return newpl;
 }
 
+/* Function grow doubles the room of a list of max
+ * pointers when it is full, or exits when out of
+ * memory
+ */
+static void * grow(void * list, int * max)
+{ *max = *max ? 2 * *max : SIZE;
+  list = realloc(list, *max * sizeof(void *));
+  if (list == NULL)
+  { fprintf(stderr,"Out of memory error in the symbol table\n");
+    exit(1);
+  }
+  return list;
+}
+
 void push_pl(FuncParam pl)
 {
-  funclist[plindex++] = pl;
+  if (cc->symtab.plindex == cc->symtab.plMax)
+    cc->symtab.funclist = grow(cc->symtab.funclist, &cc->symtab.plMax);
+  cc->symtab.funclist[cc->symtab.plindex++] = pl;
 }
 
 FuncParam getpl(char *name)
 {
   int i;
   
-  for(i=0;i<plindex;i++)
+  for(i=0;i<cc->symtab.plindex;i++)
   { 
-    if((strcmp(name,funclist[i]->name)==0))
-      return funclist[i];
+    if(name == cc->symtab.funclist[i]->name)
+      return cc->symtab.funclist[i];
   }
   return NULL;
 }
 
 ScopeList topscope()
-{ if(scopestack_i == 0)
+{ if(cc->symtab.scopestack_i == 0)
     return NULL;
-  return scopeStack[scopestack_i-1];
+  return cc->symtab.scopeStack[cc->symtab.scopestack_i-1];
 }
 
 ScopeList createscope(char * name)
 {
   ScopeList newScope;
 
-  newScope = (ScopeList) malloc(sizeof(struct ScopeListRec));
+  newScope = (ScopeList) calloc(1, sizeof(struct ScopeListRec));
   newScope->name = name;
   newScope->parent = topscope();
-  scopelist[scopeindex++] = newScope;
+  if (cc->symtab.scopeindex == cc->symtab.scopeMax)
+    cc->symtab.scopelist = grow(cc->symtab.scopelist, &cc->symtab.scopeMax);
+  cc->symtab.scopelist[cc->symtab.scopeindex++] = newScope;
   newScope->paramNum = 0;
   newScope->varNum = 0;
+  newScope->frameSize = 0;
   return newScope;
 }
 
 void push_scope(ScopeList scope)
 {
-  scopeStack[scopestack_i++] = scope;
+  cc->symtab.scopeStack[cc->symtab.scopestack_i++] = scope;
 }
 
 void pop_scope()
 {
-  scopestack_i--;
+  cc->symtab.scopestack_i--;
 }
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
@@ -102,7 +111,7 @@ void st_insert( char * scope, char * name, ExpType type, int lineno, int loc ,in
     topsc = topsc->parent;
   }
   BucketList l =  topsc->bucket[h];
-  while ((l != NULL) && (strcmp(name,l->name) != 0))
+  while ((l != NULL) && (name != l->name))
     l = l->next;
   if (l == NULL) /* variable not yet in table */
   { l = (BucketList) malloc(sizeof(struct BucketListRec));
@@ -130,7 +139,7 @@ void add_line(char * name, int lineno)
   while(topsc != NULL)
   { 
     l = topsc->bucket[h];
-    while((l != NULL) && (strcmp(name,l->name) !=0))
+    while((l != NULL) && (name != l->name))
       l=l->next;
     if( l != NULL){
       LineList t = l->lines;
@@ -154,17 +163,17 @@ void add_line(char * name, int lineno)
  */
 int st_lookup ( char * scope, char * name )
 { int h = hash(name);
-  ScopeList tscope = scopeStack[scopestack_i-1];
-  scope_name = tscope->name;
+  ScopeList tscope = cc->symtab.scopeStack[cc->symtab.scopestack_i-1];
+  cc->symtab.scope_name = tscope->name;
   while(tscope!=NULL)
   {
     BucketList l =  tscope->bucket[h];
-    while((l != NULL) && (strcmp(name,l->name) != 0))
+    while((l != NULL) && (name != l->name))
       l = l->next;
     if (l != NULL) return l->mloc; 
     else if ( tscope->parent != NULL) {
       tscope = tscope->parent;
-      scope_name = tscope->name;
+      cc->symtab.scope_name = tscope->name;
     }
     else return -1;
   }
@@ -174,17 +183,17 @@ ExpType type_lookup ( char * scope, char * name)
 { int h = hash(name);
   ScopeList tscope;
   int i;
-  for(i=scopeindex-1;i>=0;i--){
-    if((strcmp(scopelist[i]->name, scope) == 0))
+  for(i=cc->symtab.scopeindex-1;i>=0;i--){
+    if(cc->symtab.scopelist[i]->name == scope)
     {
-      tscope = scopelist[i];
+      tscope = cc->symtab.scopelist[i];
       break;
     }
   }
   while(tscope!=NULL)
   {
     BucketList l =  tscope->bucket[h];
-    while((l != NULL) && (strcmp(name,l->name) != 0))
+    while((l != NULL) && (name != l->name))
       l = l->next;
     if (l != NULL) return l->type; 
     else if ( tscope->parent != NULL) tscope = tscope->parent;
@@ -193,12 +202,53 @@ ExpType type_lookup ( char * scope, char * name)
 }
 
 
+BucketList st_find ( ScopeList scope, char * name, ScopeList * found)
+{ int h = hash(name);
+  BucketList l;
+  for (; scope != NULL; scope = scope->parent)
+  { l = scope->bucket[h];
+    while ((l != NULL) && (name != l->name))
+      l = l->next;
+    if (l != NULL)
+    { *found = scope;
+      return l;
+    }
+  }
+  *found = NULL;
+  return NULL;
+}
+
+/* Procedure st_copy gives scope to copies of the
+ * entries of scope from, with their lines, so that
+ * neither shares what the other may change
+ */
+void st_copy ( ScopeList from, ScopeList to)
+{ BucketList l, * last;
+  LineList t, * tail;
+  int k;
+  for (k = 0; k < SIZE; k++)
+  { last = &to->bucket[k];
+    for (l = from->bucket[k]; l != NULL; l = l->next)
+    { *last = (BucketList) malloc(sizeof(struct BucketListRec));
+      **last = *l;
+      tail = &(*last)->lines;
+      for (t = l->lines; t != NULL; t = t->next)
+      { *tail = (LineList) malloc(sizeof(struct LineListRec));
+        **tail = *t;
+        tail = &(*tail)->next;
+      }
+      last = &(*last)->next;
+    }
+    *last = NULL;
+  }
+}
+
 int st_lookup_cur ( char * scope, char * name)
 {
   int h = hash(name);
   ScopeList tscope = topscope();
   BucketList l = tscope->bucket[h];
-  while((l != NULL) && (strcmp(name,l->name) != 0))
+  while((l != NULL) && (name != l->name))
     l = l->next;
   if (l != NULL) return l->memloc;
   else return -1;
@@ -206,15 +256,10 @@ int st_lookup_cur ( char * scope, char * name)
 
 ExpType sc_lookup ( char * name )
 { int h = hash(name);
-  ScopeList scope = scopelist[0];
+  ScopeList scope = cc->symtab.scopelist[0];
   BucketList bucket = scope->bucket[h];
-  while((bucket!=NULL) && (strcmp(bucket->name,name) != 0))
-  {
-    printf("sc_lll : %s\n",bucket->name);
+  while((bucket!=NULL) && (bucket->name != name))
     bucket = bucket->next;
-    if(strcmp(bucket->name,name)==0)
-      return bucket->type;
-  }
   if(bucket!=NULL) return bucket->type;
   return -1;
 }
@@ -222,10 +267,10 @@ ExpType sc_lookup ( char * name )
 ScopeList scope_lookup( char * name )
 {
   int i;
-  for(i=0;i<scopeindex;i++)
+  for(i=0;i<cc->symtab.scopeindex;i++)
   {
-    if(strcmp(scopelist[i]->name,name) == 0){
-        return scopelist[i];
+    if(cc->symtab.scopelist[i]->name == name){
+        return cc->symtab.scopelist[i];
     }
   }
   return -1;
@@ -235,12 +280,12 @@ ScopeList scope_lookup( char * name )
  * to the listing file
  */
 void printSymTab(FILE * listing)
-{ printf("print\n\n");
+{ fprintf(listing,"print\n\n");
   int i,j;
   char * type;
-  for(i=0;i<scopeindex;i++)
+  for(i=0;i<cc->symtab.scopeindex;i++)
   {
-    ScopeList scope = scopelist[i];
+    ScopeList scope = cc->symtab.scopelist[i];
     fprintf(listing, "%s , param Num : %d\n",scope->name, scope->paramNum);
     fprintf(listing, "======================================================\n");
     fprintf(listing, "name    type          IDtype   loc     lines\n");
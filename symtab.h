@@ -14,8 +14,6 @@
 #define SIZE 211
 #define STACK 211
 
-char * scope_name;
-
 /* SHIFT is the power of two used as multiplier
    in hash function  */
 #define SHIFT 4
@@ -51,6 +49,7 @@ typedef struct ScopeListRec
   struct ScopeListRec * parent;
   int paramNum;
   int varNum;
+  int frameSize; /* words for params and locals, arrays included */
 } * ScopeList;
 
 typedef struct FuncParamRec
@@ -58,9 +57,9 @@ typedef struct FuncParamRec
 	char * name;
 	TreeNode * treenode;
   int paramNum;
+  int entry; /* code location of the function, -1 until placed */
 } * FuncParam;
 
-ScopeList g_scope;
 ScopeList scope_lookup( char * name );
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
@@ -86,6 +85,17 @@ ScopeList createscope(char * name);
 void push_scope();
 void pop_scope();
 ExpType type_lookup ( char * scope, char * name);
+
+/* Function st_find returns the entry name has seen
+ * from scope, and in *found the scope that holds it,
+ * or NULL if there is none
+ */
+BucketList st_find ( ScopeList scope, char * name, ScopeList * found);
+
+/* Procedure st_copy gives scope to copies of the
+ * entries of scope from
+ */
+void st_copy ( ScopeList from, ScopeList to);
 int st_lookup_cur ( char * scope, char * name);
 ExpType sc_lookup ( char * name );
 void add_line(char * name, int lineno);
@@ -0,0 +1,151 @@
+#!/bin/sh
+#
+# run.sh: compiles each program tests/NAME.cm at each
+# optimization level, runs it on tm with the inputs of
+# tests/NAME.in and compares the values it outputs, one
+# a line, with tests/NAME.out; tests/NAME.flags holds
+# more options of the compiler for the program
+#
+# At -O1 and -O2 the program is compiled again with the
+# profile of its run, and must output the same. Its code
+# must come out the same with -rdparse, from a batch of
+# the programs without flags, from the AST cache, and
+# with -incremental, cold and warm; tests/NAME.edit is a
+# sed script that changes the source, after which the
+# incremental code must still be that of a full compile
+#
+# usage: tests/run.sh [compiler] [tm]
+# they default to ./cminus and ./tm (make cminus tm)
+#
+
+COMPILER=${1:-./cminus}
+TM=${2:-./tm}
+TESTS=`dirname $0`
+DIR=${TMPDIR:-/tmp}/cminus-tests-$$
+mkdir -p $DIR
+trap 'rm -rf $DIR' 0
+
+for p in "$COMPILER" "$TM"
+do if [ ! -x "$p" ]
+   then echo "no $p: run make cminus tm" >&2
+        exit 1
+   fi
+done
+
+failed=0
+
+# fail reports that $name failed at $level
+fail ()
+{ echo "$name $level: $*"
+  failed=`expr $failed + 1`
+}
+
+# compile compiles $name at $level with its flags and
+# the options given; it fails if the listing has errors
+compile ()
+{ rm -f $DIR/$name.tm
+  $COMPILER $level $flags "$@" $DIR/$name.cm > $DIR/$name.lst 2>&1 \
+  && ! grep -q "error" $DIR/$name.lst
+}
+
+# execute runs the code of $name on tm with the options
+# given, leaving the values it outputs in $name.got
+execute ()
+{ # tm reads its commands and then the inputs
+  { echo g
+    if [ -f $TESTS/$name.in ]; then cat $TESTS/$name.in; fi
+    echo q
+  } | $TM "$@" $DIR/$name.tm > $DIR/$name.run 2>&1
+  sed -n 's/^.*OUT instruction prints: //p' $DIR/$name.run > $DIR/$name.got
+}
+
+# code prints the instructions of $name by location:
+# the code file may have backpatched ones out of order
+code ()
+{ grep '^ *[0-9][0-9]*:' $DIR/$name.tm | sort -n
+}
+
+# same fails unless the code of $name is that of a
+# compile without the options given
+same ()
+{ if ! compile "$@"
+  then fail "does not compile with $*"
+  elif ! code | cmp -s - $DIR/$name$level.ref
+  then fail "code differs with $*"
+  fi
+}
+
+for level in -O0 -O1 -O2
+do for src in $TESTS/*.cm
+   do name=`basename $src .cm`
+      flags=
+      if [ -f $TESTS/$name.flags ]; then flags=`cat $TESTS/$name.flags`; fi
+      cp $src $DIR/$name.cm
+      if ! compile
+      then fail "does not compile"
+           continue
+      fi
+      code > $DIR/$name$level.ref
+      execute
+      if ! cmp -s $DIR/$name.got $TESTS/$name.out
+      then fail "outputs" `cat $DIR/$name.got` "instead of" `cat $TESTS/$name.out`
+           continue
+      fi
+      if [ $level != -O0 ]
+      then if ! compile -debug-map
+           then fail "does not compile with -debug-map"
+           else execute -p
+                if ! compile -profile-use=$DIR/$name
+                then fail "does not compile with its profile"
+                else execute
+                     cmp -s $DIR/$name.got $TESTS/$name.out \
+                     || fail "outputs" `cat $DIR/$name.got` "with its profile"
+                fi
+           fi
+      fi
+      same -rdparse
+      rm -f $DIR/$name.ast
+      same -ast-cache
+      same -ast-cache
+      rm -f $DIR/$name.inc
+      same -incremental
+      same -incremental
+      if [ -f $TESTS/$name.edit ]
+      then sed -f $TESTS/$name.edit $src > $DIR/$name.cm
+           if ! compile -incremental
+           then fail "does not compile with -incremental after $name.edit"
+           else code > $DIR/$name.kept
+                compile && code | cmp -s - $DIR/$name.kept \
+                || fail "code differs with -incremental after $name.edit"
+           fi
+      fi
+      echo "$name $level: ok"
+   done
+
+   # the programs without flags in one batch: each has
+   # its code, and the listings come in their order
+   name=batch
+   ls $TESTS/*.cm | while read src
+   do if [ ! -f $TESTS/`basename $src .cm`.flags ]
+      then echo $DIR/`basename $src`
+      fi
+   done > $DIR/manifest
+   for src in `cat $DIR/manifest`
+   do cp $TESTS/`basename $src` $src
+      rm -f ${src%.cm}.tm
+   done
+   if ! $COMPILER $level -jobs=4 -manifest=$DIR/manifest > $DIR/batch.lst 2>&1
+   then fail "does not compile"
+   else sed -n 's/^TINY COMPILATION: //p' $DIR/batch.lst > $DIR/batch.order
+        cmp -s $DIR/batch.order $DIR/manifest || fail "listings out of order"
+        for src in `cat $DIR/manifest`
+        do name=`basename $src .cm`
+           code | cmp -s - $DIR/$name$level.ref \
+           || fail "code differs in the batch"
+        done
+   fi
+done
+if [ $failed -gt 0 ]
+then echo "$failed failed" >&2
+     exit 1
+fi
@@ -82,11 +82,17 @@ int iloc = 0 ;
 int dloc = 0 ;
 int traceflag = FALSE;
 int icountflag = FALSE;
+int profileflag = FALSE;
 
 INSTRUCTION iMem [IADDR_SIZE];
 int dMem [DADDR_SIZE];
 int reg [NO_REGS];
 
+/* execution profile: how often each location ran
+   and how often its conditional jump was taken */
+long execCount [IADDR_SIZE];
+long takenCount [IADDR_SIZE];
+
 char * opCodeTab[]
         = {"HALT","IN","OUT","ADD","SUB","MUL","DIV","????",
             /* RR opcodes */
@@ -100,7 +106,7 @@ char * stepResultTab[]
            "Data Memory Fault","Division by 0"
           };
 
-char pgmName[20];
+char pgmName[LINESIZE];
 FILE *pgm  ;
 
 char in_Line[LINESIZE] ;
@@ -315,6 +321,7 @@ STEPRESULT stepTM (void)
       return srIMEM_ERR ;
   reg[PC_REG] = pc + 1 ;
   currentinstruction = iMem[ pc ] ;
+  if ( profileflag && pc < IADDR_SIZE ) execCount[pc]++ ;
   switch (opClass(currentinstruction.iop) )
   { case opclRR :
     /***********************************/
@@ -393,6 +400,9 @@ STEPRESULT stepTM (void)
 
     /* end of legal instructions */
   } /* case */
+  if ( profileflag && currentinstruction.iop >= opJLT
+       && reg[PC_REG] != pc + 1 )
+    takenCount[pc]++ ;
   return srOKAY ;
 } /* stepTM */
 
@@ -520,6 +530,7 @@ int doCommand (void)
       dMem[0] = DADDR_SIZE - 1 ;
       for (loc = 1 ; loc < DADDR_SIZE ; loc++)
             dMem[loc] = 0 ;
+      /* the profile adds up over the executions */
       break;
 
     case 'q' : return FALSE;  /* break; */
@@ -553,13 +564,43 @@ int doCommand (void)
 } /* doCommand */
 
 
+/********************************************/
+/* writeProfile writes "loc executed taken" for
+   each location that ran to <program>.prof, the
+   input of cminus -profile-use */
+void writeProfile (void)
+{ char profName[LINESIZE+8];
+  FILE * prof;
+  char * dot;
+  int loc;
+  strcpy(profName,pgmName);
+  dot = strrchr(profName,'.');
+  if (dot != NULL) *dot = '\0';
+  strcat(profName,".prof");
+  prof = fopen(profName,"w");
+  if (prof == NULL)
+  { printf("cannot write profile '%s'\n",profName);
+    return;
+  }
+  for (loc = 0; loc < IADDR_SIZE; loc++)
+    if (execCount[loc] > 0)
+      fprintf(prof,"%d %ld %ld\n",loc,execCount[loc],takenCount[loc]);
+  fclose(prof);
+  printf("Profile written to %s\n",profName);
+} /* writeProfile */
+
 /********************************************/
 /* E X E C U T I O N   B E G I N S   H E R E */
 /********************************************/
 
 main( int argc, char * argv[] )
-{ if (argc != 2)
-  { printf("usage: %s <filename>\n",argv[0]);
+{ if (argc == 3 && strcmp(argv[1],"-p") == 0)
+  { profileflag = TRUE;
+    argv++;
+    argc--;
+  }
+  if (argc != 2)
+  { printf("usage: %s [-p] <filename>\n",argv[0]);
     exit(1);
   }
   strcpy(pgmName,argv[1]) ;
@@ -581,6 +622,7 @@ main( int argc, char * argv[] )
   do
      done = ! doCommand ();
   while (! done );
+  if ( profileflag ) writeProfile ();
   printf("Simulation done.\n");
   return 0;
 }
@@ -6,13 +6,20 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "globals.h"
 #include "util.h"
+#include "context.h"
 
 /* Procedure printToken prints a token 
- * and its lexeme to the listing file
+ * and its lexeme, the len characters at
+ * tokenString, to the listing file
  */
-void printToken( TokenType token, const char* tokenString )
+void printToken( TokenType token, const char* tokenString, int len )
 { switch (token)
   { case IF:
     case ELSE:
@@ -20,136 +27,166 @@ void printToken( TokenType token, const char* tokenString )
     case VOID:
     case RETURN:
     case WHILE:
-      fprintf(listing,
-         "reserved word: %s\n",tokenString);
+      fprintf(cc->listing,
+         "reserved word: %.*s\n",len,tokenString);
       break;
-    case ASSIGN: fprintf(listing,"=\n"); break;
-    case LT: fprintf(listing,"<\n"); break;
-    case EQ: fprintf(listing,"==\n"); break;
-    case NE: fprintf(listing,"!=\n"); break;
-    case LE: fprintf(listing,"<=\n"); break;
-    case GT: fprintf(listing,">\n"); break;
-    case GE: fprintf(listing,">=\n"); break;
-    case LPAREN: fprintf(listing,"(\n"); break;
-    case RPAREN: fprintf(listing,")\n"); break;
-    case LBRACE: fprintf(listing,"[\n"); break;
-    case RBRACE: fprintf(listing,"]\n"); break;
-    case LCURLY: fprintf(listing,"{\n"); break;
-    case RCURLY: fprintf(listing,"}\n"); break;
-    case SEMI: fprintf(listing,";\n"); break;
-    case COMMA: fprintf(listing,",\n"); break;
-    case PLUS: fprintf(listing,"+\n"); break;
-    case MINUS: fprintf(listing,"-\n"); break;
-    case TIMES: fprintf(listing,"*\n"); break;
-    case OVER: fprintf(listing,"/\n"); break;
-    case ENDFILE: fprintf(listing,"EOF\n"); break;
+    case ASSIGN: fprintf(cc->listing,"=\n"); break;
+    case LT: fprintf(cc->listing,"<\n"); break;
+    case EQ: fprintf(cc->listing,"==\n"); break;
+    case NE: fprintf(cc->listing,"!=\n"); break;
+    case LE: fprintf(cc->listing,"<=\n"); break;
+    case GT: fprintf(cc->listing,">\n"); break;
+    case GE: fprintf(cc->listing,">=\n"); break;
+    case LPAREN: fprintf(cc->listing,"(\n"); break;
+    case RPAREN: fprintf(cc->listing,")\n"); break;
+    case LBRACE: fprintf(cc->listing,"[\n"); break;
+    case RBRACE: fprintf(cc->listing,"]\n"); break;
+    case LCURLY: fprintf(cc->listing,"{\n"); break;
+    case RCURLY: fprintf(cc->listing,"}\n"); break;
+    case SEMI: fprintf(cc->listing,";\n"); break;
+    case COMMA: fprintf(cc->listing,",\n"); break;
+    case PLUS: fprintf(cc->listing,"+\n"); break;
+    case MINUS: fprintf(cc->listing,"-\n"); break;
+    case TIMES: fprintf(cc->listing,"*\n"); break;
+    case OVER: fprintf(cc->listing,"/\n"); break;
+    case ENDFILE: fprintf(cc->listing,"EOF\n"); break;
     case NUM:
-      fprintf(listing,
-          "NUM, val= %s\n",tokenString);
+      fprintf(cc->listing,
+          "NUM, val= %.*s\n",len,tokenString);
       break;
     case ID:
-      fprintf(listing,
-          "ID, name= %s\n",tokenString);
+      fprintf(cc->listing,
+          "ID, name= %.*s\n",len,tokenString);
       break;
     case ERROR:
-      fprintf(listing,
-          "ERROR: %s\n",tokenString);
+      fprintf(cc->listing,
+          "ERROR: %.*s\n",len,tokenString);
       break;
     default: /* should never happen */
-      fprintf(listing,"Unknown token: %d\n",token);
+      fprintf(cc->listing,"Unknown token: %d\n",token);
   }
 }
 
-/* Function newStmtNode creates a new statement
-    * node for syntax tree construction
-	 */
-TreeNode * newStmtNode(StmtKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
-		int i;
-		if (t==NULL)
-				fprintf(listing,"Out of memory error at line %d\n",lineno);
+/* Syntax tree nodes are taken in turn from chunks
+ * of memory, each twice the size of the one before,
+ * and are released all together by freeArena; the
+ * nodes of the new*Node functions come from nodes
+ */
+#define FIRSTCHUNK 256
+
+struct NodeChunk
+{ struct NodeChunk * next;
+		int size, used;
+		TreeNode node[1]; /* size nodes */
+};
+
+/* Function allocNode returns an uninitialized node
+ * from the current chunk of arena, or NULL if out
+ * of memory
+ */
+static TreeNode * allocNode(NodeArena * arena)
+{ struct NodeChunk * c = *arena;
+		int size;
+		if (c == NULL || c->used == c->size) {
+				size = c == NULL ? FIRSTCHUNK : 2*c->size;
+				c = (struct NodeChunk *) malloc(sizeof(struct NodeChunk)
+				                                + (size-1) * sizeof(TreeNode));
+				if (c == NULL) return NULL;
+				c->next = *arena;
+				c->size = size;
+				c->used = 0;
+				*arena = c;
+		}
+		return &c->node[c->used++];
+}
+
+/* Function newNodesIn returns n uninitialized nodes
+ * in a row from a chunk of their own in arena, or
+ * NULL if out of memory; the chunk goes after the
+ * current one, which keeps handing out nodes
+ */
+TreeNode * newNodesIn(NodeArena * arena, int n)
+{ struct NodeChunk * c = (struct NodeChunk *)
+				malloc(sizeof(struct NodeChunk) + (n-1) * sizeof(TreeNode));
+		if (c == NULL) return NULL;
+		c->size = c->used = n;
+		if (*arena == NULL) {
+				c->next = NULL;
+				*arena = c;
+		}
 		else {
-				for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
-				t->sibling = NULL;
-				t->nodekind = StmtK;
-				t->kind.stmt = kind;
-				t->lineno = lineno;
+				c->next = (*arena)->next;
+				(*arena)->next = c;
 		}
-		return t;
+		return c->node;
 }
 
-/* Function newExpNode creates a new expression 
- * node for syntax tree construction
+/* Procedure freeArena releases every node of arena
+ * at once: a chunk is freed, not each node
  */
-TreeNode * newExpNode(ExpKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+void freeArena(NodeArena * arena)
+{ struct NodeChunk * c;
+		while (*arena != NULL) {
+				c = *arena;
+				*arena = c->next;
+				free(c);
+		}
+}
+
+/* Procedure freeNodes releases every node made by
+ * the new*Node functions
+ */
+void freeNodes(void)
+{ freeArena(&cc->nodes); }
+
+/* Function newNodeIn creates a node of the given
+ * kinds and line in arena, with no children
+ */
+TreeNode * newNodeIn(NodeArena * arena, NodeKind nodekind, int kind, int line)
+{ TreeNode * t = allocNode(arena);
 		int i;
 		if (t==NULL)
-				fprintf(listing,"Out of memory error at line %d\n",lineno);
+				fprintf(cc->listing,"Out of memory error at line %d\n",line);
 		else {
 				for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
 				t->sibling = NULL;
-				t->nodekind = ExpK;
-				t->kind.exp = kind;
-				t->lineno = lineno;
+				t->nodekind = nodekind;
+				t->kind.stmt = kind;
+				t->lineno = line;
 				t->type = Void;
 		}
 		return t;
 }
 
+/* Function newStmtNode creates a new statement
+    * node for syntax tree construction
+	 */
+TreeNode * newStmtNode(StmtKind kind)
+{ return newNodeIn(&cc->nodes,StmtK,kind,cc->lineno); }
+
+/* Function newExpNode creates a new expression 
+ * node for syntax tree construction
+ */
+TreeNode * newExpNode(ExpKind kind)
+{ return newNodeIn(&cc->nodes,ExpK,kind,cc->lineno); }
+
 /* Function newParamNode creates a new declation
  * node for syntax tree construction
  */
 TreeNode * newDeclNode(DeclKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
-		int i;
-		if (t==NULL)
-				fprintf(listing,"Out of memory error at line %d\n",lineno);
-		else {
-				for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
-				t->sibling = NULL;
-				t->nodekind = DeclK;
-				t->kind.decl = kind;
-				t->lineno = lineno;
-		}
-		return t;
-}
+{ return newNodeIn(&cc->nodes,DeclK,kind,cc->lineno); }
 
 /* Function newParamNode creates a new parameter
  * node for syntax tree construction
  */
 TreeNode * newParamNode(ParamKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
-		int i;
-		if (t==NULL)
-				fprintf(listing,"Out of memory error at line %d\n",lineno);
-		else {
-				for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
-				t->sibling = NULL;
-				t->nodekind = ParamK;
-				t->kind.param = kind;
-				t->lineno = lineno;
-		}
-		return t;
-}
+{ return newNodeIn(&cc->nodes,ParamK,kind,cc->lineno); }
 
 /* Function newTypeNode creates a new type
  * node for syntax tree construction
  */
 TreeNode * newTypeNode(TypeKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
-		int i;
-		if (t==NULL)
-				fprintf(listing,"Out of memory error at line %d\n",lineno);
-		else {
-				for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
-				t->sibling = NULL;
-				t->nodekind = TypeK;
-				t->kind.type = kind;
-				t->lineno = lineno;
-		}
-		return t;
-}
+{ return newNodeIn(&cc->nodes,TypeK,kind,cc->lineno); }
 
 /* Function copyString allocates and makes a new
  * copy of an existing string
@@ -161,15 +198,199 @@ char * copyString(char * s)
 		n = strlen(s)+1;
 		t = malloc(n);
 		if (t==NULL)
-				fprintf(listing,"Out of memory error at line %d\n",lineno);
+				fprintf(cc->listing,"Out of memory error at line %d\n",cc->lineno);
 		else strcpy(t,s);
 		return t;
 }
 
+/* Function sourceRoom returns the size of the
+ * mapping that holds a source of n bytes and pad
+ */
+static size_t sourceRoom(size_t n, int pad)
+{ long page = sysconf(_SC_PAGESIZE);
+		return (n + pad + page - 1) / page * page;
+}
+
+/* Function mapSource returns the contents of file
+ * f followed by pad '\0' bytes, so a scanner may
+ * read ahead of the end of the text, and stores the
+ * length of the contents in size. A regular file is
+ * mapped privately, and writably, over a zeroed
+ * anonymous mapping at least pad bytes longer, so
+ * the bytes past its end are already '\0' and it is
+ * never copied; anything else, like a pipe, is read
+ * into memory and copied to such a mapping. Either
+ * way f is left at its end.
+ */
+char * mapSource(FILE * f, int pad, size_t * size)
+{ struct stat st;
+		size_t n = 0, room;
+		char * text, * buf;
+		int got;
+		if (fstat(fileno(f),&st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		{ n = st.st_size;
+				room = sourceRoom(n,pad);
+				text = mmap(NULL,room,PROT_READ|PROT_WRITE,
+				            MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+				if (text != MAP_FAILED)
+				{ if (mmap(text,n,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_FIXED,
+						           fileno(f),0) != MAP_FAILED)
+						{ fseek(f,0,SEEK_END);
+								*size = n;
+								return text;
+						}
+						munmap(text,room);
+				}
+		}
+		room = BUFSIZ;
+		buf = malloc(room);
+		n = 0;
+		while (buf != NULL && (got = fread(buf+n,1,room-n,f)) > 0)
+		{ n += got;
+				if (n == room)
+						buf = realloc(buf,room *= 2);
+		}
+		text = buf == NULL ? MAP_FAILED :
+		       mmap(NULL,sourceRoom(n,pad),PROT_READ|PROT_WRITE,
+		            MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+		if (text == MAP_FAILED)
+		{ fprintf(cc->listing,"Out of memory error reading the source\n");
+				exit(1);
+		}
+		memcpy(text,buf,n);
+		free(buf);
+		*size = n;
+		return text;
+}
+
+/* Procedure unmapSource releases the text returned
+ * by mapSource for a file of size bytes and pad
+ */
+void unmapSource(char * text, size_t size, int pad)
+{ munmap(text,sourceRoom(size,pad)); }
+
+/* Identifiers are interned in a chained hash table:
+ * each distinct name is kept once, after its hash, so
+ * names compare as pointers and the symbol table need
+ * not hash them again. Parsers may run on several
+ * threads at once, so the table takes no lock: a
+ * record is complete before it is linked, and a new
+ * one goes at the head of its chain only if that
+ * head is still the one searched, or the chain is
+ * searched again.
+ */
+#define INTERNSIZE 1021
+
+typedef struct InternRec
+{ struct InternRec * next;
+		unsigned hash;
+		char text[1]; /* the name, '\0' terminated */
+} InternRec;
+
+static InternRec * interned[INTERNSIZE];
+
+char * globalName, * mainName, * inputName, * outputName;
+
+/* Function findInterned returns the record of the n
+ * characters at s with hash h in the chain from r
+ * on, or NULL if none
+ */
+static InternRec * findInterned(InternRec * r, char * s, int n, unsigned h)
+{ for (; r != NULL; r = r->next)
+				if (r->hash == h && strncmp(r->text, s, n) == 0 && r->text[n] == '\0')
+						return r;
+		return NULL;
+}
+
+/* Function internText returns the interned copy of
+ * the n characters at s, which need not be '\0'
+ * terminated, entering them the first time: the
+ * scanner hands identifiers over in place, so a
+ * lexeme is copied only when it is a new name
+ */
+char * internText(char * s, int n)
+{ InternRec * r, * head, * found, ** chain;
+		unsigned h = 0;
+		int i;
+		if (s==NULL) return NULL;
+		for (i = 0; i < n; i++) h = h * 31 + (unsigned char) s[i];
+		chain = &interned[h % INTERNSIZE];
+		head = __atomic_load_n(chain, __ATOMIC_ACQUIRE);
+		found = findInterned(head, s, n, h);
+		if (found != NULL) return found->text;
+		r = (InternRec *) malloc(offsetof(InternRec, text) + n + 1);
+		if (r==NULL) {
+				fprintf(cc->listing,"Out of memory error at line %d\n",cc->lineno);
+				return NULL;
+		}
+		r->hash = h;
+		memcpy(r->text, s, n);
+		r->text[n] = '\0';
+		for (;;) {
+				r->next = head;
+				if (__atomic_compare_exchange_n(chain, &head, r, FALSE,
+						__ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+						return r->text;
+				/* another thread linked a name first, which
+				 * may be this one; head is now the new one */
+				found = findInterned(head, s, n, h);
+				if (found != NULL) {
+						free(r);
+						return found->text;
+				}
+		}
+}
+
+/* Function internString returns the interned copy
+ * of s, entering it the first time
+ */
+char * internString(char * s)
+{ if (s==NULL) return NULL;
+		return internText(s, strlen(s));
+}
+
+/* Function internHash returns the hash of the
+ * interned name s, kept from when it was entered
+ */
+unsigned internHash(char * s)
+{ return ((InternRec *) (s - offsetof(InternRec, text)))->hash; }
+
+/* Procedure initNames interns the names the compiler
+ * looks for
+ */
+void initNames(void)
+{ globalName = internString("Global");
+		mainName = internString("main");
+		inputName = internString("input");
+		outputName = internString("output");
+}
+
+/* Function copyTree makes a deep copy of a syntax
+ * tree, including the siblings that follow it
+ */
+TreeNode * copyTree( TreeNode * t )
+{ TreeNode * head = NULL, * last = NULL, * n;
+		int i;
+		for (; t != NULL; t = t->sibling) {
+				n = allocNode(&cc->nodes);
+				if (n==NULL) {
+						fprintf(cc->listing,"Out of memory error at line %d\n",cc->lineno);
+						return head;
+				}
+				*n = *t;
+				for (i=0;i<MAXCHILDREN;i++) n->child[i] = copyTree(t->child[i]);
+				n->sibling = NULL;
+				if (last == NULL) head = n;
+				else last->sibling = n;
+				last = n;
+		}
+		return head;
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
-static int indentno = 0;
+static __thread int indentno = 0;
 
 /* macros to increase/decrease indentation */
 #define INDENT indentno+=2
@@ -179,7 +400,7 @@ static int indentno = 0;
 static void printSpaces(void)
 { int i;
 		for (i=0;i<indentno;i++)
-				fprintf(listing," ");
+				fprintf(cc->listing," ");
 }
 
 /* procedure printTree prints a syntax tree to the 
@@ -193,96 +414,99 @@ void printTree( TreeNode * tree )
   if (tree->nodekind==StmtK)
   { switch (tree->kind.stmt) {
  	   case CompK:
-		 fprintf(listing,"Compound Statment : \n");
+		 fprintf(cc->listing,"Compound Statment : \n");
 	     break;
 	   case IfK:
-	     fprintf(listing,"If : (condition) (body) (else)\n");
+	     fprintf(cc->listing,"If : (condition) (body) (else)\n");
 	     break;
 	   case IterK:
-	     fprintf(listing,"Iteration : \n");
+	     fprintf(cc->listing,"Iteration : \n");
 	     break;
 	   case RetK:
-	     fprintf(listing,"Return : \n");
+	     fprintf(cc->listing,"Return : \n");
 	     break;
 	   default:
-	     fprintf(listing,"Unknown ExpNode kind\n");
+	     fprintf(cc->listing,"Unknown ExpNode kind\n");
 	     break;
 	   }
   }
   else if (tree->nodekind==ExpK)
   { switch (tree->kind.exp) {
   	  case AssignK:
-	    fprintf(listing,"Assign: (destination) (source)\n");
-		//printToken(tree->attr.op,"\0");
+	    fprintf(cc->listing,"Assign: (destination) (source)\n");
+		//printToken(tree->attr.op,"\0",0);
 	    break;
 	  case OpK:
-	    fprintf(listing,"Op: ");
-	    printToken(tree->attr.op,"\0");
+	    fprintf(cc->listing,"Op: ");
+	    printToken(tree->attr.op,"\0",0);
 	    break;
 	  case ConstK:
-	    fprintf(listing,"Const: %d\n",tree->attr.val);
+	    fprintf(cc->listing,"Const: %d\n",tree->attr.val);
 	    break;
 	  case IdK:
-	    fprintf(listing,"Id: %s\n",tree->attr.name);
+	    fprintf(cc->listing,"Id: %s\n",tree->attr.name);
 	    break;
 	  case ArrIdK:
-	    fprintf(listing,"ArrId\n");
+	    fprintf(cc->listing,"ArrId\n");
 	    break;
 	  case CallK:
-	    fprintf(listing,"Call, name : %s with arguments below\n", tree->attr.name);
+	    fprintf(cc->listing,"Call, name : %s with arguments below\n", tree->attr.name);
+	    break;
+	  case InlineK:
+	    fprintf(cc->listing,"Inlined call : %s (parameters) (body)\n", tree->attr.name);
 	    break;
 	  default:
-	    fprintf(listing,"Unknown ExpNode kind\n");
+	    fprintf(cc->listing,"Unknown ExpNode kind\n");
 	    break;
 	}
   }
   else if (tree->nodekind==DeclK)
   { switch (tree->kind.decl) {
 	   case FuncK:
-		   fprintf(listing,"Function Declaration: %s",tree->attr.name);
+		   fprintf(cc->listing,"Function Declaration: %s",tree->attr.name);
 		   break;
 	   case VarK:
-		   fprintf(listing,"Var Declaration: %s",tree->attr.name);
+		   fprintf(cc->listing,"Var Declaration: %s",tree->attr.name);
 		   break;
 	   case ArrVarK:
-		   fprintf(listing,"Var Dec(following const:array length): %s %d\n",tree->attr.arr.name,tree->attr.arr.size);
+		   fprintf(cc->listing,"Var Dec(following const:array length): %s %d\n",tree->attr.arr.name,tree->attr.arr.size);
 		   break;
 	   default:
-		   fprintf(listing,"Unknown DeclNode kind\n");
+		   fprintf(cc->listing,"Unknown DeclNode kind\n");
 		   break;
    }
   }
   else if (tree->nodekind==ParamK)
   { switch (tree->kind.param) {
 		case ArrParamK:
-			fprintf(listing,"Array Parameter: %s",tree->attr.name);
+			fprintf(cc->listing,"Array Parameter: %s",tree->attr.name);
 			break;
 		case NonArrParamK:
- 			fprintf(listing,"Single Parameter: %s",tree->attr.name);
+ 			fprintf(cc->listing,"Single Parameter: %s",tree->attr.name);
 			break;
 		default:
-			fprintf(listing,"Unknown ParamNode kind\n");
+			fprintf(cc->listing,"Unknown ParamNode kind\n");
 			break;
 	}
   }
   else if (tree->nodekind==TypeK)
   { switch (tree->kind.type) {
 	   case TypeNameK:
-		   fprintf(listing,"Type: ");
+		   fprintf(cc->listing,"Type: ");
 	   switch (tree->attr.type) {
 		   case INT:
-			   fprintf(listing,"int\n");
+			   fprintf(cc->listing,"int\n");
 			   break;
 		   case VOID:
-			   fprintf(listing,"void\n");
+			   fprintf(cc->listing,"void\n");
 		   }
 		break;
 	   default:
-		  fprintf(listing,"Unknown TypeNode kind\n");
+		  fprintf(cc->listing,"Unknown TypeNode kind\n");
 		  break;
 	}
   }
-  else fprintf(listing,"Unknown node kind\n");
+  else fprintf(cc->listing,"Unknown node kind\n");
   for (i=0;i<MAXCHILDREN;i++) {
 	printTree(tree->child[i]);
 	}
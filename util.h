@@ -9,9 +9,10 @@
 #define _UTIL_H_
 
 /* Procedure printToken prints a token 
- * and its lexeme to the listing file
+ * and its lexeme, of the given length,
+ * to the listing file
  */
-void printToken( TokenType, const char* );
+void printToken( TokenType, const char*, int );
 
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
@@ -28,11 +29,83 @@ TreeNode * newDeclNode(DeclKind);
 TreeNode * newParamNode(ParamKind kind);
 
 TreeNode * newTypeNode(TypeKind kind);
+
+/* Procedure freeNodes releases all the nodes of the
+ * syntax trees made so far at once: nodes come from
+ * chunks doubling in size, so only a few frees are
+ * needed however many nodes there are
+ */
+void freeNodes(void);
+
+/* A NodeArena holds nodes apart from those of the
+ * new*Node functions, to be released on their own;
+ * an empty arena is NULL
+ */
+typedef struct NodeChunk * NodeArena;
+
+/* Function newNodeIn creates a node of kind kind
+ * of nodekind, made at line, in arena
+ */
+TreeNode * newNodeIn( NodeArena *, NodeKind, int, int );
+
+/* Function newNodesIn returns n nodes in a row,
+ * uninitialized, from arena
+ */
+TreeNode * newNodesIn( NodeArena *, int );
+
+/* Procedure freeArena releases all the nodes of
+ * arena and leaves it empty
+ */
+void freeArena( NodeArena * );
+
 /* Function copyString allocates and makes a new
  * copy of an existing string
  */
 char * copyString( char * );
 
+/* Function mapSource returns the contents of a
+ * source file, followed by the given number of
+ * '\0' bytes, and stores their length in size
+ */
+char * mapSource( FILE *, int, size_t * );
+
+/* Procedure unmapSource releases a text returned
+ * by mapSource, given its length and padding
+ */
+void unmapSource( char *, size_t, int );
+
+/* Function internString returns the one copy of
+ * string s kept by the compiler: identifiers and
+ * scope names are interned, so two of them are the
+ * same name exactly when they are the same pointer
+ */
+char * internString( char * );
+
+/* Function internText interns the n characters
+ * at s, which need not be '\0' terminated
+ */
+char * internText( char *, int );
+
+/* Function internHash returns the hash of a string
+ * returned by internString, computed only once
+ */
+unsigned internHash( char * );
+
+/* the interned names the compiler looks for: the
+ * global scope, main and the built-in functions
+ */
+extern char * globalName, * mainName, * inputName, * outputName;
+
+/* Procedure initNames interns the names above; it
+ * must be called before any of them is used
+ */
+void initNames(void);
+
+/* Function copyTree makes a deep copy of a syntax
+ * tree, including the siblings that follow it
+ */
+TreeNode * copyTree( TreeNode * );
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */
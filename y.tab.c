@@ -66,10 +66,12 @@
 
 #define YYPARSER /* distinguishes Yacc output from other code files */
 
+#include <pthread.h>
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "context.h"
 
 #define YYSTYPE TreeNode *
 static char * savedName; /* for use in assignments */
@@ -79,7 +81,33 @@ static int yylex(void); // added 11/2/11 to ensure no conflict with lex
 static int savedNumber;
 static int saveType;
 
-#line 83 "y.tab.c" /* yacc.c:339  */
+/* Lists are built in time linear in their length:
+ * while a list is open it is held by its last node,
+ * whose sibling points back to the first, so that
+ * appending needs no walk; closeList breaks the
+ * circle and returns the first node
+ */
+static TreeNode * appendList(TreeNode * list, TreeNode * t)
+{ TreeNode * last = t;
+  if (t == NULL) return list;
+  while (last->sibling != NULL) last = last->sibling;
+  if (list == NULL) last->sibling = t;
+  else
+  { last->sibling = list->sibling;
+    list->sibling = t;
+  }
+  return last;
+}
+
+static TreeNode * closeList(TreeNode * list)
+{ TreeNode * first;
+  if (list == NULL) return NULL;
+  first = list->sibling;
+  list->sibling = NULL;
+  return first;
+}
+
+#line 111 "y.tab.c" /* yacc.c:339  */
 
 # ifndef YY_NULLPTR
 #  if defined __cplusplus && 201103L <= __cplusplus
@@ -190,7 +218,7 @@ int yyparse (void);
 
 /* Copy the second part of user declarations.  */
 
-#line 194 "y.tab.c" /* yacc.c:358  */
+#line 222 "y.tab.c" /* yacc.c:358  */
 
 #ifdef short
 # undef short
@@ -1338,205 +1366,177 @@ yyreduce:
   switch (yyn)
     {
         case 2:
-#line 31 "yacc/cminus.y" /* yacc.c:1646  */
-    { savedTree = (yyvsp[0]);}
-#line 1344 "y.tab.c" /* yacc.c:1646  */
+#line 59 "yacc/cminus.y" /* yacc.c:1646  */
+    { savedTree = closeList((yyvsp[0]));}
+#line 1372 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 3:
-#line 34 "yacc/cminus.y" /* yacc.c:1646  */
-    { YYSTYPE t = (yyvsp[-1]);
-		  	  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = (yyvsp[0]);
-				(yyval) = (yyvsp[-1]); }
-			  else (yyval) = (yyvsp[0]);
-			}
-#line 1357 "y.tab.c" /* yacc.c:1646  */
+#line 62 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList((yyvsp[-1]), (yyvsp[0])); }
+#line 1378 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 4:
-#line 42 "yacc/cminus.y" /* yacc.c:1646  */
-    { (yyval) = (yyvsp[0]); }
-#line 1363 "y.tab.c" /* yacc.c:1646  */
+#line 63 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList(NULL, (yyvsp[0])); }
+#line 1384 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 5:
-#line 44 "yacc/cminus.y" /* yacc.c:1646  */
+#line 65 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = (yyvsp[0]); }
-#line 1369 "y.tab.c" /* yacc.c:1646  */
+#line 1390 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 6:
-#line 45 "yacc/cminus.y" /* yacc.c:1646  */
+#line 66 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = (yyvsp[0]); }
-#line 1375 "y.tab.c" /* yacc.c:1646  */
+#line 1396 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 7:
-#line 48 "yacc/cminus.y" /* yacc.c:1646  */
-    { savedName = copyString(tokenString);
-			  savedLineNo = lineno;
+#line 69 "yacc/cminus.y" /* yacc.c:1646  */
+    { savedName = tokenName();
+			  savedLineNo = cc->lineno;
 			}
-#line 1383 "y.tab.c" /* yacc.c:1646  */
+#line 1404 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 8:
-#line 53 "yacc/cminus.y" /* yacc.c:1646  */
-    { savedNumber = atoi(tokenString);
-			  savedLineNo = lineno;
+#line 74 "yacc/cminus.y" /* yacc.c:1646  */
+    { savedNumber = tokenValue();
+			  savedLineNo = cc->lineno;
 			}
-#line 1391 "y.tab.c" /* yacc.c:1646  */
+#line 1412 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 9:
-#line 58 "yacc/cminus.y" /* yacc.c:1646  */
+#line 79 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newDeclNode(VarK);
 			  (yyval)->child[0] = (yyvsp[-2]); /* type */
-			  (yyval)->lineno = lineno;
+			  (yyval)->lineno = cc->lineno;
 			  (yyval)->attr.name = savedName;
 	 		  }
-#line 1401 "y.tab.c" /* yacc.c:1646  */
+#line 1422 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 10:
-#line 64 "yacc/cminus.y" /* yacc.c:1646  */
+#line 85 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newDeclNode(ArrVarK);
 			  (yyval)->child[0] = (yyvsp[-5]); /* type */
-			  (yyval)->lineno = lineno;
+			  (yyval)->lineno = cc->lineno;
 			  (yyval)->attr.arr.name = savedName;
 			  (yyval)->attr.arr.size = savedNumber;
 			}
-#line 1412 "y.tab.c" /* yacc.c:1646  */
+#line 1433 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 11:
-#line 72 "yacc/cminus.y" /* yacc.c:1646  */
+#line 93 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newTypeNode(TypeNameK);
 			  (yyval)->attr.type = INT;
 			}
-#line 1420 "y.tab.c" /* yacc.c:1646  */
+#line 1441 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 12:
-#line 76 "yacc/cminus.y" /* yacc.c:1646  */
+#line 97 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newTypeNode(TypeNameK);
 			  (yyval)->attr.type = VOID;
 			}
-#line 1428 "y.tab.c" /* yacc.c:1646  */
+#line 1449 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 13:
-#line 81 "yacc/cminus.y" /* yacc.c:1646  */
+#line 102 "yacc/cminus.y" /* yacc.c:1646  */
     {
 			  (yyval) = newDeclNode(FuncK);
-			  (yyval)->lineno = lineno;
+			  (yyval)->lineno = cc->lineno;
 			  (yyval)->attr.name = savedName;
 			}
-#line 1438 "y.tab.c" /* yacc.c:1646  */
+#line 1459 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 14:
-#line 87 "yacc/cminus.y" /* yacc.c:1646  */
+#line 108 "yacc/cminus.y" /* yacc.c:1646  */
     {
 			  (yyval) = (yyvsp[-4]);
 			  (yyval)->child[0] = (yyvsp[-6]); 	/* type print*/
 	  		  (yyval)->child[1] = (yyvsp[-2]);    /* param print*/
 			  (yyval)->child[2] = (yyvsp[0]); 	/* body print*/
 			}
-#line 1449 "y.tab.c" /* yacc.c:1646  */
+#line 1470 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 15:
-#line 94 "yacc/cminus.y" /* yacc.c:1646  */
-    { (yyval) = (yyvsp[0]); }
-#line 1455 "y.tab.c" /* yacc.c:1646  */
+#line 115 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = closeList((yyvsp[0])); }
+#line 1476 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 16:
-#line 96 "yacc/cminus.y" /* yacc.c:1646  */
+#line 117 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newTypeNode(TypeNameK);
 			  (yyval)->attr.type = VOID;
 			}
-#line 1463 "y.tab.c" /* yacc.c:1646  */
+#line 1484 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 17:
-#line 100 "yacc/cminus.y" /* yacc.c:1646  */
-    { YYSTYPE t = (yyvsp[-2]);
-			  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = (yyvsp[0]);
-				(yyval) = (yyvsp[-2]); }
-			  else (yyval) = (yyvsp[0]); 
-			}
-#line 1476 "y.tab.c" /* yacc.c:1646  */
+#line 121 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList((yyvsp[-2]), (yyvsp[0])); }
+#line 1490 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 18:
-#line 108 "yacc/cminus.y" /* yacc.c:1646  */
-    { (yyval) = (yyvsp[0]); }
-#line 1482 "y.tab.c" /* yacc.c:1646  */
+#line 122 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList(NULL, (yyvsp[0])); }
+#line 1496 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 19:
-#line 110 "yacc/cminus.y" /* yacc.c:1646  */
+#line 124 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newParamNode(NonArrParamK);
 			  (yyval)->child[0] = (yyvsp[-1]);
 			  (yyval)->attr.name = savedName;
 			}
-#line 1491 "y.tab.c" /* yacc.c:1646  */
+#line 1505 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 20:
-#line 115 "yacc/cminus.y" /* yacc.c:1646  */
+#line 129 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newParamNode(ArrParamK);
 			  (yyval)->child[0] = (yyvsp[-3]);
 			  (yyval)->attr.name = savedName;
 			}
-#line 1500 "y.tab.c" /* yacc.c:1646  */
+#line 1514 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 21:
-#line 121 "yacc/cminus.y" /* yacc.c:1646  */
+#line 135 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newStmtNode(CompK);
-			  (yyval)->child[0] = (yyvsp[-2]);
-			  (yyval)->child[1] = (yyvsp[-1]);
+			  (yyval)->child[0] = closeList((yyvsp[-2]));
+			  (yyval)->child[1] = closeList((yyvsp[-1]));
 			}
-#line 1509 "y.tab.c" /* yacc.c:1646  */
+#line 1523 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 22:
-#line 127 "yacc/cminus.y" /* yacc.c:1646  */
-    { YYSTYPE t = (yyvsp[-1]);
-			  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = (yyvsp[0]);
-				(yyval) = (yyvsp[-1]); }
-			  else (yyval) = (yyvsp[0]);
-			}
-#line 1522 "y.tab.c" /* yacc.c:1646  */
+#line 141 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList((yyvsp[-1]), (yyvsp[0])); }
+#line 1529 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 23:
-#line 135 "yacc/cminus.y" /* yacc.c:1646  */
+#line 142 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = NULL; }
-#line 1528 "y.tab.c" /* yacc.c:1646  */
+#line 1535 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 24:
-#line 138 "yacc/cminus.y" /* yacc.c:1646  */
-    { YYSTYPE t = (yyvsp[-1]);
-			  if (t != NULL)
-			{ while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = (yyvsp[0]);
-				(yyval) = (yyvsp[-1]); }
-			else (yyval) = (yyvsp[0]);
-			}
+#line 145 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList((yyvsp[-1]), (yyvsp[0])); }
 #line 1541 "y.tab.c" /* yacc.c:1646  */
     break;
 
@@ -1798,7 +1798,7 @@ yyreduce:
   case 62:
 #line 243 "yacc/cminus.y" /* yacc.c:1646  */
     { (yyval) = newExpNode(ConstK);
-			  (yyval)->attr.val = atoi(tokenString);
+			  (yyval)->attr.val = tokenValue();
 			}
 #line 1804 "y.tab.c" /* yacc.c:1646  */
     break;
@@ -1822,7 +1822,7 @@ yyreduce:
 
   case 65:
 #line 257 "yacc/cminus.y" /* yacc.c:1646  */
-    { (yyval) = (yyvsp[0]); }
+    { (yyval) = closeList((yyvsp[0])); }
 #line 1827 "y.tab.c" /* yacc.c:1646  */
     break;
 
@@ -1834,25 +1834,18 @@ yyreduce:
 
   case 67:
 #line 261 "yacc/cminus.y" /* yacc.c:1646  */
-    { YYSTYPE t = (yyvsp[-2]);
-			  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = (yyvsp[0]);
-				(yyval) = (yyvsp[-2]); }
-			  else (yyval) = (yyvsp[0]);
-			}
-#line 1846 "y.tab.c" /* yacc.c:1646  */
+    { (yyval) = appendList((yyvsp[-2]), (yyvsp[0])); }
+#line 1839 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 68:
-#line 269 "yacc/cminus.y" /* yacc.c:1646  */
-    { (yyval) = (yyvsp[0]); }
-#line 1852 "y.tab.c" /* yacc.c:1646  */
+#line 262 "yacc/cminus.y" /* yacc.c:1646  */
+    { (yyval) = appendList(NULL, (yyvsp[0])); }
+#line 1845 "y.tab.c" /* yacc.c:1646  */
     break;
 
 
-#line 1856 "y.tab.c" /* yacc.c:1646  */
+#line 1849 "y.tab.c" /* yacc.c:1646  */
       default: break;
     }
   /* User semantic actions sometimes alter yychar, and that requires
@@ -2080,14 +2073,15 @@ yyreturn:
 #endif
   return yyresult;
 }
-#line 271 "yacc/cminus.y" /* yacc.c:1906  */
+#line 273 "yacc/cminus.y" /* yacc.c:1906  */
 
 
 int yyerror(char * message)
-{ fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
-  fprintf(listing,"Current token: ");
-  printToken(yychar,tokenString);
-  Error = TRUE;
+{ fprintf(cc->listing,"Syntax error at line %d: %s\n",cc->lineno,message);
+  fprintf(cc->listing,"Current token: ");
+  printToken(yychar,cc->scanner.text+cc->scanner.tokenOffset,
+             cc->scanner.tokenLength);
+  cc->Error = TRUE;
   return 0;
 }
 
@@ -2097,8 +2091,17 @@ int yyerror(char * message)
 static int yylex(void)
 { return getToken(); }
 
+/* Function parse returns the syntax tree of the
+ * source of the context; Yacc keeps its state in
+ * globals, so one thread parses at a time
+ */
 TreeNode * parse(void)
-{ yyparse();
-  return savedTree;
+{ static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  TreeNode * t;
+  pthread_mutex_lock(&lock);
+  yyparse();
+  t = savedTree;
+  pthread_mutex_unlock(&lock);
+  return t;
 }
 
@@ -7,10 +7,12 @@
 %{
 #define YYPARSER /* distinguishes Yacc output from other code files */
 
+#include <pthread.h>
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "context.h"
 
 #define YYSTYPE TreeNode *
 static char * savedName; /* for use in assignments */
@@ -19,6 +21,32 @@ static TreeNode * savedTree; /* stores syntax tree for later return */
 static int yylex(void); // added 11/2/11 to ensure no conflict with lex
 static int savedNumber;
 static int saveType;
+
+/* Lists are built in time linear in their length:
+ * while a list is open it is held by its last node,
+ * whose sibling points back to the first, so that
+ * appending needs no walk; closeList breaks the
+ * circle and returns the first node
+ */
+static TreeNode * appendList(TreeNode * list, TreeNode * t)
+{ TreeNode * last = t;
+  if (t == NULL) return list;
+  while (last->sibling != NULL) last = last->sibling;
+  if (list == NULL) last->sibling = t;
+  else
+  { last->sibling = list->sibling;
+    list->sibling = t;
+  }
+  return last;
+}
+
+static TreeNode * closeList(TreeNode * list)
+{ TreeNode * first;
+  if (list == NULL) return NULL;
+  first = list->sibling;
+  list->sibling = NULL;
+  return first;
+}
 %}
 
 %token IF ELSE INT RETURN VOID WHILE
@@ -28,42 +56,35 @@ static int saveType;
 
 %% /* Grammar for TINY */
 program     : decl_list
-			{ savedTree = $1;}
+			{ savedTree = closeList($1);}
 			;
 decl_list   : decl_list decl
-			{ YYSTYPE t = $1;
-		  	  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = $2;
-				$$ = $1; }
-			  else $$ = $2;
-			}
-			| decl  { $$ = $1; }
+			{ $$ = appendList($1, $2); }
+			| decl  { $$ = appendList(NULL, $1); }
 			;
 decl        : var_decl  { $$ = $1; }
 			| fun_decl  { $$ = $1; }
 			;
 saveName    : ID
-			{ savedName = copyString(tokenString);
-			  savedLineNo = lineno;
+			{ savedName = tokenName();
+			  savedLineNo = cc->lineno;
 			}
 			;
 saveNumber  : NUM
-			{ savedNumber = atoi(tokenString);
-			  savedLineNo = lineno;
+			{ savedNumber = tokenValue();
+			  savedLineNo = cc->lineno;
 			}
 			;
 var_decl    : type_spec saveName SEMI
 			{ $$ = newDeclNode(VarK);
 			  $$->child[0] = $1; /* type */
-			  $$->lineno = lineno;
+			  $$->lineno = cc->lineno;
 			  $$->attr.name = savedName;
 	 		  }
 			| type_spec saveName LBRACE saveNumber RBRACE SEMI
 			{ $$ = newDeclNode(ArrVarK);
 			  $$->child[0] = $1; /* type */
-			  $$->lineno = lineno;
+			  $$->lineno = cc->lineno;
 			  $$->attr.arr.name = savedName;
 			  $$->attr.arr.size = savedNumber;
 			}
@@ -80,7 +101,7 @@ type_spec   : INT
 fun_decl    : type_spec saveName 
 			{
 			  $$ = newDeclNode(FuncK);
-			  $$->lineno = lineno;
+			  $$->lineno = cc->lineno;
 			  $$->attr.name = savedName;
 			}
 			LPAREN params RPAREN comp_stmt
@@ -91,21 +112,14 @@ fun_decl    : type_spec saveName
 			  $$->child[2] = $7; 	/* body print*/
 			}
 			;
-params      : param_list  { $$ = $1; }
+params      : param_list  { $$ = closeList($1); }
 			| VOID
 			{ $$ = newTypeNode(TypeNameK);
 			  $$->attr.type = VOID;
 			}
 param_list  : param_list COMMA param
-			{ YYSTYPE t = $1;
-			  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = $3;
-				$$ = $1; }
-			  else $$ = $3; 
-			}	
-			| param { $$ = $1; };
+			{ $$ = appendList($1, $3); }
+			| param { $$ = appendList(NULL, $1); };
 param       : type_spec saveName
 			{ $$ = newParamNode(NonArrParamK);
 			  $$->child[0] = $1;
@@ -119,30 +133,16 @@ param       : type_spec saveName
 			;
 comp_stmt   : LCURLY local_decls stmt_list RCURLY
 			{ $$ = newStmtNode(CompK);
-			  $$->child[0] = $2;
-			  $$->child[1] = $3;
+			  $$->child[0] = closeList($2);
+			  $$->child[1] = closeList($3);
 			}
 			;
 local_decls : local_decls var_decl
-			{ YYSTYPE t = $1;
-			  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = $2;
-				$$ = $1; }
-			  else $$ = $2;
-			}
+			{ $$ = appendList($1, $2); }
 			| { $$ = NULL; }
 			;
 stmt_list   : stmt_list stmt
-			{ YYSTYPE t = $1;
-			  if (t != NULL)
-			{ while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = $2;
-				$$ = $1; }
-			else $$ = $2;
-			}
+			{ $$ = appendList($1, $2); }
 			| { $$ = NULL; }
 			;
 stmt        : exp_stmt { $$ = $1; }
@@ -241,7 +241,7 @@ factor      : LPAREN exp RPAREN { $$ = $2; }
 			| call { $$ = $1; }
 			| NUM
 			{ $$ = newExpNode(ConstK);
-			  $$->attr.val = atoi(tokenString);
+			  $$->attr.val = tokenValue();
 			}
 			;
 call        : saveName 
@@ -254,27 +254,21 @@ call        : saveName
 			  $$->child[0] = $4;
 			}
 			;
-args        : arg_list { $$ = $1; }
+args        : arg_list { $$ = closeList($1); }
 			| /* empty */ { $$ = NULL; }
 			;
 arg_list    : arg_list COMMA exp
-			{ YYSTYPE t = $1;
-			  if (t != NULL)
-			  { while (t->sibling != NULL)
-				t = t->sibling;
-				t->sibling = $3;
-				$$ = $1; }
-			  else $$ = $3;
-			}
-			| exp { $$ = $1; }
+			{ $$ = appendList($1, $3); }
+			| exp { $$ = appendList(NULL, $1); }
 			;
 %%
 
 int yyerror(char * message)
-{ fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
-  fprintf(listing,"Current token: ");
-  printToken(yychar,tokenString);
-  Error = TRUE;
+{ fprintf(cc->listing,"Syntax error at line %d: %s\n",cc->lineno,message);
+  fprintf(cc->listing,"Current token: ");
+  printToken(yychar,cc->scanner.text+cc->scanner.tokenOffset,
+             cc->scanner.tokenLength);
+  cc->Error = TRUE;
   return 0;
 }
 
@@ -284,8 +278,17 @@ int yyerror(char * message)
 static int yylex(void)
 { return getToken(); }
 
+/* Function parse returns the syntax tree of the
+ * source of the context; Yacc keeps its state in
+ * globals, so one thread parses at a time
+ */
 TreeNode * parse(void)
-{ yyparse();
-  return savedTree;
+{ static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  TreeNode * t;
+  pthread_mutex_lock(&lock);
+  yyparse();
+  t = savedTree;
+  pthread_mutex_unlock(&lock);
+  return t;
 }
 